@@ -0,0 +1,21 @@
+@echo off
+if not exist ..\build mkdir ..\build
+pushd ..\build
+if not exist .gitignore echo * > .gitignore
+
+call cl -O2 -nologo -Zi -FC ..\compiler\metalang.cpp ..\compiler\win32_metalang.cpp -Femetalang_msvc_bench.exe ws2_32.lib
+if errorlevel 1 goto done
+
+rem NOTE(alex): The generated programs are the same on every commit, so the rows
+rem in bench.csv can be compared by label to see what a change did.
+for /f %%c in ('git rev-parse --short HEAD') do set Label=%%c
+
+metalang_msvc_bench.exe -gen bench_small.inl 20 4 1 4
+metalang_msvc_bench.exe -gen bench_medium.inl 200 8 2 6
+metalang_msvc_bench.exe -gen bench_large.inl 1000 16 3 8
+metalang_msvc_bench.exe -gen-table bench_table.inl 200 64
+
+metalang_msvc_bench.exe -benchmark 5 -csv bench.csv -label %Label% bench_small.inl bench_medium.inl bench_large.inl bench_table.inl
+
+:done
+popd
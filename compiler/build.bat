@@ -3,7 +3,7 @@ if not exist ..\build mkdir ..\build
 pushd ..\build
 if not exist .gitignore echo * > .gitignore
 ctime -begin metalang.ctm
-call cl -nologo -Zi -FC ..\compiler\metalang.cpp ..\compiler\win32_metalang.cpp -Femetalang_msvc_debug.exe
+call cl -nologo -Zi -FC -DMETALANG_PROFILE=1 ..\compiler\metalang.cpp ..\compiler\win32_metalang.cpp -Femetalang_msvc_debug.exe ws2_32.lib
 rem call clang -g -fuse-ld=lld ..\metalang.cpp -o metalang_clang_debug.exe
 rem call cl -O2 -nologo -Zi -FC ..\metalang.cpp -Femetalang_msvc_release.exe
 rem call clang -O3 -g -fuse-ld=lld ..\metalang.cpp -o metalang_clang_release.exe
@@ -25,24 +25,55 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <intrin.h>
+#include <time.h>
 
 #include "metalang_platform.h"
 #include "metalang_shared.h"
 #include "metalang_memory.h"
+#include "metalang_stream.h"
+#include "metalang_hash.h"
+#include "metalang_profile.h"
 #include "metalang_tokenizer.h"
+#include "metalang_prescan.h"
 #include "metalang_node.h"
+#include "metalang_nodestats.h"
+#include "metalang_nodetrace.h"
+#include "metalang_object.h"
 #include "metalang_parser.h"
+#include "metalang_peephole.h"
+#include "metalang_schedule.h"
+#include "metalang_regalloc.h"
+#include "metalang_x64.h"
+#include "metalang_interpreter.h"
+#include "metalang_bytecode.h"
+#include "metalang_meta.h"
+#include "metalang_cache.h"
+#include "metalang_benchmark.h"
 
 #include "metalang_tokenizer.cpp"
+#include "metalang_profile.cpp"
 #include "metalang_node.cpp"
+#include "metalang_nodestats.cpp"
 #include "metalang_parser.cpp"
+#include "metalang_peephole.cpp"
+#include "metalang_prescan.cpp"
+#include "metalang_nodetrace.cpp"
+#include "metalang_schedule.cpp"
+#include "metalang_regalloc.cpp"
+#include "metalang_object.cpp"
+#include "metalang_x64.cpp"
+#include "metalang_interpreter.cpp"
+#include "metalang_bytecode.cpp"
+#include "metalang_meta.cpp"
+#include "metalang_cache.cpp"
+#include "metalang_benchmark.cpp"
 
 struct entire_file
 {
     u32 ContentsSize;
     void *Contents;
 };
-internal entire_file ReadEntireFile(char *FileName)
+internal entire_file ReadEntireFile(char *FileName, stream *Errors)
 {
     entire_file Result = {};
 
@@ -59,59 +90,1119 @@ internal entire_file ReadEntireFile(char *FileName)
     }
     else
     {
-        fprintf(stderr, "Error: Cannot open file \"%s\"\n", FileName);
+        Outf(Errors, "Error: Cannot open file \"%s\"\n", FileName);
     }
 
     return Result;
 }
 
+// NOTE(alex): Options apply to every file that comes after them on the
+// command line, so each file keeps a copy of the ones it was given with.
+struct compile_options
+{
+    b32 Lazy;
+    b32 WriteObject;
+    execute_mode ExecuteMode;
+    b32 DisablePeephole;
+    s32 Argument;
+    u32 BenchmarkCount;
+    char *CacheDirectory;
+
+    node_stats_mode NodeStatsMode;
+    char *NodeStatsDirectory;
+    u32 NodeStatsSlack;
+
+    char *NodeTraceDirectory;
+    b32 HashStats;
+    b32 PeepholeStats;
+};
+
+struct compile_job
+{
+    char *FileName;
+    compile_options Options;
+
+    // NOTE(alex): Set when the contents were sent by a client of the server,
+    // rather than read from disk.
+    b32 HasContents;
+    string Contents;
+
+    // NOTE(alex): Only used when the output is collected, rather than
+    // written out as it happens.
+    memory_arena Arena;
+    stream Out;
+    stream Errors;
+
+    // NOTE(alex): Set when a routine went over its node budget (or there
+    // was no budget to check against)
+    b32 NodeStatsFailed;
+};
+
+//
+// NOTE(alex): File parsers are handed back here once they're done, together
+// with the routine parsers they pooled, and used again for the next file.
+//
+
+global ticket_mutex GlobalFileParserMutex;
+global parser *GlobalFirstFileParser;
+
+internal parser *GetFileParser(void)
+{
+    BeginTicketMutex(&GlobalFileParserMutex);
+    parser *Parser = GlobalFirstFileParser;
+    if(Parser)
+    {
+        GlobalFirstFileParser = Parser->NextPooled;
+    }
+    EndTicketMutex(&GlobalFileParserMutex);
+
+    if(!Parser)
+    {
+        Parser = BootstrapParser();
+    }
+
+    return Parser;
+}
+
+internal void ReleaseFileParser(parser *Parser)
+{
+    ResetParser(Parser);
+
+    BeginTicketMutex(&GlobalFileParserMutex);
+    Parser->NextPooled = GlobalFirstFileParser;
+    GlobalFirstFileParser = Parser;
+    EndTicketMutex(&GlobalFileParserMutex);
+}
+
+// NOTE(alex): tests/foo.inl goes with [directory]/foo[extension]
+internal void GetOutputFileName(char *FileName, char *Directory, char *Extension,
+                                umm DestSize, char *Dest)
+{
+    char *BaseName = FileName;
+    for(char *At = FileName; *At; ++At)
+    {
+        if((*At == '/') || (*At == '\\'))
+        {
+            BaseName = At + 1;
+        }
+    }
+
+    umm BaseLength = StringLength(BaseName);
+    for(umm At = BaseLength; At--;)
+    {
+        if(BaseName[At] == '.')
+        {
+            BaseLength = At;
+            break;
+        }
+    }
+
+    FormatString(DestSize, Dest, "%s/%.*s%s", Directory, (u32)BaseLength, BaseName, Extension);
+}
+
+internal void CompileFile(compile_job *Job, platform_work_queue *Queue, stream *Out, stream *Errors)
+{
+    TIMED_FUNCTION();
+
+    char *FileName = Job->FileName;
+    compile_options *Options = &Job->Options;
+
+    entire_file ReadResult = {};
+    if(Job->HasContents)
+    {
+        ReadResult.ContentsSize = (u32)Job->Contents.Count;
+        ReadResult.Contents = Job->Contents.Data;
+    }
+    else
+    {
+        ReadResult = ReadEntireFile(FileName, Errors);
+    }
+
+    if(ReadResult.ContentsSize)
+    {
+        tokenizer Tokenizer = Tokenize(BundleString(ReadResult.ContentsSize, (char *)ReadResult.Contents),
+                                       WrapZ(FileName), Errors);
+        parser *Parser = GetFileParser();
+        ParseTopLevelRoutines(Parser, Tokenizer);
+        Parser->Queue = Queue;
+        Parser->Out = Out;
+        Parser->Errors = Errors;
+        Parser->Lazy = Options->Lazy;
+        Parser->DisablePeephole = Options->DisablePeephole;
+        Parser->ExecuteMode = Options->ExecuteMode;
+        Parser->ExecuteArgument = Options->Argument;
+        Parser->BenchmarkCount = Options->BenchmarkCount;
+        if(Options->CacheDirectory)
+        {
+            if(Platform.MakeDirectory(Options->CacheDirectory))
+            {
+                Parser->CacheDirectory = Options->CacheDirectory;
+            }
+            else
+            {
+                Outf(Errors, "Error: Cannot create cache directory \"%s\"\n", Options->CacheDirectory);
+            }
+        }
+
+        if(Options->HashStats)
+        {
+            OutputSymbolHashStats(Parser, Tokenizer, Out);
+        }
+
+        if(Options->WriteObject)
+        {
+            Parser->Object = BeginObject();
+        }
+
+        if(Options->NodeStatsMode != NodeStats_None)
+        {
+            Parser->NodeStats = BeginNodeStats();
+        }
+
+        if(Options->PeepholeStats)
+        {
+            Parser->PeepholeStats = PushPeepholeStats(&Parser->Arena);
+        }
+
+        FILE *NodeTraceFile = 0;
+        stream NodeTrace = {};
+        if(Options->NodeTraceDirectory)
+        {
+            char NodeTraceName[1024];
+            GetOutputFileName(FileName, Options->NodeTraceDirectory, NODE_TRACE_EXTENSION,
+                              sizeof(NodeTraceName), NodeTraceName);
+
+            NodeTraceFile = fopen(NodeTraceName, "wb");
+            if(NodeTraceFile)
+            {
+                NodeTrace = OnBufferedFile(NodeTraceFile, &Parser->Arena);
+                BeginNodeTraceFile(&NodeTrace, Options->DisablePeephole);
+                Parser->NodeTraceOut = &NodeTrace;
+            }
+            else
+            {
+                Outf(Errors, "Error: Cannot write node trace \"%s\"\n", NodeTraceName);
+            }
+        }
+
+        // Parser->Stream = fopen("test.asm", "wb");
+        ParseFile(Parser);
+        // fclose(Parser->Stream);
+
+        if(Parser->Object)
+        {
+            // NOTE(alex): foo.inl becomes foo.o, next to the input
+            umm BaseLength = StringLength(FileName);
+            for(umm At = BaseLength; At--;)
+            {
+                if((FileName[At] == '/') || (FileName[At] == '\\'))
+                {
+                    break;
+                }
+                else if(FileName[At] == '.')
+                {
+                    BaseLength = At;
+                    break;
+                }
+            }
+
+            char ObjectName[1024];
+            FormatString(sizeof(ObjectName), ObjectName, "%.*s.o", (u32)BaseLength, FileName);
+            if(!WriteELFObject(Parser->Object, ObjectName))
+            {
+                Outf(Errors, "Error: Cannot write object file \"%s\"\n", ObjectName);
+            }
+
+            EndObject(Parser->Object);
+            Parser->Object = 0;
+        }
+
+        if(Parser->PeepholeStats)
+        {
+            OutputPeepholeStats(Out, Parser->PeepholeStats);
+            Parser->PeepholeStats = 0;
+        }
+
+        if(NodeTraceFile)
+        {
+            FlushFile(&NodeTrace);
+            fclose(NodeTraceFile);
+            Parser->NodeTraceOut = 0;
+        }
+
+        if(Parser->NodeStats)
+        {
+            char GoldenName[1024];
+            GetOutputFileName(FileName, Options->NodeStatsDirectory, NODE_STATS_EXTENSION,
+                              sizeof(GoldenName), GoldenName);
+            if(Options->NodeStatsMode == NodeStats_Record)
+            {
+                if(!WriteNodeStats(Parser->NodeStats, GoldenName))
+                {
+                    Outf(Errors, "Error: Cannot write golden file \"%s\"\n", GoldenName);
+                }
+            }
+            else if(!CheckNodeStats(Parser->NodeStats, GoldenName, Options->NodeStatsSlack, Out, Errors))
+            {
+                Job->NodeStatsFailed = true;
+            }
+
+            EndNodeStats(Parser->NodeStats);
+            Parser->NodeStats = 0;
+        }
+
+        ReleaseFileParser(Parser);
+    }
+
+    if(!Job->HasContents)
+    {
+        free(ReadResult.Contents);
+    }
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(CompileFileWork)
+{
+    compile_job *Job = (compile_job *)Data;
+    CompileFile(Job, Queue, &Job->Out, &Job->Errors);
+}
+
+// NOTE(alex): A build may well pass thousands of files. The deque they go
+// on is also where the routines of the files compiled on this thread go,
+// so a batch leaves plenty of room for those.
+#define MAX_QUEUED_FILES 1024
+
+internal void CompileFilesOnQueue(platform_work_queue *Queue, u32 JobCount, compile_job *Jobs,
+                                 u32 OutLevel)
+{
+    for(u32 BatchStart = 0; BatchStart < JobCount; BatchStart += MAX_QUEUED_FILES)
+    {
+        u32 BatchEnd = Minimum(JobCount, BatchStart + MAX_QUEUED_FILES);
+        for(u32 JobIndex = BatchStart; JobIndex < BatchEnd; ++JobIndex)
+        {
+            compile_job *Job = Jobs + JobIndex;
+            SetMinimumBlockSize(&Job->Arena, Kilobytes(64));
+            Job->Out = OnMemory(&Job->Arena);
+            Job->Out.Level = OutLevel;
+            Job->Errors = OnMemory(&Job->Arena);
+
+            Platform.AddWorkQueueEntry(Queue, 0, CompileFileWork, Job);
+        }
+
+        Platform.CompleteAllWork(Queue);
+    }
+}
+
+// NOTE(alex): Without a queue the files are compiled one after the other,
+// straight into Out and Errors.
+internal void CompileFiles(platform_work_queue *Queue, u32 JobCount, compile_job *Jobs,
+                           stream *Out, stream *Errors)
+{
+    if(!Queue)
+    {
+        for(u32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+        {
+            CompileFile(Jobs + JobIndex, 0, Out, Errors);
+
+            // NOTE(alex): So a file's errors show up right after its output,
+            // not after the output of every file.
+            FlushFile(Out);
+            FlushFile(Errors);
+        }
+    }
+    else
+    {
+        CompileFilesOnQueue(Queue, JobCount, Jobs, Out->Level);
+
+        // NOTE(alex): Written in the order the files were given, so the
+        // output doesn't depend on which thread finished first.
+        for(u32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+        {
+            compile_job *Job = Jobs + JobIndex;
+            FlushStream(&Job->Out, Out);
+            FlushStream(&Job->Errors, Errors);
+            FlushFile(Out);
+            FlushFile(Errors);
+            Clear(&Job->Arena);
+        }
+    }
+}
+
+// NOTE(alex): What a compile exits with, whether it ran here or on the server
+internal int GetExitCode(u32 JobCount, compile_job *Jobs)
+{
+    int Result = 0;
+    for(u32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+    {
+        if(Jobs[JobIndex].NodeStatsFailed)
+        {
+            Result = 1;
+        }
+    }
+
+    return Result;
+}
+
+internal void OutputRunCacheStats(stream *Out)
+{
+    run_cache *Cache = &GlobalRunCache;
+    if(Cache->HitCount || Cache->MissCount)
+    {
+        Outf(Out, "--- Compile-time run cache: %u hits, %u misses ---\n",
+             Cache->HitCount, Cache->MissCount);
+    }
+}
+
+internal void RunScalingBenchmark(u32 MaxThreadCount, u32 JobCount, compile_job *Jobs)
+{
+    if(MaxThreadCount <= 1)
+    {
+        MaxThreadCount = Platform.GetProcessorCount();
+    }
+
+    // NOTE(alex): A handful of small files isn't enough work to split up, so
+    // the list gets repeated until there is.
+    u32 MinimumCompileCount = 256;
+    u32 RepeatCount = (MinimumCompileCount + JobCount - 1) / JobCount;
+    u32 CompileCount = RepeatCount*JobCount;
+    compile_job *Compiles = (compile_job *)calloc(CompileCount, sizeof(compile_job));
+    for(u32 CompileIndex = 0; CompileIndex < CompileCount; ++CompileIndex)
+    {
+        compile_job *Source = Jobs + (CompileIndex % JobCount);
+        Compiles[CompileIndex].FileName = Source->FileName;
+        Compiles[CompileIndex].Options = Source->Options;
+        Compiles[CompileIndex].Options.WriteObject = false;
+    }
+
+    stream Out = OnFile(stdout);
+    Outf(&Out, "--- Compiling %u files %u times on up to %u threads ---\n", JobCount, RepeatCount, MaxThreadCount);
+
+    u64 BaselineCycles = 0;
+    for(u32 ThreadCount = 1;; ThreadCount *= 2)
+    {
+        if(ThreadCount > MaxThreadCount)
+        {
+            ThreadCount = MaxThreadCount;
+        }
+
+        platform_work_queue *Queue = Platform.CreateWorkQueue(ThreadCount);
+
+        u64 StartCycles = __rdtsc();
+        CompileFilesOnQueue(Queue, CompileCount, Compiles, StreamLevel_Normal);
+        u64 TotalCycles = __rdtsc() - StartCycles;
+
+        Platform.DestroyWorkQueue(Queue);
+
+        for(u32 CompileIndex = 0; CompileIndex < CompileCount; ++CompileIndex)
+        {
+            Clear(&Compiles[CompileIndex].Arena);
+        }
+
+        if(ThreadCount == 1)
+        {
+            BaselineCycles = TotalCycles;
+        }
+
+        Outf(&Out, "%3u threads: %10llu kcycles, %5.2fx\n", ThreadCount, TotalCycles / 1000,
+             (f64)BaselineCycles / (f64)TotalCycles);
+
+        if(ThreadCount == MaxThreadCount)
+        {
+            break;
+        }
+    }
+
+    free(Compiles);
+}
+
+/* NOTE(alex): The server compiles whatever its clients send it, one request
+   at a time, keeping everything it can between requests: the work queue and
+   its threads, the parsers and the memory they've already touched, and the
+   compile-time run cache.
+
+   A request is the client's arguments, followed by the contents of every
+   file they name, which the client reads itself. The server never looks at
+   the input files, but it does write objects and cache files relative to
+   where it was started. The response is the exit code the compile would
+   have had, then everything it wrote to standard output, and then
+   everything it wrote to standard error. So the client prints all of the
+   errors after all of the output, rather than mixed in where they
+   happened, the way a compile of its own would.
+*/
+
+#define SERVER_MAGIC 0x53474C4D // NOTE(alex): "MLGS"
+#define SERVER_DEFAULT_SOCKET_PATH "metalang.sock"
+
+// NOTE(alex): Requests are limited so a bad client can't make us allocate
+// whatever it likes.
+#define SERVER_MAX_REQUEST_SIZE Megabytes(256)
+
+struct server_request
+{
+    u32 Magic;
+    u32 Version;
+
+    // NOTE(alex): The arguments come first, each of them zero terminated.
+    // Then, for each file named in them, a u32 size and the contents. A
+    // file the client couldn't read is sent with a size of zero.
+    u32 ArgumentCount;
+    u32 Size;
+};
+
+struct server_response
+{
+    u32 Magic;
+    s32 ExitCode;
+    u32 OutSize;
+    u32 ErrorSize;
+};
+
 internal void ShowAvailableArguments(void)
 {
     fprintf(stderr, "Available arguments:\n\n");
     fprintf(stderr, "-exec            Executes the program immediately after compiling.\n");
+    fprintf(stderr, "-exec-graph      Executes the program by interpreting the graph directly.\n");
+    fprintf(stderr, "-arg [value]     The value of arg when executing (default 0).\n");
+    fprintf(stderr, "-bench [count]   Times [count] extra runs when executing.\n");
+    fprintf(stderr, "-nopeephole      Disables the peephole optimizations, as a baseline.\n");
+    fprintf(stderr, "-vmbench [count] Measures VM dispatch with a loop of [count] iterations.\n");
+    fprintf(stderr, "-obj             Writes an x64 ELF object next to each input file.\n");
+    fprintf(stderr, "-lazy            Only compiles the routines reachable from Main.\n");
+    fprintf(stderr, "-cache [dir]     Keeps each routine's graph in [dir] and reuses it while unchanged.\n");
+    fprintf(stderr, "-nodes-record [dir] Writes the live nodes of every routine to [dir]/[file].nodes.\n");
+    fprintf(stderr, "-nodes-check [dir] Fails routines with more live nodes than [dir]/[file].nodes says.\n");
+    fprintf(stderr, "-nodes-slack [percent] How much -nodes-check lets a routine grow (default 0).\n");
+    fprintf(stderr, "-trace-nodes [dir] Writes every node operation of the parser to [dir]/[file].trace.\n");
+    fprintf(stderr, "-replay [file]   Replays a -trace-nodes trace without parsing, best of -benchmark runs.\n");
+    fprintf(stderr, "-hashstats       Prints how the names in each file spread over their hash tables.\n");
+    fprintf(stderr, "-peepstats       Prints how often each peephole fired in each file, and what it cost.\n");
+    fprintf(stderr, "-j [count]       Compiles the files on [count] threads (0 for one per core).\n");
+    fprintf(stderr, "-gen [file] [routines] [locals] [depth] [size]\n"
+                    "                 Writes a generated program to [file], for benchmarking.\n");
+    fprintf(stderr, "-gen-table [file] [routines] [rows]\n"
+                    "                 Writes a program of nothing but big constants to [file].\n");
+    fprintf(stderr, "-benchmark [count] Times each phase of compiling the files, best of [count] runs.\n");
+    fprintf(stderr, "-csv [file]      Appends the -benchmark results to [file].\n");
+    fprintf(stderr, "-label [name]    What the -csv rows are labeled with (default the version).\n");
+    fprintf(stderr, "-scaling         Times compiling the files on 1, 2, 4, ... threads, up to -j.\n");
+    fprintf(stderr, "-v               Also prints the control nodes and register allocation of every routine.\n");
+    fprintf(stderr, "-vv              Like -v, and also every variable at the end of every scope.\n");
+    fprintf(stderr, "-time            Prints where the compiler spent its cycles, by block and routine.\n");
+    fprintf(stderr, "-time-trace [file] Like -time, and also writes a Chrome trace to [file].\n");
+    fprintf(stderr, "-server          Stays running and compiles what clients send, on -j threads.\n");
+    fprintf(stderr, "--client         Has the server compile the files, instead of starting up.\n");
+    fprintf(stderr, "-socket [path]   The socket of the server (default %s).\n", SERVER_DEFAULT_SOCKET_PATH);
     fprintf(stderr, "-version         Print the version of the compiler.\n");
 }
 
-int main(int ArgCount, char **Args)
+struct command_line
 {
-    SetDefaultFPBehavior();
+    compile_options Options;
+    u32 ThreadCount;
+    b32 MeasureScaling;
 
-    if(ArgCount > 1)
+    u32 BenchmarkRunCount;
+    char *BenchmarkCSV;
+    char *BenchmarkLabel;
+    char *ReplayFileName;
+
+    // NOTE(alex): How much of the compiler's insides get printed
+    u32 OutLevel;
+
+    b32 Profile;
+    char *TraceFileName;
+
+    b32 Serve;
+    b32 Client;
+    char *SocketPath;
+
+    // NOTE(alex): Things like -help that do their thing right away. The
+    // server turns these off, the client already did them.
+    b32 RunImmediateArguments;
+
+    // NOTE(alex): Has to have room for one job per argument
+    u32 JobCount;
+    compile_job *Jobs;
+};
+
+internal void ParseCommandLine(command_line *CommandLine, int ArgCount, char **Args)
+{
+    compile_options Options = {};
+
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
     {
-        for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+        char *FileName = Args[ArgIndex];
+
+        if(StringsAreEqual(FileName, "-exec"))
+        {
+            Options.ExecuteMode = Execute_Bytecode;
+        }
+        else if(StringsAreEqual(FileName, "-exec-graph"))
+        {
+            Options.ExecuteMode = Execute_Graph;
+        }
+        else if(StringsAreEqual(FileName, "-vmbench") && ((ArgIndex + 1) < ArgCount))
+        {
+            u32 IterationCount = (u32)S32FromZ(Args[++ArgIndex]);
+            if(CommandLine->RunImmediateArguments)
+            {
+                RunDispatchBenchmark(IterationCount);
+            }
+        }
+        else if(StringsAreEqual(FileName, "-arg") && ((ArgIndex + 1) < ArgCount))
+        {
+            Options.Argument = S32FromZ(Args[++ArgIndex]);
+        }
+        else if(StringsAreEqual(FileName, "-bench") && ((ArgIndex + 1) < ArgCount))
+        {
+            Options.BenchmarkCount = (u32)S32FromZ(Args[++ArgIndex]);
+        }
+        else if(StringsAreEqual(FileName, "-nopeephole"))
+        {
+            Options.DisablePeephole = true;
+        }
+        else if(StringsAreEqual(FileName, "-obj"))
+        {
+            Options.WriteObject = true;
+        }
+        else if(StringsAreEqual(FileName, "-lazy"))
+        {
+            Options.Lazy = true;
+        }
+        else if(StringsAreEqual(FileName, "-cache") && ((ArgIndex + 1) < ArgCount))
+        {
+            Options.CacheDirectory = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-nodes-record") && ((ArgIndex + 1) < ArgCount))
         {
-            char *FileName = Args[ArgIndex];
+            Options.NodeStatsMode = NodeStats_Record;
+            Options.NodeStatsDirectory = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-nodes-check") && ((ArgIndex + 1) < ArgCount))
+        {
+            Options.NodeStatsMode = NodeStats_Check;
+            Options.NodeStatsDirectory = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-nodes-slack") && ((ArgIndex + 1) < ArgCount))
+        {
+            s32 Slack = S32FromZ(Args[++ArgIndex]);
+            Options.NodeStatsSlack = (Slack > 0) ? (u32)Slack : 0;
+        }
+        else if(StringsAreEqual(FileName, "-trace-nodes") && ((ArgIndex + 1) < ArgCount))
+        {
+            Options.NodeTraceDirectory = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-replay") && ((ArgIndex + 1) < ArgCount))
+        {
+            CommandLine->ReplayFileName = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-hashstats"))
+        {
+            Options.HashStats = true;
+        }
+        else if(StringsAreEqual(FileName, "-peepstats"))
+        {
+            Options.PeepholeStats = true;
+        }
+        else if(StringsAreEqual(FileName, "-j") && ((ArgIndex + 1) < ArgCount))
+        {
+            s32 Count = S32FromZ(Args[++ArgIndex]);
+            CommandLine->ThreadCount = (Count > 0) ? (u32)Count : Platform.GetProcessorCount();
+        }
+        else if(StringsAreEqual(FileName, "-gen") && ((ArgIndex + 5) < ArgCount))
+        {
+            char *GenerateFileName = Args[++ArgIndex];
+
+            program_generator_params Params = {};
+            Params.RoutineCount = (u32)S32FromZ(Args[++ArgIndex]);
+            Params.LocalCount = (u32)S32FromZ(Args[++ArgIndex]);
+            Params.Depth = (u32)S32FromZ(Args[++ArgIndex]);
+            Params.ExpressionSize = (u32)S32FromZ(Args[++ArgIndex]);
+            Params.Seed = 1;
 
-            if(StringsAreEqual(FileName, "-exec"))
+            if(CommandLine->RunImmediateArguments)
             {
+                FILE *File = fopen(GenerateFileName, "wb");
+                if(File)
+                {
+                    stream Out = OnFile(File);
+                    GenerateProgram(&Out, &Params);
+                    fclose(File);
+                }
+                else
+                {
+                    fprintf(stderr, "Error: Cannot write generated program \"%s\"\n", GenerateFileName);
+                }
             }
-            else if(StringsAreEqual(FileName, "-help"))
+        }
+        else if(StringsAreEqual(FileName, "-gen-table") && ((ArgIndex + 3) < ArgCount))
+        {
+            char *GenerateFileName = Args[++ArgIndex];
+
+            program_generator_params Params = {};
+            Params.RoutineCount = (u32)S32FromZ(Args[++ArgIndex]);
+            Params.LocalCount = (u32)S32FromZ(Args[++ArgIndex]);
+            Params.Seed = 1;
+
+            if(CommandLine->RunImmediateArguments)
+            {
+                FILE *File = fopen(GenerateFileName, "wb");
+                if(File)
+                {
+                    stream Out = OnFile(File);
+                    GenerateConstantTable(&Out, &Params);
+                    fclose(File);
+                }
+                else
+                {
+                    fprintf(stderr, "Error: Cannot write generated program \"%s\"\n", GenerateFileName);
+                }
+            }
+        }
+        else if(StringsAreEqual(FileName, "-benchmark") && ((ArgIndex + 1) < ArgCount))
+        {
+            s32 Count = S32FromZ(Args[++ArgIndex]);
+            CommandLine->BenchmarkRunCount = (Count > 0) ? (u32)Count : 1;
+        }
+        else if(StringsAreEqual(FileName, "-csv") && ((ArgIndex + 1) < ArgCount))
+        {
+            CommandLine->BenchmarkCSV = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-label") && ((ArgIndex + 1) < ArgCount))
+        {
+            CommandLine->BenchmarkLabel = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-scaling"))
+        {
+            CommandLine->MeasureScaling = true;
+        }
+        else if(StringsAreEqual(FileName, "-v"))
+        {
+            CommandLine->OutLevel = StreamLevel_Graph;
+        }
+        else if(StringsAreEqual(FileName, "-vv"))
+        {
+            CommandLine->OutLevel = StreamLevel_Scopes;
+        }
+        else if(StringsAreEqual(FileName, "-time"))
+        {
+            CommandLine->Profile = true;
+        }
+        else if(StringsAreEqual(FileName, "-time-trace") && ((ArgIndex + 1) < ArgCount))
+        {
+            CommandLine->Profile = true;
+            CommandLine->TraceFileName = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-server"))
+        {
+            CommandLine->Serve = true;
+        }
+        else if(StringsAreEqual(FileName, "--client"))
+        {
+            CommandLine->Client = true;
+        }
+        else if(StringsAreEqual(FileName, "-socket") && ((ArgIndex + 1) < ArgCount))
+        {
+            CommandLine->SocketPath = Args[++ArgIndex];
+        }
+        else if(StringsAreEqual(FileName, "-help"))
+        {
+            if(CommandLine->RunImmediateArguments)
             {
                 ShowAvailableArguments();
             }
-            else if(StringsAreEqual(FileName, "-version"))
+        }
+        else if(StringsAreEqual(FileName, "-version"))
+        {
+            if(CommandLine->RunImmediateArguments)
             {
                 fprintf(stderr, "Version: %s, built on %s\n", METALANG_VERSION_STRING, __DATE__);
             }
+        }
+        else
+        {
+            compile_job *Job = CommandLine->Jobs + CommandLine->JobCount++;
+            Job->FileName = FileName;
+            Job->Options = Options;
+        }
+    }
+}
+
+internal void RunCompileBenchmark(command_line *CommandLine)
+{
+    stream Out = OnFile(stdout);
+    stream Errors = OnFile(stderr);
+
+    char const *Label = CommandLine->BenchmarkLabel ? CommandLine->BenchmarkLabel : METALANG_VERSION_STRING;
+    u32 RunCount = CommandLine->BenchmarkRunCount;
+
+    for(u32 JobIndex = 0; JobIndex < CommandLine->JobCount; ++JobIndex)
+    {
+        compile_job *Job = CommandLine->Jobs + JobIndex;
+
+        entire_file File = ReadEntireFile(Job->FileName, &Errors);
+        if(File.ContentsSize)
+        {
+            benchmark_result Result;
+            BenchmarkCompile(BundleString(File.ContentsSize, (char *)File.Contents), WrapZ(Job->FileName),
+                             Job->Options.DisablePeephole, RunCount, &Result);
+
+            OutputBenchmarkResult(&Out, Job->FileName, RunCount, &Result);
+            if(CommandLine->BenchmarkCSV &&
+               !AppendBenchmarkCSV(CommandLine->BenchmarkCSV, Label, Job->FileName, &Result))
+            {
+                Outf(&Errors, "Error: Cannot write benchmark results to \"%s\"\n", CommandLine->BenchmarkCSV);
+            }
+        }
+
+        free(File.Contents);
+    }
+}
+
+internal void RunNodeTraceReplay(command_line *CommandLine)
+{
+    stream Out = OnFile(stdout);
+    stream Errors = OnFile(stderr);
+
+    char *FileName = CommandLine->ReplayFileName;
+    u32 RunCount = Maximum(CommandLine->BenchmarkRunCount, 1);
+
+    entire_file File = ReadEntireFile(FileName, &Errors);
+    if(File.ContentsSize)
+    {
+        node_trace_replay_result Result;
+        ReplayNodeTrace(BundleString(File.ContentsSize, (char *)File.Contents), RunCount, &Result);
+
+        if(Result.Valid)
+        {
+            OutputNodeTraceReplay(&Out, FileName, RunCount, &Result);
+        }
+        else
+        {
+            Outf(&Errors, "Error: \"%s\" isn't a complete node trace from this version of the compiler\n", FileName);
+        }
+    }
+
+    free(File.Contents);
+}
+
+internal b32 SendStream(platform_socket Socket, stream *Source)
+{
+    b32 Result = true;
+    for(stream_chunk *Chunk = Source->First; Result && Chunk; Chunk = Chunk->Next)
+    {
+        Result = Platform.SendToSocket(Socket, Chunk->Count, Chunk->Data);
+    }
+
+    return Result;
+}
+
+internal void ServeRequest(platform_socket Client, platform_work_queue *Queue, memory_arena *Arena)
+{
+    temporary_memory RequestMemory = BeginTemporaryMemory(Arena);
+
+    server_request Request = {};
+    if(Platform.ReceiveFromSocket(Client, sizeof(Request), &Request) &&
+       (Request.Magic == SERVER_MAGIC) &&
+       (Request.Version == METALANG_VERSION) &&
+       (Request.Size <= SERVER_MAX_REQUEST_SIZE) &&
+       (Request.ArgumentCount <= Request.Size))
+    {
+        u8 *Payload = PushArray(Arena, Request.Size + 1, u8, NoClear());
+        Payload[Request.Size] = 0;
+
+        if(Platform.ReceiveFromSocket(Client, Request.Size, Payload))
+        {
+            u8 *At = Payload;
+            u8 *End = Payload + Request.Size;
+
+            // NOTE(alex): Args[0] is the program name, which nobody looks at
+            int ArgCount = Request.ArgumentCount + 1;
+            char **Args = PushArray(Arena, ArgCount, char *);
+            for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+            {
+                Args[ArgIndex] = (char *)At;
+                while((At < End) && *At)
+                {
+                    ++At;
+                }
+
+                if(At < End)
+                {
+                    ++At;
+                }
+            }
+
+            command_line CommandLine = {};
+            CommandLine.Jobs = PushArray(Arena, ArgCount, compile_job);
+            ParseCommandLine(&CommandLine, ArgCount, Args);
+
+            for(u32 JobIndex = 0; JobIndex < CommandLine.JobCount; ++JobIndex)
+            {
+                compile_job *Job = CommandLine.Jobs + JobIndex;
+                Job->HasContents = true;
+
+                u32 Size = 0;
+                if((umm)(End - At) >= sizeof(Size))
+                {
+                    Copy(sizeof(Size), At, &Size);
+                    At += sizeof(Size);
+                }
+
+                if(Size <= (umm)(End - At))
+                {
+                    Job->Contents = BundleString(Size, (char *)At);
+                    At += Size;
+                }
+            }
+
+            stream Out = OnMemory(Arena);
+            Out.Level = CommandLine.OutLevel;
+            stream Errors = OnMemory(Arena);
+
+            run_cache *Cache = &GlobalRunCache;
+            if(GetArenaSize(&Cache->Arena) > RUN_CACHE_MAX_SIZE)
+            {
+                ResetRunCache(Cache);
+            }
+            Cache->HitCount = Cache->MissCount = 0;
+
+            CompileFiles(Queue, CommandLine.JobCount, CommandLine.Jobs, &Out, &Errors);
+            OutputRunCacheStats(&Out);
+
+            server_response Response = {};
+            Response.Magic = SERVER_MAGIC;
+            Response.ExitCode = GetExitCode(CommandLine.JobCount, CommandLine.Jobs);
+            Response.OutSize = (u32)GetStreamSize(&Out);
+            Response.ErrorSize = (u32)GetStreamSize(&Errors);
+
+            if(Platform.SendToSocket(Client, sizeof(Response), &Response))
+            {
+                SendStream(Client, &Out);
+                SendStream(Client, &Errors);
+            }
+        }
+    }
+
+    EndTemporaryMemory(RequestMemory);
+}
+
+internal void RunServer(char *SocketPath, u32 ThreadCount)
+{
+    platform_socket Listener = Platform.OpenServerSocket(SocketPath);
+    if(Listener.Valid)
+    {
+        platform_work_queue *Queue = 0;
+        if(ThreadCount > 1)
+        {
+            Queue = Platform.CreateWorkQueue(ThreadCount);
+        }
+
+        // NOTE(alex): Big enough that most requests never need a second block
+        memory_arena Arena = {};
+        SetMinimumBlockSize(&Arena, Megabytes(16));
+
+        fprintf(stderr, "--- Serving on \"%s\" with %u threads ---\n", SocketPath, ThreadCount);
+
+        for(;;)
+        {
+            platform_socket Client = Platform.AcceptConnection(Listener);
+            if(Client.Valid)
+            {
+                ServeRequest(Client, Queue, &Arena);
+                Platform.CloseSocket(Client);
+            }
+        }
+    }
+    else
+    {
+        fprintf(stderr, "Error: Cannot listen on \"%s\"\n", SocketPath);
+    }
+}
+
+internal b32 ReceiveAndWrite(platform_socket Socket, u32 Size, FILE *Dest)
+{
+    b32 Result = true;
+
+    u8 Buffer[Kilobytes(16)];
+    while(Result && Size)
+    {
+        u32 ChunkSize = Minimum(Size, (u32)sizeof(Buffer));
+        Result = Platform.ReceiveFromSocket(Socket, ChunkSize, Buffer);
+        if(Result)
+        {
+            fwrite(Buffer, ChunkSize, 1, Dest);
+            Size -= ChunkSize;
+        }
+    }
+
+    return Result;
+}
+
+// NOTE(alex): Returns the exit code of the compile on the server, or 1 when
+// there was no compile to get one from.
+internal int RunClient(command_line *CommandLine, int ArgCount, char **Args)
+{
+    int Result = 1;
+
+    platform_socket Server = Platform.ConnectToServer(CommandLine->SocketPath);
+    if(Server.Valid)
+    {
+        stream Errors = OnFile(stderr);
+
+        // NOTE(alex): Files that can't be read are reported here, and sent
+        // as empty, which the server just skips.
+        entire_file *Files = (entire_file *)calloc(CommandLine->JobCount + 1, sizeof(entire_file));
+
+        server_request Request = {};
+        Request.Magic = SERVER_MAGIC;
+        Request.Version = METALANG_VERSION;
+        Request.ArgumentCount = ArgCount - 1;
+        for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+        {
+            Request.Size += StringLength(Args[ArgIndex]) + 1;
+        }
+
+        for(u32 JobIndex = 0; JobIndex < CommandLine->JobCount; ++JobIndex)
+        {
+            Files[JobIndex] = ReadEntireFile(CommandLine->Jobs[JobIndex].FileName, &Errors);
+            Request.Size += sizeof(u32) + Files[JobIndex].ContentsSize;
+        }
+
+        b32 Sent = Platform.SendToSocket(Server, sizeof(Request), &Request);
+        for(int ArgIndex = 1; Sent && (ArgIndex < ArgCount); ++ArgIndex)
+        {
+            Sent = Platform.SendToSocket(Server, StringLength(Args[ArgIndex]) + 1, Args[ArgIndex]);
+        }
+
+        for(u32 JobIndex = 0; Sent && (JobIndex < CommandLine->JobCount); ++JobIndex)
+        {
+            entire_file *File = Files + JobIndex;
+            Sent = (Platform.SendToSocket(Server, sizeof(File->ContentsSize), &File->ContentsSize) &&
+                    Platform.SendToSocket(Server, File->ContentsSize, File->Contents));
+        }
+
+        server_response Response = {};
+        b32 Received = (Sent &&
+                        Platform.ReceiveFromSocket(Server, sizeof(Response), &Response) &&
+                        (Response.Magic == SERVER_MAGIC) &&
+                        ReceiveAndWrite(Server, Response.OutSize, stdout) &&
+                        ReceiveAndWrite(Server, Response.ErrorSize, stderr));
+        if(Received)
+        {
+            Result = Response.ExitCode;
+        }
+        else
+        {
+            fprintf(stderr, "Error: Lost the connection to the compile server\n");
+        }
+
+        for(u32 JobIndex = 0; JobIndex < CommandLine->JobCount; ++JobIndex)
+        {
+            free(Files[JobIndex].Contents);
+        }
+        free(Files);
+
+        Platform.CloseSocket(Server);
+    }
+    else
+    {
+        fprintf(stderr, "Error: Cannot connect to the compile server at \"%s\"\n", CommandLine->SocketPath);
+    }
+
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    SetDefaultFPBehavior();
+    BuildPeepholeMatcher();
+
+    // NOTE(alex): So scripts like test.bat can tell a failed check apart
+    int ExitCode = 0;
+
+    if(ArgCount > 1)
+    {
+        command_line CommandLine = {};
+        CommandLine.ThreadCount = 1;
+        CommandLine.SocketPath = SERVER_DEFAULT_SOCKET_PATH;
+        CommandLine.RunImmediateArguments = true;
+        CommandLine.Jobs = (compile_job *)calloc(ArgCount, sizeof(compile_job));
+
+        ParseCommandLine(&CommandLine, ArgCount, Args);
+
+        u32 JobCount = CommandLine.JobCount;
+        compile_job *Jobs = CommandLine.Jobs;
+
+        if(CommandLine.Serve)
+        {
+            RunServer(CommandLine.SocketPath, CommandLine.ThreadCount);
+        }
+        else if(CommandLine.Client)
+        {
+            ExitCode = RunClient(&CommandLine, ArgCount, Args);
+        }
+        else if(CommandLine.ReplayFileName)
+        {
+            RunNodeTraceReplay(&CommandLine);
+        }
+        else if(JobCount)
+        {
+            if(CommandLine.MeasureScaling)
+            {
+                RunScalingBenchmark(CommandLine.ThreadCount, JobCount, Jobs);
+            }
+            else if(CommandLine.BenchmarkRunCount)
+            {
+                RunCompileBenchmark(&CommandLine);
+            }
             else
             {
-                entire_file ReadResult = ReadEntireFile(FileName);
-                if(ReadResult.ContentsSize)
+                platform_work_queue *Queue = 0;
+                if(CommandLine.ThreadCount > 1)
+                {
+                    Queue = Platform.CreateWorkQueue(CommandLine.ThreadCount);
+                }
+
+                if(CommandLine.Profile)
+                {
+                    BeginProfile(CommandLine.TraceFileName != 0);
+                }
+
+                memory_arena StreamArena = {};
+                stream Out = OnBufferedFile(stdout, &StreamArena);
+                Out.Level = CommandLine.OutLevel;
+                stream Errors = OnBufferedFile(stderr, &StreamArena);
+                CompileFiles(Queue, JobCount, Jobs, &Out, &Errors);
+                OutputRunCacheStats(&Out);
+                ExitCode = GetExitCode(JobCount, Jobs);
+
+                if(CommandLine.Profile)
                 {
-                    tokenizer Tokenizer = Tokenize(BundleString(ReadResult.ContentsSize, (char *)ReadResult.Contents),
-                                                   WrapZ(FileName));
-                    parser *Parser = ParseTopLevelRoutines(Tokenizer);
-                    // Parser->Stream = fopen("test.asm", "wb");
-                    ParseFile(Parser, Tokenizer);
-                    // fclose(Parser->Stream);
+                    OutputProfile(&Out);
+                    if(CommandLine.TraceFileName &&
+                       !WriteProfileTrace(CommandLine.TraceFileName))
+                    {
+                        Outf(&Errors, "Error: Cannot write trace file \"%s\"\n", CommandLine.TraceFileName);
+                    }
+                }
+
+                FlushFile(&Out);
+                FlushFile(&Errors);
+                Clear(&StreamArena);
+
+                if(Queue)
+                {
+                    Platform.DestroyWorkQueue(Queue);
                 }
             }
         }
+
+        free(Jobs);
     }
     else
     {
         fprintf(stderr, "Usage: %s [input file] ...\n", Args[0]);
     }
 
-    return 0;
+    return ExitCode;
 }
@@ -0,0 +1,459 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+struct random_series
+{
+    u32 State;
+};
+
+inline random_series RandomSeed(u32 Seed)
+{
+    random_series Result;
+    Result.State = Seed ? Seed : 1;
+    return Result;
+}
+
+inline u32 RandomNext(random_series *Series)
+{
+    // NOTE(alex): xorshift32, which is plenty for picking what to write
+    u32 Result = Series->State;
+    Result ^= Result << 13;
+    Result ^= Result >> 17;
+    Result ^= Result << 5;
+    Series->State = Result;
+
+    return Result;
+}
+
+inline u32 RandomChoice(random_series *Series, u32 Count)
+{
+    u32 Result = RandomNext(Series) % Count;
+    return Result;
+}
+
+internal void OutputIndent(stream *Out, u32 Indent)
+{
+    // NOTE(alex): Outf doesn't pad empty strings, so no %*s for this
+    for(u32 Space = 0; Space < Indent; ++Space)
+    {
+        Outf(Out, " ");
+    }
+}
+
+// NOTE(alex): Only locals below VisibleCount have been declared yet
+internal void GenerateExpression(stream *Out, random_series *Series, u32 VisibleCount, u32 Size)
+{
+    if(Size <= 1)
+    {
+        u32 Choice = RandomChoice(Series, 6);
+        if(VisibleCount && (Choice < 3))
+        {
+            Outf(Out, "L%u", RandomChoice(Series, VisibleCount));
+        }
+        else if(Choice == 3)
+        {
+            Outf(Out, "arg");
+        }
+        else if(Choice == 4)
+        {
+            Outf(Out, "-%u", RandomChoice(Series, 100));
+        }
+        else
+        {
+            Outf(Out, "%u", RandomChoice(Series, 100));
+        }
+    }
+    else
+    {
+        u32 LeftSize = 1 + RandomChoice(Series, Size - 1);
+        u32 RightSize = Size - LeftSize;
+
+        char *Operators[] = {" + ", " - ", " + ", " - ", "*", " < "};
+        char *Operator = Operators[RandomChoice(Series, ArrayCount(Operators))];
+
+        Outf(Out, "%s", (LeftSize > 1) ? "(" : "");
+        GenerateExpression(Out, Series, VisibleCount, LeftSize);
+        Outf(Out, "%s%s", (LeftSize > 1) ? ")" : "", Operator);
+        Outf(Out, "%s", (RightSize > 1) ? "(" : "");
+        GenerateExpression(Out, Series, VisibleCount, RightSize);
+        Outf(Out, "%s", (RightSize > 1) ? ")" : "");
+    }
+}
+
+internal void GenerateBlock(stream *Out, random_series *Series, program_generator_params *Params,
+                            u32 Depth, u32 Indent)
+{
+    u32 LocalCount = Params->LocalCount;
+
+    // NOTE(alex): Half of the locals get shadowed in every block, and
+    // assignments then hit a mix of the shadows and the outer locals.
+    u32 ShadowCount = LocalCount / 2;
+    u32 FirstShadow = RandomChoice(Series, LocalCount);
+    for(u32 ShadowIndex = 0; ShadowIndex < ShadowCount; ++ShadowIndex)
+    {
+        OutputIndent(Out, Indent);
+        Outf(Out, "s32 L%u = ", (FirstShadow + ShadowIndex) % LocalCount);
+        GenerateExpression(Out, Series, LocalCount, Params->ExpressionSize);
+        Outf(Out, ";\n");
+    }
+
+    for(u32 AssignIndex = 0; AssignIndex < ShadowCount; ++AssignIndex)
+    {
+        OutputIndent(Out, Indent);
+        Outf(Out, "L%u = ", RandomChoice(Series, LocalCount));
+        GenerateExpression(Out, Series, LocalCount, Params->ExpressionSize);
+        Outf(Out, ";\n");
+    }
+
+    if(Depth)
+    {
+        OutputIndent(Out, Indent);
+        Outf(Out, "if(");
+        GenerateExpression(Out, Series, LocalCount, Params->ExpressionSize);
+        Outf(Out, ")\n");
+        OutputIndent(Out, Indent);
+        Outf(Out, "{\n");
+        GenerateBlock(Out, Series, Params, Depth - 1, Indent + 4);
+        OutputIndent(Out, Indent);
+        Outf(Out, "}\n");
+        OutputIndent(Out, Indent);
+        Outf(Out, "else\n");
+        OutputIndent(Out, Indent);
+        Outf(Out, "{\n");
+        GenerateBlock(Out, Series, Params, Depth - 1, Indent + 4);
+        OutputIndent(Out, Indent);
+        Outf(Out, "}\n");
+    }
+}
+
+internal void GenerateProgram(stream *Out, program_generator_params *Params)
+{
+    random_series Series = RandomSeed(Params->Seed);
+
+    // NOTE(alex): Every routine needs at least one local to refer to
+    program_generator_params Fixed = *Params;
+    Fixed.LocalCount = Maximum(Fixed.LocalCount, 1);
+    Fixed.ExpressionSize = Maximum(Fixed.ExpressionSize, 1);
+
+    Outf(Out, "// NOTE: Generated by metalang -gen with %u routines, %u locals, depth %u, "
+         "expressions of %u, seed %u\n\n",
+         Fixed.RoutineCount, Fixed.LocalCount, Fixed.Depth, Fixed.ExpressionSize, Fixed.Seed);
+
+    for(u32 RoutineIndex = 0; RoutineIndex < Fixed.RoutineCount; ++RoutineIndex)
+    {
+        Outf(Out, "s32 Routine%u()\n{\n", RoutineIndex);
+
+        for(u32 LocalIndex = 0; LocalIndex < Fixed.LocalCount; ++LocalIndex)
+        {
+            Outf(Out, "    s32 L%u = ", LocalIndex);
+            GenerateExpression(Out, &Series, LocalIndex, Fixed.ExpressionSize);
+            Outf(Out, ";\n");
+        }
+
+        // NOTE(alex): The locals above are already in the routine's scope,
+        // so the shadowing starts in a block of its own.
+        Outf(Out, "    {\n");
+        GenerateBlock(Out, &Series, &Fixed, Fixed.Depth, 8);
+        Outf(Out, "    }\n");
+
+        Outf(Out, "    Result = ");
+        GenerateExpression(Out, &Series, Fixed.LocalCount, Fixed.ExpressionSize);
+        Outf(Out, ";\n}\n\n");
+    }
+
+    Outf(Out, "Main()\n{\n    s32 X = arg;\n    X;\n}\n");
+}
+
+// NOTE(alex): Routines that are nothing but big constants, in decimal, hex
+// and binary, so the tokenizer's numbers are most of the work.
+internal void GenerateConstantTable(stream *Out, program_generator_params *Params)
+{
+    random_series Series = RandomSeed(Params->Seed);
+
+    Outf(Out, "// NOTE: Generated by metalang -gen-table with %u routines of %u rows, seed %u\n\n",
+         Params->RoutineCount, Params->LocalCount, Params->Seed);
+
+    for(u32 RoutineIndex = 0; RoutineIndex < Params->RoutineCount; ++RoutineIndex)
+    {
+        Outf(Out, "s32 Table%u()\n{\n    s32 L0 = %u;\n", RoutineIndex, RandomNext(&Series));
+
+        for(u32 RowIndex = 1; RowIndex < Params->LocalCount; ++RowIndex)
+        {
+            // NOTE(alex): Not straight in the arguments, which could be
+            // evaluated in either order.
+            u32 Decimal = RandomNext(&Series);
+            u32 Hex = RandomNext(&Series);
+            Outf(Out, "    s32 L%u = L%u + %u - 0x%08X", RowIndex, RowIndex - 1, Decimal, Hex);
+
+            if((RowIndex % 4) == 0)
+            {
+                char Binary[33];
+                u32 Value = RandomNext(&Series);
+                for(u32 Bit = 0; Bit < 32; ++Bit)
+                {
+                    Binary[Bit] = (Value & (0x80000000 >> Bit)) ? '1' : '0';
+                }
+                Binary[32] = 0;
+                Outf(Out, " + 0b%s", Binary);
+            }
+
+            Outf(Out, ";\n");
+        }
+
+        Outf(Out, "    Result = L%u;\n}\n\n", Maximum(Params->LocalCount, 1) - 1);
+    }
+
+    Outf(Out, "Main()\n{\n    s32 X = arg;\n    X;\n}\n");
+}
+
+//
+// NOTE(alex): The benchmark goes through the same steps as ParseFile and
+// ParseRoutine, minus the debug output, but one routine at a time on this
+// thread, so each step can be timed on its own.
+//
+
+struct benchmark_timer
+{
+    u64 StartCycles;
+    benchmark_phase_result *Phase;
+};
+
+inline benchmark_timer BeginBenchmarkPhase(benchmark_phase_result *Phase)
+{
+    Platform.GetMemoryStats(true);
+
+    benchmark_timer Result;
+    Result.Phase = Phase;
+    Result.StartCycles = __rdtsc();
+    return Result;
+}
+
+inline void EndBenchmarkPhase(benchmark_timer Timer)
+{
+    u64 Cycles = __rdtsc() - Timer.StartCycles;
+    platform_memory_stats Stats = Platform.GetMemoryStats(false);
+
+    benchmark_phase_result *Phase = Timer.Phase;
+    Phase->Cycles += Cycles;
+    Phase->PeakMemory = Maximum(Phase->PeakMemory, Stats.PeakSize);
+}
+
+internal void BenchmarkCompile(string Contents, string FileName, b32 DisablePeephole,
+                               u32 RunCount, benchmark_result *Result)
+{
+    ZeroStruct(*Result);
+    Result->ByteCount = Contents.Count;
+
+    stream Discard = {};
+
+    u64 StartCycles = __rdtsc();
+    u64 StartMicroseconds = GetWallClockMicroseconds();
+
+    RunCount = Maximum(RunCount, 1);
+    for(u32 RunIndex = 0; RunIndex < RunCount; ++RunIndex)
+    {
+        benchmark_phase_result Phases[BenchmarkPhase_Count] = {};
+        u32 TokenCount = 0;
+        u32 RoutineCount = 0;
+        u32 FailedCount = 0;
+        u64 NodeCount = 0;
+
+        // NOTE(alex): Every run starts from a parser that hasn't touched any
+        // memory yet, so they all allocate the same.
+        parser *Parser = BootstrapParser();
+        Parser->Out = &Discard;
+        Parser->Errors = &Discard;
+        Parser->DisablePeephole = DisablePeephole;
+
+        tokenizer Tokenizer = Tokenize(Contents, FileName, &Discard);
+
+        benchmark_timer Timer = BeginBenchmarkPhase(Phases + BenchmarkPhase_Tokenize);
+        tokenizer Counter = Tokenizer;
+        while(GetToken(&Counter).Type != Token_EndOfStream)
+        {
+            ++TokenCount;
+        }
+        EndBenchmarkPhase(Timer);
+
+        Timer = BeginBenchmarkPhase(Phases + BenchmarkPhase_Scan);
+        ParseTopLevelRoutines(Parser, Tokenizer);
+        EndBenchmarkPhase(Timer);
+
+        routine_definition *Sentinel = &Parser->RoutineSentinel;
+        for(routine_definition *Routine = Sentinel->Next;
+            Routine != Sentinel;
+            Routine = Routine->Next)
+        {
+            if(Routine->HasBody)
+            {
+                ++RoutineCount;
+                Routine->Compiled = true;
+
+                Timer = BeginBenchmarkPhase(Phases + BenchmarkPhase_Parse);
+                parser *RoutineParser = BeginChildParser(Parser);
+                BeginGraph(RoutineParser);
+
+                tokenizer Body = Routine->Body;
+                Body.ErrorStream = &Discard;
+                ParseRoutineBody(RoutineParser, &Body, (Routine->TypeToken.Type == Token_Identifier));
+                EndBenchmarkPhase(Timer);
+
+                NodeCount += RoutineParser->NextNodeID;
+
+                if(Body.Error)
+                {
+                    ++FailedCount;
+                }
+                else
+                {
+                    Timer = BeginBenchmarkPhase(Phases + BenchmarkPhase_Backend);
+                    schedule *Schedule = ScheduleRoutine(&RoutineParser->Arena, RoutineParser->EndNode,
+                                                         RoutineParser->NextNodeID);
+                    CompactSchedule(&RoutineParser->Arena, Schedule,
+                                    &RoutineParser->StartNode, &RoutineParser->EndNode);
+                    AllocateRegisters(&RoutineParser->Arena, Schedule, X64_ALLOCATABLE_REGISTER_COUNT);
+                    EndBenchmarkPhase(Timer);
+                }
+
+                EndChildParser(RoutineParser);
+            }
+        }
+
+        FreeParser(Parser);
+
+        for(u32 PhaseIndex = 0; PhaseIndex < BenchmarkPhase_Count; ++PhaseIndex)
+        {
+            benchmark_phase_result *Best = Result->Phases + PhaseIndex;
+            if((RunIndex == 0) || (Phases[PhaseIndex].Cycles < Best->Cycles))
+            {
+                Best->Cycles = Phases[PhaseIndex].Cycles;
+            }
+            Best->PeakMemory = Maximum(Best->PeakMemory, Phases[PhaseIndex].PeakMemory);
+        }
+
+        Result->LineCount = Counter.LineNumber;
+        Result->TokenCount = TokenCount;
+        Result->RoutineCount = RoutineCount;
+        Result->FailedCount = FailedCount;
+        Result->NodeCount = NodeCount;
+    }
+
+    u64 ElapsedCycles = __rdtsc() - StartCycles;
+    u64 ElapsedMicroseconds = GetWallClockMicroseconds() - StartMicroseconds;
+    Result->CyclesPerSecond = ElapsedMicroseconds ? (1000000.0*(f64)ElapsedCycles / (f64)ElapsedMicroseconds) : 0.0;
+}
+
+inline f64 GetBenchmarkSeconds(benchmark_result *Result, u64 Cycles)
+{
+    f64 Seconds = (Result->CyclesPerSecond > 0.0) ? ((f64)Cycles / Result->CyclesPerSecond) : 0.0;
+    return Seconds;
+}
+
+inline f64 PerSecond(f64 Count, f64 Seconds)
+{
+    f64 Result = (Seconds > 0.0) ? (Count / Seconds) : 0.0;
+    return Result;
+}
+
+internal char *GetBenchmarkPhaseName(u32 Phase)
+{
+    switch(Phase)
+    {
+        case BenchmarkPhase_Tokenize: {return "tokenize";}
+        case BenchmarkPhase_Scan: {return "scan";}
+        case BenchmarkPhase_Parse: {return "parse";}
+        case BenchmarkPhase_Backend: {return "backend";}
+    }
+
+    return "total";
+}
+
+// NOTE(alex): The total is every phase, and the peak of all of them
+internal benchmark_phase_result GetBenchmarkTotal(benchmark_result *Result)
+{
+    benchmark_phase_result Total = {};
+    for(u32 PhaseIndex = 0; PhaseIndex < BenchmarkPhase_Count; ++PhaseIndex)
+    {
+        Total.Cycles += Result->Phases[PhaseIndex].Cycles;
+        Total.PeakMemory = Maximum(Total.PeakMemory, Result->Phases[PhaseIndex].PeakMemory);
+    }
+
+    return Total;
+}
+
+internal void OutputBenchmarkResult(stream *Out, char *FileName, u32 RunCount, benchmark_result *Result)
+{
+    Outf(Out, "--- Benchmark %s: %llu bytes, %u lines, %u tokens, %u routines, %llu nodes (best of %u) ---\n",
+         FileName, (u64)Result->ByteCount, Result->LineCount, Result->TokenCount,
+         Result->RoutineCount, Result->NodeCount, RunCount);
+    if(Result->FailedCount)
+    {
+        Outf(Out, "--- %u routines failed to parse ---\n", Result->FailedCount);
+    }
+
+    Outf(Out, "%-10s %10s %14s %14s %14s %10s\n", "phase", "ms", "lines/s", "tokens/s", "nodes/s", "peak KB");
+    for(u32 PhaseIndex = 0; PhaseIndex <= BenchmarkPhase_Count; ++PhaseIndex)
+    {
+        benchmark_phase_result Phase = (PhaseIndex < BenchmarkPhase_Count) ?
+            Result->Phases[PhaseIndex] : GetBenchmarkTotal(Result);
+        f64 Seconds = GetBenchmarkSeconds(Result, Phase.Cycles);
+
+        Outf(Out, "%-10s %10.3f %14llu %14llu %14llu %10llu\n",
+             GetBenchmarkPhaseName(PhaseIndex), 1000.0*Seconds,
+             (u64)PerSecond(Result->LineCount, Seconds),
+             (u64)PerSecond(Result->TokenCount, Seconds),
+             (u64)PerSecond((f64)Result->NodeCount, Seconds),
+             (u64)(Phase.PeakMemory / 1024));
+    }
+}
+
+/* NOTE(alex): One row per phase, with the label telling runs apart (bench.bat
+   uses the commit). Rows only ever get appended, so a file collects the
+   history of every run that was written to it.
+*/
+internal b32 AppendBenchmarkCSV(char *CSVFileName, char const *Label, char *FileName, benchmark_result *Result)
+{
+    b32 Written = false;
+
+    FILE *File = fopen(CSVFileName, "ab");
+    if(File)
+    {
+        stream Out = OnFile(File);
+
+        fseek(File, 0, SEEK_END);
+        if(ftell(File) == 0)
+        {
+            Outf(&Out, "label,file,bytes,lines,tokens,routines,nodes,phase,ms,lines_per_sec,tokens_per_sec,nodes_per_sec,peak_kb\n");
+        }
+
+        for(u32 PhaseIndex = 0; PhaseIndex <= BenchmarkPhase_Count; ++PhaseIndex)
+        {
+            benchmark_phase_result Phase = (PhaseIndex < BenchmarkPhase_Count) ?
+                Result->Phases[PhaseIndex] : GetBenchmarkTotal(Result);
+            f64 Seconds = GetBenchmarkSeconds(Result, Phase.Cycles);
+
+            Outf(&Out, "%s,%s,%llu,%u,%u,%u,%llu,%s,%.3f,%llu,%llu,%llu,%llu\n",
+                 Label, FileName, (u64)Result->ByteCount, Result->LineCount, Result->TokenCount,
+                 Result->RoutineCount, Result->NodeCount, GetBenchmarkPhaseName(PhaseIndex),
+                 1000.0*Seconds,
+                 (u64)PerSecond(Result->LineCount, Seconds),
+                 (u64)PerSecond(Result->TokenCount, Seconds),
+                 (u64)PerSecond((f64)Result->NodeCount, Seconds),
+                 (u64)(Phase.PeakMemory / 1024));
+        }
+
+        fclose(File);
+        Written = true;
+    }
+
+    return Written;
+}
@@ -0,0 +1,66 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): The test programs are a few lines each, which is nowhere near
+   enough to see where the compiler spends its time. -gen writes out a
+   program of whatever size we like, and -benchmark compiles files one phase
+   at a time, measuring each of them on its own.
+
+   The generator always starts from the same seed, so the same parameters
+   give the same program on every commit, and the numbers stay comparable.
+*/
+
+struct program_generator_params
+{
+    u32 RoutineCount;
+    u32 LocalCount;
+    u32 Depth;
+    u32 ExpressionSize;
+    u32 Seed;
+};
+
+enum benchmark_phase
+{
+    BenchmarkPhase_Tokenize,
+    BenchmarkPhase_Scan,
+    BenchmarkPhase_Parse,
+    BenchmarkPhase_Backend,
+
+    BenchmarkPhase_Count,
+};
+
+struct benchmark_phase_result
+{
+    u64 Cycles;
+    umm PeakMemory;
+};
+
+struct benchmark_result
+{
+    umm ByteCount;
+    u32 LineCount;
+    u32 TokenCount;
+    u32 RoutineCount;
+    u32 FailedCount;
+    u64 NodeCount;
+
+    // NOTE(alex): The best of all the runs, separately for every phase
+    benchmark_phase_result Phases[BenchmarkPhase_Count];
+    f64 CyclesPerSecond;
+};
+
+internal void GenerateProgram(stream *Out, program_generator_params *Params);
+internal void GenerateConstantTable(stream *Out, program_generator_params *Params);
+internal void BenchmarkCompile(string Contents, string FileName, b32 DisablePeephole,
+                               u32 RunCount, benchmark_result *Result);
+internal void OutputBenchmarkResult(stream *Out, char *FileName, u32 RunCount, benchmark_result *Result);
+internal b32 AppendBenchmarkCSV(char *CSVFileName, char const *Label, char *FileName, benchmark_result *Result);
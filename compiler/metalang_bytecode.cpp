@@ -0,0 +1,573 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): The bytecode is lowered from the same schedule the native
+   backend uses. Registers come from the linear scan allocator too, just with
+   as many registers as there are instructions, so nothing ever spills and
+   every value gets a register of its own unless the allocator could reuse
+   one. The register right after the allocated ones is a temporary, which
+   is what the phi copies use to break cycles, and also where a constant
+   gets loaded when an instruction has no form that takes it inline.
+
+   A compare whose only use is the If that ends its block is not emitted at
+   all. The If becomes a single compare-and-branch instead.
+*/
+
+struct bytecode_fixup
+{
+    u32 Offset; // NOTE(alex): Of the target words in the code
+    u32 TargetBlock;
+};
+
+struct bytecode_builder
+{
+    bytecode_routine *Routine;
+    register_allocation *Allocation;
+
+    u32 CodeCapacity;
+    u16 Temp;
+
+    u32 *BlockOffsets;
+
+    u32 FixupCount;
+    bytecode_fixup *Fixups;
+};
+
+inline void EmitWord(bytecode_builder *Builder, u32 Word)
+{
+    bytecode_routine *Routine = Builder->Routine;
+
+    Assert(Word <= U16Max);
+    Assert(Routine->CodeCount < Builder->CodeCapacity);
+    Routine->Code[Routine->CodeCount++] = (u16)Word;
+}
+
+inline void EmitOp(bytecode_builder *Builder, u32 Op)
+{
+    ++Builder->Routine->InstructionCount;
+    EmitWord(Builder, Op);
+}
+
+inline void EmitImmediate(bytecode_builder *Builder, s32 Value)
+{
+    EmitWord(Builder, (u32)Value & 0xFFFF);
+    EmitWord(Builder, (u32)Value >> 16);
+}
+
+inline void EmitTarget(bytecode_builder *Builder, u32 TargetBlock)
+{
+    bytecode_fixup *Fixup = Builder->Fixups + Builder->FixupCount++;
+    Fixup->Offset = Builder->Routine->CodeCount;
+    Fixup->TargetBlock = TargetBlock;
+
+    EmitWord(Builder, 0);
+    EmitWord(Builder, 0);
+}
+
+inline u16 GetBytecodeRegister(bytecode_builder *Builder, value_location Location)
+{
+    Assert(Location.Type == Location_Register);
+    return Location.Index;
+}
+
+// NOTE(alex): For operands that have to be in a register
+internal u16 GetOperandRegister(bytecode_builder *Builder, node *Node)
+{
+    u16 Result = 0;
+
+    value_location Location = GetLocation(Builder->Allocation, Node);
+    if(Location.Type == Location_Constant)
+    {
+        EmitOp(Builder, Op_LoadImm);
+        EmitWord(Builder, Builder->Temp);
+        EmitImmediate(Builder, Location.Value);
+        Result = Builder->Temp;
+    }
+    else
+    {
+        Result = GetBytecodeRegister(Builder, Location);
+    }
+
+    return Result;
+}
+
+inline b32 IsCommutative(node_type Type)
+{
+    b32 Result = ((Type == Node_Add) ||
+                  (Type == Node_Mul) ||
+                  (Type == Node_EQ) ||
+                  (Type == Node_NE));
+
+    return Result;
+}
+
+inline b32 IsComparison(node_type Type)
+{
+    b32 Result = ((Type >= Node_EQ) && (Type <= Node_LT));
+    return Result;
+}
+
+// NOTE(alex): Emits the RR or RI form of BaseOp with the operands of a
+// binary node, putting a constant inline wherever the op allows it. Branches
+// have no destination, so Dest is only written when it's not negative.
+internal void EmitBinary(bytecode_builder *Builder, u32 BaseOp, s32 Dest, node *Node)
+{
+    node *LHS = Node->Operands[0];
+    node *RHS = Node->Operands[1];
+    if(IsConstant(LHS) && !IsConstant(RHS) && IsCommutative(Node->Type))
+    {
+        node *Swap = LHS;
+        LHS = RHS;
+        RHS = Swap;
+    }
+
+    // NOTE(alex): This may load a constant into the temporary, so it has to
+    // happen before the op itself goes out.
+    u16 A = GetOperandRegister(Builder, LHS);
+
+    value_location B = GetLocation(Builder->Allocation, RHS);
+    EmitOp(Builder, (B.Type == Location_Constant) ? (BaseOp + 1) : BaseOp);
+    if(Dest >= 0)
+    {
+        EmitWord(Builder, Dest);
+    }
+    EmitWord(Builder, A);
+
+    if(B.Type == Location_Constant)
+    {
+        EmitImmediate(Builder, B.Value);
+    }
+    else
+    {
+        EmitWord(Builder, GetBytecodeRegister(Builder, B));
+    }
+}
+
+internal void EmitBytecodeMove(bytecode_builder *Builder, value_location Dest, value_location Source)
+{
+    if(Source.Type == Location_Constant)
+    {
+        EmitOp(Builder, Op_LoadImm);
+        EmitWord(Builder, GetBytecodeRegister(Builder, Dest));
+        EmitImmediate(Builder, Source.Value);
+    }
+    else if(!LocationsAreEqual(Dest, Source))
+    {
+        EmitOp(Builder, Op_Move);
+        EmitWord(Builder, GetBytecodeRegister(Builder, Dest));
+        EmitWord(Builder, GetBytecodeRegister(Builder, Source));
+    }
+}
+
+internal bytecode_routine *LowerToBytecode(memory_arena *Arena, schedule *Schedule)
+{
+    // NOTE(alex): One register per instruction is always enough
+    Assert(Schedule->InstructionCount < U16Max);
+    register_allocation *Allocation = AllocateRegisters(Arena, Schedule, Schedule->InstructionCount);
+    Assert(Allocation->SpillCount == 0);
+
+    bytecode_routine *Routine = PushStruct(Arena, bytecode_routine);
+    Routine->RegisterCount = Allocation->RegisterCount + 1;
+    Routine->Registers = PushArray(Arena, Routine->RegisterCount, s32);
+
+    bytecode_builder Builder_ = {};
+    bytecode_builder *Builder = &Builder_;
+    Builder->Routine = Routine;
+    Builder->Allocation = Allocation;
+    Builder->Temp = (u16)Allocation->ScratchRegister;
+
+    // NOTE(alex): An If is the longest at 13 words (a constant loaded into
+    // the temporary, a compare and branch with an immediate, and a jump).
+    // Every block can also end with its phi copies and a jump.
+    u32 MoveCount = 0;
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        MoveCount += Allocation->BlockMoves[BlockIndex].Count;
+    }
+
+    Builder->CodeCapacity = 13*Schedule->InstructionCount + 4*MoveCount + 3*Schedule->BlockCount + 1;
+    Routine->Code = PushArray(Arena, Builder->CodeCapacity, u16, NoClear());
+    Builder->BlockOffsets = PushArray(Arena, Schedule->BlockCount, u32, NoClear());
+    Builder->Fixups = PushArray(Arena, 2*Schedule->BlockCount, bytecode_fixup, NoClear());
+
+    //
+    // NOTE(alex): Find the compares that can be fused into their branch
+    //
+
+    u32 *UseCount = PushArray(Arena, Schedule->NodeCapacity, u32);
+    for(u32 InstructionIndex = 0; InstructionIndex < Schedule->InstructionCount; ++InstructionIndex)
+    {
+        node *Operands[MAX_NODE_OPERAND_COUNT];
+        u32 OperandCount = GetDataOperands(Schedule->Instructions[InstructionIndex], Operands);
+        for(u32 OperandIndex = 0; OperandIndex < OperandCount; ++OperandIndex)
+        {
+            ++UseCount[Operands[OperandIndex]->ID];
+        }
+    }
+
+    u8 *Fused = PushArray(Arena, Schedule->NodeCapacity, u8);
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        u32 OnePastLast = Block->FirstInstruction + Block->InstructionCount;
+
+        node *If = Block->InstructionCount ? Schedule->Instructions[OnePastLast - 1] : 0;
+        node *Predicate = (If && (If->Type == Node_If)) ? If->Control.Data : 0;
+        if(Predicate &&
+           IsComparison(Predicate->Type) &&
+           (UseCount[Predicate->ID] == 1) &&
+           (Schedule->BlockOf[Predicate->ID] == Block))
+        {
+            // NOTE(alex): The compare moves down to the branch, which is only
+            // fine if nothing in between reuses the registers of its operands.
+            value_location LHS = GetLocation(Allocation, Predicate->Operands[0]);
+            value_location RHS = GetLocation(Allocation, Predicate->Operands[1]);
+
+            b32 CanFuse = true;
+            for(u32 InstructionIndex = OnePastLast - 1;
+                Schedule->Instructions[--InstructionIndex] != Predicate;)
+            {
+                node *Node = Schedule->Instructions[InstructionIndex];
+                if(IsData(Node))
+                {
+                    value_location Dest = GetLocation(Allocation, Node);
+                    if(LocationsAreEqual(Dest, LHS) || LocationsAreEqual(Dest, RHS))
+                    {
+                        CanFuse = false;
+                        break;
+                    }
+                }
+            }
+
+            Fused[Predicate->ID] = (u8)CanFuse;
+        }
+    }
+
+    //
+    // NOTE(alex): Lower the blocks
+    //
+
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        Builder->BlockOffsets[BlockIndex] = Routine->CodeCount;
+
+        for(u32 InstructionIndex = Block->FirstInstruction;
+            InstructionIndex < (Block->FirstInstruction + Block->InstructionCount);
+            ++InstructionIndex)
+        {
+            node *Node = Schedule->Instructions[InstructionIndex];
+            switch(Node->Type)
+            {
+                case Node_Phi:
+                {
+                } break;
+
+                case Node_Proj:
+                {
+                    Assert((Node->Operand->Type == Node_Start) && (Node->Index == 1));
+                    EmitOp(Builder, Op_LoadArg);
+                    EmitWord(Builder, GetBytecodeRegister(Builder, GetLocation(Allocation, Node)));
+                } break;
+
+                case Node_Add:
+                case Node_Sub:
+                case Node_Mul:
+                case Node_Div:
+                case Node_EQ:
+                case Node_NE:
+                case Node_LE:
+                case Node_LT:
+                {
+                    if(!Fused[Node->ID])
+                    {
+                        u16 Dest = GetBytecodeRegister(Builder, GetLocation(Allocation, Node));
+                        EmitBinary(Builder, Op_Add_RR + 2*(Node->Type - Node_Add), Dest, Node);
+                    }
+                } break;
+
+                case Node_Neg:
+                case Node_Not:
+                {
+                    u16 Source = GetOperandRegister(Builder, Node->Operand);
+                    EmitOp(Builder, (Node->Type == Node_Neg) ? Op_Neg : Op_Not);
+                    EmitWord(Builder, GetBytecodeRegister(Builder, GetLocation(Allocation, Node)));
+                    EmitWord(Builder, Source);
+                } break;
+
+                case Node_Print:
+                {
+                    value_location Value = GetLocation(Allocation, Node->Control.Data);
+                    if(Value.Type == Location_Constant)
+                    {
+                        EmitOp(Builder, Op_PrintImm);
+                        EmitImmediate(Builder, Value.Value);
+                    }
+                    else
+                    {
+                        EmitOp(Builder, Op_Print);
+                        EmitWord(Builder, GetBytecodeRegister(Builder, Value));
+                    }
+                } break;
+
+                case Node_If:
+                {
+                    node *Predicate = Node->Control.Data;
+                    if(Fused[Predicate->ID])
+                    {
+                        EmitBinary(Builder, Op_JumpIfNotEQ_RR + 2*(Predicate->Type - Node_EQ), -1, Predicate);
+                        ++Routine->FusedBranchCount;
+                    }
+                    else
+                    {
+                        u16 Source = GetOperandRegister(Builder, Predicate);
+                        EmitOp(Builder, Op_JumpIfZero);
+                        EmitWord(Builder, Source);
+                    }
+
+                    Assert(Block->SuccessorCount == 2);
+                    EmitTarget(Builder, Block->Successors[1]->Index);
+                    if(Block->Successors[0]->Index != (BlockIndex + 1))
+                    {
+                        EmitOp(Builder, Op_Jump);
+                        EmitTarget(Builder, Block->Successors[0]->Index);
+                    }
+                } break;
+
+                case Node_End:
+                {
+                    if(Node->Control.Data)
+                    {
+                        value_location Value = GetLocation(Allocation, Node->Control.Data);
+                        if(Value.Type == Location_Constant)
+                        {
+                            EmitOp(Builder, Op_ReturnImm);
+                            EmitImmediate(Builder, Value.Value);
+                        }
+                        else
+                        {
+                            EmitOp(Builder, Op_Return);
+                            EmitWord(Builder, GetBytecodeRegister(Builder, Value));
+                        }
+                    }
+                    else
+                    {
+                        EmitOp(Builder, Op_ReturnImm);
+                        EmitImmediate(Builder, 0);
+                    }
+                } break;
+
+                InvalidDefaultCase;
+            }
+        }
+
+        if(Block->SuccessorCount == 1)
+        {
+            move_list *Moves = Allocation->BlockMoves + BlockIndex;
+            for(u32 MoveIndex = 0; MoveIndex < Moves->Count; ++MoveIndex)
+            {
+                EmitBytecodeMove(Builder, Moves->Moves[MoveIndex].Dest, Moves->Moves[MoveIndex].Source);
+            }
+
+            if(Block->Successors[0]->Index != (BlockIndex + 1))
+            {
+                EmitOp(Builder, Op_Jump);
+                EmitTarget(Builder, Block->Successors[0]->Index);
+            }
+        }
+    }
+
+    for(u32 FixupIndex = 0; FixupIndex < Builder->FixupCount; ++FixupIndex)
+    {
+        bytecode_fixup *Fixup = Builder->Fixups + FixupIndex;
+        u32 Target = Builder->BlockOffsets[Fixup->TargetBlock];
+        Routine->Code[Fixup->Offset + 0] = (u16)(Target & 0xFFFF);
+        Routine->Code[Fixup->Offset + 1] = (u16)(Target >> 16);
+    }
+
+    return Routine;
+}
+
+//
+// NOTE(alex): The VM
+//
+
+#define VMImmediate(Index) (s32)((u32)IP[Index] | ((u32)IP[(Index) + 1] << 16))
+#define VMTarget(Index) (Code + ((u32)IP[Index] | ((u32)IP[(Index) + 1] << 16)))
+
+#if BYTECODE_COMPUTED_GOTO
+#define VMCase(Name) VM_##Name:
+#define VMNext goto *DispatchTable[*IP]
+#define BYTECODE_OP_LABEL(Name) &&VM_##Name,
+#else
+#define VMCase(Name) case Op_##Name:
+#define VMNext break
+#endif
+
+#define VMBinary(Name, Expression) \
+    VMCase(Name##_RR) {s32 A = R[IP[2]]; s32 B = R[IP[3]]; R[IP[1]] = (Expression); IP += 4;} VMNext; \
+    VMCase(Name##_RI) {s32 A = R[IP[2]]; s32 B = VMImmediate(3); R[IP[1]] = (Expression); IP += 5;} VMNext;
+
+#define VMBranch(Name, Expression) \
+    VMCase(JumpIfNot##Name##_RR) {s32 A = R[IP[1]]; s32 B = R[IP[2]]; IP = (Expression) ? (IP + 5) : VMTarget(3);} VMNext; \
+    VMCase(JumpIfNot##Name##_RI) {s32 A = R[IP[1]]; s32 B = VMImmediate(2); IP = (Expression) ? (IP + 6) : VMTarget(4);} VMNext;
+
+internal s32 RunBytecode(bytecode_routine *Routine, s32 Argument)
+{
+    s32 *R = Routine->Registers;
+    u16 *Code = Routine->Code;
+    u16 *IP = Code;
+
+#if BYTECODE_COMPUTED_GOTO
+    static void *DispatchTable[] =
+    {
+        BYTECODE_OPS(BYTECODE_OP_LABEL)
+    };
+
+    VMNext;
+#else
+    for(;;)
+    {
+        switch(*IP)
+        {
+#endif
+            VMCase(LoadArg) {R[IP[1]] = Argument; IP += 2;} VMNext;
+            VMCase(LoadImm) {R[IP[1]] = VMImmediate(2); IP += 4;} VMNext;
+            VMCase(Move) {R[IP[1]] = R[IP[2]]; IP += 3;} VMNext;
+
+            VMBinary(Add, (s32)((u32)A + (u32)B));
+            VMBinary(Sub, (s32)((u32)A - (u32)B));
+            VMBinary(Mul, (s32)((u32)A * (u32)B));
+            VMBinary(Div, DivideS32(A, B, &Routine->DividedByZero));
+            VMBinary(EQ, (A == B));
+            VMBinary(NE, (A != B));
+            VMBinary(LE, (A <= B));
+            VMBinary(LT, (A < B));
+
+            VMCase(Neg) {R[IP[1]] = (s32)(0 - (u32)R[IP[2]]); IP += 3;} VMNext;
+            VMCase(Not) {R[IP[1]] = (R[IP[2]] == 0); IP += 3;} VMNext;
+
+            VMCase(Print)
+            {
+                if(!Routine->Quiet)
+                {
+                    Outf(Routine->Out, "%d\n", R[IP[1]]);
+                }
+                IP += 2;
+            } VMNext;
+
+            VMCase(PrintImm)
+            {
+                if(!Routine->Quiet)
+                {
+                    Outf(Routine->Out, "%d\n", VMImmediate(1));
+                }
+                IP += 3;
+            } VMNext;
+
+            VMCase(Jump) {IP = VMTarget(1);} VMNext;
+            VMCase(JumpIfZero) {IP = R[IP[1]] ? (IP + 4) : VMTarget(2);} VMNext;
+
+            VMBranch(EQ, (A == B));
+            VMBranch(NE, (A != B));
+            VMBranch(LE, (A <= B));
+            VMBranch(LT, (A < B));
+
+            VMCase(Return) {return R[IP[1]];}
+            VMCase(ReturnImm) {return VMImmediate(1);}
+
+#if !BYTECODE_COMPUTED_GOTO
+            InvalidDefaultCase;
+        }
+    }
+#endif
+}
+
+internal void ExecuteRoutineBytecode(memory_arena *Arena, stream *Out, stream *Errors, string Name,
+                                     schedule *Schedule, s32 Argument, u32 BenchmarkCount)
+{
+    TIMED_FUNCTION();
+
+    temporary_memory TempMem = BeginTemporaryMemory(Arena);
+
+    bytecode_routine *Routine = LowerToBytecode(Arena, Schedule);
+    Routine->Out = Out;
+    s32 Result = RunBytecode(Routine, Argument);
+
+    if(Routine->DividedByZero)
+    {
+        Outf(Errors, "Runtime error: Division by zero in %.*s\n", ExpandString(Name));
+    }
+
+    Outf(Out, "--- %.*s(%d) returned %d ---\n", ExpandString(Name), Argument, Result);
+
+    if(BenchmarkCount)
+    {
+        Routine->Quiet = true;
+
+        u64 StartCycles = __rdtsc();
+        for(u32 RunIndex = 0; RunIndex < BenchmarkCount; ++RunIndex)
+        {
+            RunBytecode(Routine, Argument);
+        }
+        u64 TotalCycles = __rdtsc() - StartCycles;
+
+        Outf(Out, "--- Ran %.*s %u times on the VM: %llu cycles per run, %u instructions (%u words, %u fused branches) ---\n",
+             ExpandString(Name), BenchmarkCount, TotalCycles / BenchmarkCount,
+             Routine->InstructionCount, Routine->CodeCount, Routine->FusedBranchCount);
+    }
+
+    EndTemporaryMemory(TempMem);
+}
+
+// NOTE(alex): The language can't loop yet, so this is a hand-assembled loop
+// of three instructions, which is about as close as we can get to measuring
+// the cost of dispatch alone.
+internal void RunDispatchBenchmark(u32 IterationCount)
+{
+    if(IterationCount > (u32)S32Max)
+    {
+        IterationCount = S32Max;
+    }
+
+    u16 Code[32];
+    u32 At = 0;
+
+    Code[At++] = Op_LoadImm; Code[At++] = 0;
+    Code[At++] = (u16)(IterationCount & 0xFFFF); Code[At++] = (u16)(IterationCount >> 16);
+    Code[At++] = Op_LoadImm; Code[At++] = 1; Code[At++] = 0; Code[At++] = 0;
+
+    u32 Loop = At;
+    Code[At++] = Op_Add_RI; Code[At++] = 1; Code[At++] = 1; Code[At++] = 3; Code[At++] = 0;
+    Code[At++] = Op_Sub_RI; Code[At++] = 0; Code[At++] = 0; Code[At++] = 1; Code[At++] = 0;
+    Code[At++] = Op_JumpIfNotEQ_RI; Code[At++] = 0; Code[At++] = 0; Code[At++] = 0;
+    Code[At++] = (u16)Loop; Code[At++] = 0;
+    Code[At++] = Op_Return; Code[At++] = 1;
+    Assert(At <= ArrayCount(Code));
+
+    s32 Registers[2];
+
+    bytecode_routine Routine = {};
+    Routine.Code = Code;
+    Routine.CodeCount = At;
+    Routine.RegisterCount = ArrayCount(Registers);
+    Routine.Registers = Registers;
+
+    u64 StartCycles = __rdtsc();
+    s32 Result = IterationCount ? RunBytecode(&Routine, 0) : 0;
+    u64 TotalCycles = __rdtsc() - StartCycles;
+
+    u64 DispatchCount = 3*(u64)IterationCount + 3;
+    printf("--- %llu dispatches (%s) in %llu cycles: %.2f cycles per dispatch, result %d ---\n",
+           DispatchCount, BYTECODE_COMPUTED_GOTO ? "computed goto" : "switch",
+           TotalCycles, (f64)TotalCycles / (f64)DispatchCount, Result);
+}
@@ -0,0 +1,93 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+// NOTE(alex): MSVC doesn't have labels as values, so it gets a plain switch
+#if defined(__GNUC__) || defined(__clang__)
+#define BYTECODE_COMPUTED_GOTO 1
+#else
+#define BYTECODE_COMPUTED_GOTO 0
+#endif
+
+/* NOTE(alex): Code is a stream of u16 words. Every instruction is its opcode
+   followed by its operands, where a register is one word, and an immediate
+   or a jump target (a word index into the code) is two words, low half first.
+
+   _RR takes two registers, _RI a register and an immediate. The RR and RI
+   versions of an op are always next to each other, and the binary ops and
+   branches are in the same order as the node types.
+*/
+#define BYTECODE_OPS(X) \
+    X(LoadArg)          /* d */ \
+    X(LoadImm)          /* d imm */ \
+    X(Move)             /* d s */ \
+    X(Add_RR)           /* d a b */ \
+    X(Add_RI)           /* d a imm */ \
+    X(Sub_RR) \
+    X(Sub_RI) \
+    X(Mul_RR) \
+    X(Mul_RI) \
+    X(Div_RR) \
+    X(Div_RI) \
+    X(EQ_RR) \
+    X(EQ_RI) \
+    X(NE_RR) \
+    X(NE_RI) \
+    X(LE_RR) \
+    X(LE_RI) \
+    X(LT_RR) \
+    X(LT_RI) \
+    X(Neg)              /* d s */ \
+    X(Not)              /* d s */ \
+    X(Print)            /* s */ \
+    X(PrintImm)         /* imm */ \
+    X(Jump)             /* target */ \
+    X(JumpIfZero)       /* s target */ \
+    X(JumpIfNotEQ_RR)   /* a b target */ \
+    X(JumpIfNotEQ_RI)   /* a imm target */ \
+    X(JumpIfNotNE_RR) \
+    X(JumpIfNotNE_RI) \
+    X(JumpIfNotLE_RR) \
+    X(JumpIfNotLE_RI) \
+    X(JumpIfNotLT_RR) \
+    X(JumpIfNotLT_RI) \
+    X(Return)           /* s */ \
+    X(ReturnImm)        /* imm */
+
+#define BYTECODE_OP_ENUM(Name) Op_##Name,
+enum bytecode_op
+{
+    BYTECODE_OPS(BYTECODE_OP_ENUM)
+
+    Op_Count,
+};
+
+struct bytecode_routine
+{
+    u32 CodeCount;
+    u16 *Code;
+
+    u32 InstructionCount;
+    u32 FusedBranchCount;
+
+    u32 RegisterCount;
+    s32 *Registers;
+
+    stream *Out;
+    b32 Quiet;
+    b32 DividedByZero;
+};
+
+internal bytecode_routine *LowerToBytecode(memory_arena *Arena, schedule *Schedule);
+internal s32 RunBytecode(bytecode_routine *Routine, s32 Argument);
+internal void ExecuteRoutineBytecode(memory_arena *Arena, stream *Out, stream *Errors, string Name,
+                                     schedule *Schedule, s32 Argument, u32 BenchmarkCount);
+internal void RunDispatchBenchmark(u32 IterationCount);
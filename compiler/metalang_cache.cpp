@@ -0,0 +1,332 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): Every routine's finished graph (parsed, peepholed, before it
+   gets scheduled) can be kept on disk, in a file named after a key that
+   covers everything the graph depends on. When the key matches on the next
+   compile, the routine isn't parsed at all.
+
+   Right now the only thing a body can see outside of itself is the routines
+   it #runs, so the key is the body text, plus the keys of those routines.
+   Once there are calls, their signatures have to go in here too.
+
+   Only routines that compiled without errors are ever written, so a routine
+   whose #run failed is always parsed again.
+*/
+
+enum graph_cache_key_state
+{
+    CacheKey_None,
+    CacheKey_Pending,
+    CacheKey_Done,
+};
+
+internal u64 GetGraphCacheKey(parser *Parser, routine_definition *Routine)
+{
+    if(Routine->CacheKeyState == CacheKey_Done)
+    {
+        return Routine->CacheKey;
+    }
+    else if(Routine->CacheKeyState == CacheKey_Pending)
+    {
+        // NOTE(alex): Routines that #run each other can never finish
+        // compiling, so these never get written anyway.
+        return GRAPH_CACHE_NO_TARGET;
+    }
+
+    Routine->CacheKeyState = CacheKey_Pending;
+
+    u64 Key = HASH64_SEED;
+    Key = HashU64(Key, GRAPH_CACHE_VERSION);
+    Key = HashU64(Key, Parser->DisablePeephole);
+    Key = HashU64(Key, (Routine->TypeToken.Type == Token_Identifier));
+    Key = HashBytes64(Key, Routine->Body.Input.Count, Routine->Body.Input.Data);
+
+    stream Discard = {};
+    tokenizer Tokenizer = Routine->Body;
+    Tokenizer.ErrorStream = &Discard;
+
+    token NameToken;
+    while(GetNextRunTarget(&Tokenizer, &NameToken))
+    {
+        u64 TargetKey = GRAPH_CACHE_NO_TARGET;
+
+        routine_definition *Target = GetRoutine(Parser, NameToken.Text);
+        if(Target)
+        {
+            // NOTE(alex): Lazy mode still has to know what a cached
+            // routine references, since it won't get parsed.
+            routine_reference *Reference = PushStruct(&Parser->Arena, routine_reference);
+            Reference->Routine = Target;
+            Reference->Next = Routine->FirstRunTarget;
+            Routine->FirstRunTarget = Reference;
+
+            if(Target->HasBody)
+            {
+                TargetKey = GetGraphCacheKey(Parser, Target);
+            }
+        }
+
+        Key = HashBytes64(Key, NameToken.Text.Count, NameToken.Text.Data);
+        Key = HashU64(Key, TargetKey);
+    }
+
+    Routine->CacheKey = Key;
+    Routine->CacheKeyState = CacheKey_Done;
+
+    return Key;
+}
+
+internal void ComputeGraphCacheKeys(parser *Parser)
+{
+    TIMED_FUNCTION();
+
+    routine_definition *Sentinel = &Parser->RoutineSentinel;
+    for(routine_definition *Routine = Sentinel->Next;
+        Routine != Sentinel;
+        Routine = Routine->Next)
+    {
+        if(Routine->HasBody)
+        {
+            GetGraphCacheKey(Parser, Routine);
+        }
+    }
+}
+
+internal void GetGraphCachePath(char *Directory, u64 Key, umm PathSize, char *Path)
+{
+    FormatString(PathSize, Path, "%s/%016llx.mlg", Directory, Key);
+}
+
+internal b32 LoadCachedGraph(parser *Parser, char *Directory, u64 Key, u32 *BodyNodeCount)
+{
+    TIMED_FUNCTION();
+
+    b32 Result = false;
+
+    char Path[1024];
+    GetGraphCachePath(Directory, Key, sizeof(Path), Path);
+
+    FILE *In = fopen(Path, "rb");
+    if(In)
+    {
+        fseek(In, 0, SEEK_END);
+        umm FileSize = ftell(In);
+        fseek(In, 0, SEEK_SET);
+
+        // NOTE(alex): The labels are used right where they are, so on a hit
+        // the file stays on the arena along with the routine.
+        temporary_memory FileMemory = BeginTemporaryMemory(&Parser->Arena);
+
+        u8 *File = PushArray(&Parser->Arena, FileSize, u8, NoClear());
+        b32 Read = (FileSize >= sizeof(graph_cache_header)) && (fread(File, FileSize, 1, In) == 1);
+        fclose(In);
+
+        //
+        // NOTE(alex): Anything that doesn't add up is treated as a miss,
+        // it'll just get written again.
+        //
+
+        graph_cache_header *Header = (graph_cache_header *)File;
+        graph_cache_node *Records = (graph_cache_node *)(Header + 1);
+        u8 *Labels = (u8 *)(Records + (Read ? Header->NodeCount : 0));
+
+        b32 Valid = (Read &&
+                     (Header->Magic == GRAPH_CACHE_MAGIC) &&
+                     (Header->Version == GRAPH_CACHE_VERSION) &&
+                     (Header->Key == Key) &&
+                     (FileSize == (sizeof(graph_cache_header) +
+                                   (umm)Header->NodeCount*sizeof(graph_cache_node) +
+                                   Header->LabelSize)) &&
+                     (Header->StartIndex < Header->NodeCount) &&
+                     (Header->EndIndex < Header->NodeCount));
+
+        for(u32 RecordIndex = 0; Valid && (RecordIndex < Header->NodeCount); ++RecordIndex)
+        {
+            graph_cache_node *Record = Records + RecordIndex;
+            Valid = ((Record->Type > Node_Invalid) && (Record->Type < Node_Count) &&
+                     (Record->ID < Header->NodeCapacity) &&
+                     (((umm)Record->LabelOffset + Record->LabelCount) <= Header->LabelSize));
+
+            for(u32 OperandIndex = 0; Valid && (OperandIndex < MAX_NODE_OPERAND_COUNT); ++OperandIndex)
+            {
+                Valid = (Record->Operands[OperandIndex] <= Header->NodeCount);
+            }
+        }
+
+        if(Valid)
+        {
+            u32 NodeCount = Header->NodeCount;
+
+            node *Nodes = PushArray(&Parser->Arena, NodeCount, node);
+            for(u32 NodeIndex = 0; NodeIndex < NodeCount; ++NodeIndex)
+            {
+                graph_cache_node *Record = Records + NodeIndex;
+                node *Node = Nodes + NodeIndex;
+
+                Node->Type = (node_type)Record->Type;
+                Node->ID = Record->ID;
+                Node->Index = Record->Index;
+                Node->DataType = Record->DataType;
+                if(Record->LabelCount)
+                {
+                    Node->DebugLabel = BundleString(Record->LabelCount, (char *)Labels + Record->LabelOffset);
+                }
+
+                for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+                {
+                    u32 Operand = Record->Operands[OperandIndex];
+                    if(Operand)
+                    {
+                        node *Target = Nodes + (Operand - 1);
+                        (&Node->Array)[OperandIndex] = Target;
+                        ++Target->RefCount;
+                    }
+                }
+            }
+
+            // NOTE(alex): This is where the parser would be after finishing
+            // the body, minus the free list and the constants, which nobody
+            // needs anymore.
+            Parser->StartNode = Nodes + Header->StartIndex;
+            Parser->EndNode = Parser->ControlNode = Nodes + Header->EndIndex;
+            Parser->FirstFreeNode = 0;
+            Parser->NextNodeID = Header->NodeCapacity;
+            InitHashTable(&Parser->Constants, &Parser->Arena);
+            Parser->MostRecentVariable = 0;
+            Parser->FirstFreeVariable = 0;
+
+            *BodyNodeCount = Header->BodyNodeCount;
+            Result = true;
+        }
+        else
+        {
+            EndTemporaryMemory(FileMemory);
+        }
+    }
+
+    return Result;
+}
+
+// NOTE(alex): Only has to tell apart the files being written at the same
+// time, by this compiler and any other one running alongside it.
+global u32 volatile GlobalCacheTempFileCount;
+
+internal b32 StoreCachedGraph(parser *Parser, char *Directory, u64 Key, u32 BodyNodeCount)
+{
+    TIMED_FUNCTION();
+
+    temporary_memory TempMem = BeginTemporaryMemory(&Parser->Arena);
+
+    //
+    // NOTE(alex): Only what's reachable from End is part of the routine,
+    // anything else is left over from parsing. Every node gets a record
+    // index, in the order they're first found.
+    //
+
+    u32 NodeCapacity = Parser->NextNodeID;
+    u32 *RecordIndex = PushArray(&Parser->Arena, NodeCapacity, u32);
+    node **Order = PushArray(&Parser->Arena, NodeCapacity, node *, NoClear());
+    u32 NodeCount = 0;
+    umm LabelSize = 0;
+
+    RecordIndex[Parser->EndNode->ID] = ++NodeCount;
+    Order[0] = Parser->EndNode;
+    for(u32 OrderIndex = 0; OrderIndex < NodeCount; ++OrderIndex)
+    {
+        node *Node = Order[OrderIndex];
+        LabelSize += Node->DebugLabel.Count;
+
+        for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+        {
+            node *Operand = GetOperand(Node, OperandIndex);
+            if(Operand && !RecordIndex[Operand->ID])
+            {
+                Order[NodeCount] = Operand;
+                RecordIndex[Operand->ID] = ++NodeCount;
+            }
+        }
+    }
+
+    // NOTE(alex): Start is always reachable through the control chain
+    Assert(RecordIndex[Parser->StartNode->ID]);
+
+    umm FileSize = (sizeof(graph_cache_header) +
+                    NodeCount*sizeof(graph_cache_node) +
+                    LabelSize);
+    u8 *File = PushArray(&Parser->Arena, FileSize, u8);
+
+    graph_cache_header *Header = (graph_cache_header *)File;
+    Header->Magic = GRAPH_CACHE_MAGIC;
+    Header->Version = GRAPH_CACHE_VERSION;
+    Header->Key = Key;
+    Header->NodeCount = NodeCount;
+    Header->LabelSize = (u32)LabelSize;
+    Header->StartIndex = RecordIndex[Parser->StartNode->ID] - 1;
+    Header->EndIndex = RecordIndex[Parser->EndNode->ID] - 1;
+    Header->NodeCapacity = NodeCapacity;
+    Header->BodyNodeCount = BodyNodeCount;
+
+    graph_cache_node *Records = (graph_cache_node *)(Header + 1);
+    u8 *Labels = (u8 *)(Records + NodeCount);
+    u32 LabelOffset = 0;
+    for(u32 OrderIndex = 0; OrderIndex < NodeCount; ++OrderIndex)
+    {
+        node *Node = Order[OrderIndex];
+        graph_cache_node *Record = Records + OrderIndex;
+
+        Record->Type = (u16)Node->Type;
+        Record->ID = Node->ID;
+        Record->Index = Node->Index;
+        Record->DataType = Node->DataType;
+
+        Record->LabelOffset = LabelOffset;
+        Record->LabelCount = (u16)Node->DebugLabel.Count;
+        Copy(Node->DebugLabel.Count, Node->DebugLabel.Data, Labels + LabelOffset);
+        LabelOffset += (u32)Node->DebugLabel.Count;
+
+        for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+        {
+            node *Operand = GetOperand(Node, OperandIndex);
+            Record->Operands[OperandIndex] = Operand ? RecordIndex[Operand->ID] : 0;
+        }
+    }
+
+    // NOTE(alex): Routines of several files (or several runs of the
+    // compiler) may write the same key at once. Each one writes a file of
+    // its own and moves it into place, so nobody can read a file that's
+    // only partly written, or one that two writers wrote over each other.
+    char Path[1024];
+    GetGraphCachePath(Directory, Key, sizeof(Path), Path);
+
+    char TempPath[1024];
+    u32 TempIndex = AtomicAddU32(&GlobalCacheTempFileCount, 1);
+    FormatString(sizeof(TempPath), TempPath, "%s.%016llx%08x.tmp", Path, __rdtsc(), TempIndex);
+
+    b32 Result = false;
+    FILE *Out = fopen(TempPath, "wb");
+    if(Out)
+    {
+        b32 Written = (fwrite(File, FileSize, 1, Out) == 1);
+        Written = (fclose(Out) == 0) && Written;
+
+        Result = Written && Platform.MoveFileReplacing(TempPath, Path);
+        if(!Result)
+        {
+            remove(TempPath);
+        }
+    }
+
+    EndTemporaryMemory(TempMem);
+
+    return Result;
+}
@@ -0,0 +1,60 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+// NOTE(alex): Bump this whenever the parser or the peepholes start producing
+// different graphs for the same source, so the old files just stop matching.
+#define GRAPH_CACHE_VERSION 2
+#define GRAPH_CACHE_MAGIC 0x4347474D // NOTE(alex): "MGGC"
+
+// NOTE(alex): Stands in for a #run target that isn't part of the key (it
+// doesn't exist, or we're already in the middle of hashing it).
+#define GRAPH_CACHE_NO_TARGET 0x9E3779B97F4A7C15ull
+
+/* NOTE(alex): A cached graph is a header, followed by one record per node,
+   followed by the bytes of the debug labels. Nothing in it is a pointer, an
+   operand is the index of the record it points to plus one (zero meaning no
+   operand), so the file can be used from wherever it ends up in memory.
+*/
+struct graph_cache_header
+{
+    u32 Magic;
+    u32 Version;
+    u64 Key;
+
+    u32 NodeCount;
+    u32 LabelSize;
+
+    u32 StartIndex;
+    u32 EndIndex;
+
+    // NOTE(alex): The parser's NextNodeID and how many of the nodes the body
+    // itself created, so the routine looks exactly the same when loaded.
+    u32 NodeCapacity;
+    u32 BodyNodeCount;
+};
+
+struct graph_cache_node
+{
+    u16 Type;
+    u16 LabelCount;
+    u32 LabelOffset;
+
+    u32 ID;
+    u32 Index;
+    data_type DataType;
+
+    u32 Operands[MAX_NODE_OPERAND_COUNT];
+};
+
+internal void ComputeGraphCacheKeys(parser *Parser);
+internal b32 LoadCachedGraph(parser *Parser, char *Directory, u64 Key, u32 *BodyNodeCount);
+internal b32 StoreCachedGraph(parser *Parser, char *Directory, u64 Key, u32 BodyNodeCount);
@@ -0,0 +1,234 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): An open addressing hash table of pointers, living on an arena.
+   Every slot keeps the hash of what's in it, so a probe only looks at the
+   value itself when the hashes match, and the slots are walked in order
+   from where the hash lands until an empty one comes up.
+
+   It starts out small and doubles whenever it gets more than half full,
+   which keeps the walks short. The old slots stay on the arena until it is
+   cleared; they're never more than all of the growing before it put
+   together, so at most as big as the table itself.
+
+   The table doesn't know what the key of a value is. Whatever gets looked
+   up supplies a HashKeysAreEqual(value *, key) for its own key type, and
+   that gets called whenever the hashes match. Values can't be removed,
+   nothing needs that so far.
+*/
+
+#define HASH_TABLE_MINIMUM_CAPACITY 16
+
+template<typename value>
+struct hash_slot
+{
+    u32 Hash;
+    value *Value;
+};
+
+template<typename value>
+struct hash_table
+{
+    memory_arena *Arena;
+
+    // NOTE(alex): Always a power of two, so Mask is Capacity - 1
+    u32 Capacity;
+    u32 Count;
+    hash_slot<value> *Slots;
+};
+
+template<typename value>
+inline void InitHashTable(hash_table<value> *Table, memory_arena *Arena, u32 ExpectedCount = 0)
+{
+    u32 Capacity = HASH_TABLE_MINIMUM_CAPACITY;
+    while(Capacity < 2*ExpectedCount)
+    {
+        Capacity *= 2;
+    }
+
+    Table->Arena = Arena;
+    Table->Capacity = Capacity;
+    Table->Count = 0;
+    Table->Slots = PushArray(Arena, Capacity, hash_slot<value>);
+}
+
+template<typename value>
+inline hash_slot<value> *GetFreeHashSlot(hash_slot<value> *Slots, u32 Capacity, u32 Hash)
+{
+    u32 Mask = Capacity - 1;
+    u32 Index = Hash & Mask;
+    while(Slots[Index].Value)
+    {
+        Index = (Index + 1) & Mask;
+    }
+
+    return Slots + Index;
+}
+
+template<typename value>
+internal void GrowHashTable(hash_table<value> *Table)
+{
+    u32 NewCapacity = 2*Table->Capacity;
+    hash_slot<value> *NewSlots = PushArray(Table->Arena, NewCapacity, hash_slot<value>);
+
+    for(u32 Index = 0; Index < Table->Capacity; ++Index)
+    {
+        hash_slot<value> *Slot = Table->Slots + Index;
+        if(Slot->Value)
+        {
+            *GetFreeHashSlot(NewSlots, NewCapacity, Slot->Hash) = *Slot;
+        }
+    }
+
+    Table->Capacity = NewCapacity;
+    Table->Slots = NewSlots;
+}
+
+template<typename value, typename key>
+inline value *GetHashValue(hash_table<value> *Table, u32 Hash, key Key)
+{
+    value *Result = 0;
+
+    u32 Mask = Table->Capacity - 1;
+    for(u32 Index = Hash & Mask;
+        Table->Slots[Index].Value;
+        Index = (Index + 1) & Mask)
+    {
+        hash_slot<value> *Slot = Table->Slots + Index;
+        if((Slot->Hash == Hash) &&
+           HashKeysAreEqual(Slot->Value, Key))
+        {
+            Result = Slot->Value;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+// NOTE(alex): Doesn't look for what's already there, that's up to whoever
+// calls it (GetHashValue first, and only add what it didn't find).
+template<typename value>
+inline void AddHashValue(hash_table<value> *Table, u32 Hash, value *Value)
+{
+    Assert(Value);
+
+    if(2*(Table->Count + 1) > Table->Capacity)
+    {
+        GrowHashTable(Table);
+    }
+
+    hash_slot<value> *Slot = GetFreeHashSlot(Table->Slots, Table->Capacity, Hash);
+    Slot->Hash = Hash;
+    Slot->Value = Value;
+    ++Table->Count;
+}
+
+/* NOTE(alex): For -hashstats. The chains are what the table would look like
+   with chaining, how many values each slot is home to, which is the part
+   that's down to the hash function. The probes are how far from home the
+   values ended up, which is the part that's down to the table.
+*/
+#define HASH_STATS_CHAIN_COUNT 8
+
+struct hash_table_stats
+{
+    u32 Count;
+    u32 Capacity;
+
+    // NOTE(alex): The last one counts all the longer chains too
+    u32 ChainCounts[HASH_STATS_CHAIN_COUNT];
+    u32 LongestChain;
+
+    u32 LongestProbe;
+    u64 TotalProbe;
+
+    // NOTE(alex): Values whose whole hash matched one already in the table,
+    // so only comparing the keys tells them apart.
+    u32 HashCollisionCount;
+};
+
+template<typename value>
+internal void GetHashTableStats(hash_table<value> *Table, memory_arena *TempArena, hash_table_stats *Stats)
+{
+    temporary_memory TempMem = BeginTemporaryMemory(TempArena);
+
+    ZeroStruct(*Stats);
+    Stats->Count = Table->Count;
+    Stats->Capacity = Table->Capacity;
+
+    u32 Mask = Table->Capacity - 1;
+    u32 *ChainLengths = PushArray(TempArena, Table->Capacity, u32);
+    for(u32 Index = 0; Index < Table->Capacity; ++Index)
+    {
+        hash_slot<value> *Slot = Table->Slots + Index;
+        if(Slot->Value)
+        {
+            u32 Home = Slot->Hash & Mask;
+            ++ChainLengths[Home];
+
+            u32 Probe = (Index - Home) & Mask;
+            Stats->TotalProbe += Probe;
+            Stats->LongestProbe = Maximum(Stats->LongestProbe, Probe);
+
+            // NOTE(alex): A value with the same hash has the same home, so
+            // it can only be somewhere between there and here.
+            for(u32 Other = Home; Other != Index; Other = (Other + 1) & Mask)
+            {
+                if(Table->Slots[Other].Hash == Slot->Hash)
+                {
+                    ++Stats->HashCollisionCount;
+                    break;
+                }
+            }
+        }
+    }
+
+    for(u32 Index = 0; Index < Table->Capacity; ++Index)
+    {
+        u32 Length = ChainLengths[Index];
+        ++Stats->ChainCounts[Minimum(Length, HASH_STATS_CHAIN_COUNT - 1)];
+        Stats->LongestChain = Maximum(Stats->LongestChain, Length);
+    }
+
+    EndTemporaryMemory(TempMem);
+}
+
+internal void OutputHashTableStats(stream *Out, char *Name, hash_table_stats *Stats)
+{
+    // NOTE(alex): How many slots a hash that spreads the values perfectly at
+    // random would leave empty, to hold the real one up against.
+    f64 EmptyChance = 1.0;
+    for(u32 Index = 0; Index < Stats->Count; ++Index)
+    {
+        EmptyChance *= 1.0 - 1.0 / (f64)Stats->Capacity;
+    }
+
+    Outf(Out, "--- %s: %u in %u slots, %u empty (%u at random) ---\n",
+         Name, Stats->Count, Stats->Capacity, Stats->ChainCounts[0],
+         (u32)(EmptyChance*(f64)Stats->Capacity + 0.5));
+
+    Outf(Out, "    Chains:");
+    for(u32 Length = 1; Length < HASH_STATS_CHAIN_COUNT; ++Length)
+    {
+        if(Stats->ChainCounts[Length])
+        {
+            Outf(Out, " %u of %u%s,", Stats->ChainCounts[Length], Length,
+                 (Length == (HASH_STATS_CHAIN_COUNT - 1)) ? "+" : "");
+        }
+    }
+    Outf(Out, " longest %u\n", Stats->LongestChain);
+
+    Outf(Out, "    Probes: longest %u, average %.2f, %u hash collisions\n",
+         Stats->LongestProbe, Stats->Count ? (f64)Stats->TotalProbe / (f64)Stats->Count : 0.0,
+         Stats->HashCollisionCount);
+}
@@ -0,0 +1,313 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): This runs a routine straight off the graph, with no schedule
+   and no register allocation. Control is followed forward from the Start
+   node, and data nodes are evaluated on demand the first time something
+   needs them. Since nothing loops yet, every data node has exactly one
+   value per run, so the memo never has to be invalidated in the middle.
+
+   Arithmetic wraps the same way the native code does.
+*/
+
+inline s32 DivideS32(s32 LHS, s32 RHS, b32 *DividedByZero)
+{
+    s32 Result = 0;
+
+    if(RHS == 0)
+    {
+        // NOTE(alex): Native code would trap here. We just report it once
+        // and keep going with zero.
+        *DividedByZero = true;
+    }
+    else if((LHS == S32Min) && (RHS == -1))
+    {
+        Result = S32Min;
+    }
+    else
+    {
+        Result = LHS / RHS;
+    }
+
+    return Result;
+}
+
+internal void LinkSuccessor(graph_interpreter *Interpreter, node *From, node *To, u32 Index)
+{
+    Interpreter->Successors[2*From->ID + Index] = To;
+}
+
+// NOTE(alex): Returns 0 instead when the arena would end up past MemoryLimit,
+// counting what's on it already. A limit of zero means there isn't one.
+internal graph_interpreter *BeginGraphInterpreter(memory_arena *Arena, node *EndNode, u32 NodeCapacity,
+                                                  umm MemoryLimit)
+{
+    umm Size = (sizeof(graph_interpreter) +
+                NodeCapacity*(2*sizeof(node *) + sizeof(u8) + sizeof(u32) + sizeof(s32)) +
+                NodeCapacity*(sizeof(u8) + sizeof(node *)));
+    if(MemoryLimit && ((GetArenaSize(Arena) + Size) > MemoryLimit))
+    {
+        return 0;
+    }
+
+    graph_interpreter *Interpreter = PushStruct(Arena, graph_interpreter);
+    Interpreter->NodeCapacity = NodeCapacity;
+    Interpreter->Successors = PushArray(Arena, 2*NodeCapacity, node *);
+    Interpreter->RegionTaken = PushArray(Arena, NodeCapacity, u8);
+    Interpreter->ValueEpoch = PushArray(Arena, NodeCapacity, u32);
+    Interpreter->Values = PushArray(Arena, NodeCapacity, s32, NoClear());
+
+    //
+    // NOTE(alex): Walk the control edges backwards from End, recording each
+    // of them forwards as we go.
+    //
+
+    temporary_memory TempMem = BeginTemporaryMemory(Arena);
+
+    u8 *Visited = PushArray(Arena, NodeCapacity, u8);
+    node **Stack = PushArray(Arena, NodeCapacity, node *, NoClear());
+    u32 StackCount = 0;
+
+    Visited[EndNode->ID] = true;
+    Stack[StackCount++] = EndNode;
+    while(StackCount)
+    {
+        node *Node = Stack[--StackCount];
+
+        node *Prev[2] = {};
+        switch(Node->Type)
+        {
+            case Node_Start: {} break;
+
+            case Node_Proj:
+            {
+                // NOTE(alex): The projection's index says which side of the If it is
+                LinkSuccessor(Interpreter, Node->Operand, Node, Node->Index);
+                Prev[0] = Node->Operand;
+            } break;
+
+            case Node_Region:
+            {
+                // NOTE(alex): Region.Prev is the If that opened the region,
+                // which isn't a control edge into it.
+                LinkSuccessor(Interpreter, Node->Region.TrueBranch, Node, 0);
+                LinkSuccessor(Interpreter, Node->Region.FalseBranch, Node, 0);
+                Prev[0] = Node->Region.TrueBranch;
+                Prev[1] = Node->Region.FalseBranch;
+            } break;
+
+            default:
+            {
+                if(Node->Control.Prev->Type != Node_If)
+                {
+                    LinkSuccessor(Interpreter, Node->Control.Prev, Node, 0);
+                }
+                Prev[0] = Node->Control.Prev;
+            } break;
+        }
+
+        for(u32 PrevIndex = 0; PrevIndex < ArrayCount(Prev); ++PrevIndex)
+        {
+            node *Pred = Prev[PrevIndex];
+            if(Pred && !Visited[Pred->ID])
+            {
+                Visited[Pred->ID] = true;
+                Stack[StackCount++] = Pred;
+            }
+        }
+    }
+
+    EndTemporaryMemory(TempMem);
+
+    return Interpreter;
+}
+
+internal s32 EvaluateData(graph_interpreter *Interpreter, node *Node)
+{
+    s32 Result = 0;
+
+    if(IsConstant(Node))
+    {
+        Result = Node->DataType.Value;
+    }
+    else if(Interpreter->ValueEpoch[Node->ID] == Interpreter->Epoch)
+    {
+        Result = Interpreter->Values[Node->ID];
+    }
+    else
+    {
+        ++Interpreter->EvaluatedCount;
+        ++Interpreter->StepCount;
+
+        switch(Node->Type)
+        {
+            case Node_Proj:
+            {
+                Assert((Node->Operand->Type == Node_Start) && (Node->Index == 1));
+                Result = Interpreter->Argument;
+            } break;
+
+            case Node_Phi:
+            {
+                node *Region = GetPhiRegion(Node);
+                u32 Taken = Interpreter->RegionTaken[Region->ID];
+                Result = EvaluateData(Interpreter, Node->Operands[Taken]);
+            } break;
+
+            case Node_Neg:
+            {
+                u32 Value = (u32)EvaluateData(Interpreter, Node->Operand);
+                Result = (s32)(0 - Value);
+            } break;
+
+            case Node_Not:
+            {
+                Result = (EvaluateData(Interpreter, Node->Operand) == 0);
+            } break;
+
+            default:
+            {
+                Assert(IsOperator(Node));
+
+                s32 LHS = EvaluateData(Interpreter, Node->Operands[0]);
+                s32 RHS = EvaluateData(Interpreter, Node->Operands[1]);
+                switch(Node->Type)
+                {
+                    case Node_Add: {Result = (s32)((u32)LHS + (u32)RHS);} break;
+                    case Node_Sub: {Result = (s32)((u32)LHS - (u32)RHS);} break;
+                    case Node_Mul: {Result = (s32)((u32)LHS * (u32)RHS);} break;
+
+                    case Node_Div: {Result = DivideS32(LHS, RHS, &Interpreter->DividedByZero);} break;
+
+                    case Node_EQ: {Result = (LHS == RHS);} break;
+                    case Node_NE: {Result = (LHS != RHS);} break;
+                    case Node_LE: {Result = (LHS <= RHS);} break;
+                    case Node_LT: {Result = (LHS < RHS);} break;
+
+                    InvalidDefaultCase;
+                }
+            } break;
+        }
+
+        Interpreter->ValueEpoch[Node->ID] = Interpreter->Epoch;
+        Interpreter->Values[Node->ID] = Result;
+    }
+
+    return Result;
+}
+
+internal s32 RunGraph(graph_interpreter *Interpreter, node *StartNode, s32 Argument)
+{
+    s32 Result = 0;
+
+    ++Interpreter->Epoch;
+    Interpreter->Argument = Argument;
+    Interpreter->StepCount = 0;
+    Interpreter->OutOfSteps = false;
+
+    node *Prev = 0;
+    node *Node = StartNode;
+    while(Node)
+    {
+        if(Interpreter->StepLimit &&
+           (++Interpreter->StepCount > Interpreter->StepLimit))
+        {
+            Interpreter->OutOfSteps = true;
+            break;
+        }
+
+        node *Next = Interpreter->Successors[2*Node->ID];
+        switch(Node->Type)
+        {
+            case Node_Start:
+            case Node_Proj:
+            {
+            } break;
+
+            case Node_Print:
+            {
+                s32 Value = EvaluateData(Interpreter, Node->Control.Data);
+                if(!Interpreter->Quiet)
+                {
+                    Outf(Interpreter->Out, "%d\n", Value);
+                }
+            } break;
+
+            case Node_If:
+            {
+                u32 Taken = (EvaluateData(Interpreter, Node->Control.Data) == 0);
+                Next = Interpreter->Successors[2*Node->ID + Taken];
+            } break;
+
+            case Node_Region:
+            {
+                Interpreter->RegionTaken[Node->ID] = (Prev == Node->Region.TrueBranch) ? 0 : 1;
+            } break;
+
+            case Node_End:
+            {
+                if(Node->Control.Data)
+                {
+                    Result = EvaluateData(Interpreter, Node->Control.Data);
+                }
+                Next = 0;
+            } break;
+
+            InvalidDefaultCase;
+        }
+
+        Prev = Node;
+        Node = Next;
+    }
+
+    return Result;
+}
+
+internal void ExecuteRoutineGraph(memory_arena *Arena, stream *Out, stream *Errors, string Name,
+                                  node *StartNode, node *EndNode, u32 NodeCapacity,
+                                  s32 Argument, u32 BenchmarkCount)
+{
+    TIMED_FUNCTION();
+
+    temporary_memory TempMem = BeginTemporaryMemory(Arena);
+
+    graph_interpreter *Interpreter = BeginGraphInterpreter(Arena, EndNode, NodeCapacity, 0);
+    Interpreter->Out = Out;
+    s32 Result = RunGraph(Interpreter, StartNode, Argument);
+    u32 EvaluatedCount = Interpreter->EvaluatedCount;
+
+    if(Interpreter->DividedByZero)
+    {
+        Outf(Errors, "Runtime error: Division by zero in %.*s\n", ExpandString(Name));
+    }
+
+    Outf(Out, "--- %.*s(%d) returned %d ---\n", ExpandString(Name), Argument, Result);
+
+    if(BenchmarkCount)
+    {
+        // NOTE(alex): Prints are dropped while timing, we only care about
+        // how fast the graph itself can be walked.
+        Interpreter->Quiet = true;
+
+        u64 StartCycles = __rdtsc();
+        for(u32 RunIndex = 0; RunIndex < BenchmarkCount; ++RunIndex)
+        {
+            RunGraph(Interpreter, StartNode, Argument);
+        }
+        u64 TotalCycles = __rdtsc() - StartCycles;
+
+        Outf(Out, "--- Interpreted %.*s %u times: %llu cycles per run, %u nodes evaluated per run ---\n",
+             ExpandString(Name), BenchmarkCount, TotalCycles / BenchmarkCount, EvaluatedCount);
+    }
+
+    EndTemporaryMemory(TempMem);
+}
@@ -0,0 +1,50 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+struct graph_interpreter
+{
+    // NOTE(alex): All of these are indexed by node ID. Control nodes only
+    // have back edges in the graph, so the forward edges get recorded once
+    // up front. An If has two successors (true, false), everything else one.
+    u32 NodeCapacity;
+    node **Successors;
+
+    // NOTE(alex): Which side of the region was taken on the way in, which
+    // picks the phi input to use.
+    u8 *RegionTaken;
+
+    // NOTE(alex): A value is only valid if its epoch matches the current
+    // one, so running the routine again never has to clear the memo.
+    u32 Epoch;
+    u32 *ValueEpoch;
+    s32 *Values;
+
+    s32 Argument;
+    stream *Out;
+    b32 Quiet;
+
+    u32 EvaluatedCount;
+    b32 DividedByZero;
+
+    // NOTE(alex): Both control nodes walked and data nodes evaluated count
+    // as a step. A limit of zero means there isn't one.
+    u64 StepLimit;
+    u64 StepCount;
+    b32 OutOfSteps;
+};
+
+internal graph_interpreter *BeginGraphInterpreter(memory_arena *Arena, node *EndNode, u32 NodeCapacity,
+                                                  umm MemoryLimit);
+internal s32 RunGraph(graph_interpreter *Interpreter, node *StartNode, s32 Argument);
+internal void ExecuteRoutineGraph(memory_arena *Arena, stream *Out, stream *Errors, string Name,
+                                  node *StartNode, node *EndNode, u32 NodeCapacity,
+                                  s32 Argument, u32 BenchmarkCount);
@@ -178,10 +178,15 @@ inline void *PushSize_(memory_arena *Arena, umm SizeInit, arena_push_params Para
     // on their first allocation that was _greater_ that than the page alignment
     Assert(Arena->CurrentBlock->Used <= Arena->CurrentBlock->Size);
 
-    if(Params.Flags & ArenaFlag_ClearToZero)
+    // NOTE(alex): Only what's been used before (and then given back with a
+    // temporary memory) needs clearing, the rest is as the OS handed it out.
+    platform_memory_block *Block = Arena->CurrentBlock;
+    if((Params.Flags & ArenaFlag_ClearToZero) &&
+       (OffsetInBlock < Block->MaxUsed))
     {
-        ZeroSize(SizeInit, Result);
+        ZeroSize(Minimum(SizeInit, Block->MaxUsed - OffsetInBlock), Result);
     }
+    Block->MaxUsed = Maximum(Block->MaxUsed, Block->Used);
 
     return Result;
 }
@@ -247,6 +252,19 @@ inline void Clear(memory_arena *Arena)
     }
 }
 
+inline umm GetArenaSize(memory_arena *Arena)
+{
+    umm Result = 0;
+    for(platform_memory_block *Block = Arena->CurrentBlock;
+        Block;
+        Block = Block->ArenaPrev)
+    {
+        Result += Block->Size;
+    }
+
+    return Result;
+}
+
 inline void *BootstrapPushSize_(umm StructSize, umm OffsetToArena,
                                 arena_bootstrap_params BootstrapParams = DefaultBootstrapParams(),
                                 arena_push_params Params = DefaultArenaParams())
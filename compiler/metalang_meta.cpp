@@ -0,0 +1,283 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): #run parses the body of a routine again with a parser of its
+   own, and walks the resulting graph with the graph interpreter, all
+   in-process. Everything the run allocated goes away with its parser, and
+   the only thing kept is the value, which gets folded in as a constant.
+
+   Nothing a run prints shows up in the output. Whether a run actually
+   happens depends on what's already in the cache, which with several
+   threads depends on timing, and the output shouldn't.
+*/
+
+global run_cache GlobalRunCache;
+
+// NOTE(alex): FNV-1a
+#define HASH64_SEED 0xCBF29CE484222325ull
+internal u64 HashBytes64(u64 Hash, umm Size, void *DataInit)
+{
+    u8 *Data = (u8 *)DataInit;
+    for(umm Index = 0; Index < Size; ++Index)
+    {
+        Hash ^= Data[Index];
+        Hash *= 0x100000001B3ull;
+    }
+
+    return Hash;
+}
+
+inline u64 HashU64(u64 Hash, u64 Value)
+{
+    u64 Result = HashBytes64(Hash, sizeof(Value), &Value);
+    return Result;
+}
+
+// NOTE(alex): For picking the #runs out of a body that already got through
+// SkipBalancedBlock, so it can't run into anything new.
+internal b32 GetNextRunTarget(tokenizer *Tokenizer, token *NameToken)
+{
+    b32 Result = false;
+
+    while(!Result && Parsing(Tokenizer))
+    {
+        token Token = GetToken(Tokenizer);
+        if(Token.Type == Token_EndOfStream)
+        {
+            break;
+        }
+
+        if((Token.Type == Token_Pound) && TokenEquals(PeekToken(Tokenizer), "run"))
+        {
+            GetToken(Tokenizer);
+
+            *NameToken = GetToken(Tokenizer);
+            Result = (NameToken->Type == Token_Identifier);
+        }
+    }
+
+    return Result;
+}
+
+enum run_key_state
+{
+    RunKey_None,
+    RunKey_Pending,
+    RunKey_Done,
+};
+
+internal u64 GetRunKey(parser *Parser, routine_definition *Routine)
+{
+    if(Routine->RunKeyState == RunKey_Done)
+    {
+        return Routine->RunKey;
+    }
+    else if(Routine->RunKeyState == RunKey_Pending)
+    {
+        return RUN_KEY_CYCLE;
+    }
+
+    Routine->RunKeyState = RunKey_Pending;
+
+    u64 Key = HASH64_SEED;
+    Key = HashU64(Key, (Routine->TypeToken.Type == Token_Identifier));
+    Key = HashBytes64(Key, Routine->Body.Input.Count, Routine->Body.Input.Data);
+
+    stream Discard = {};
+    tokenizer Tokenizer = Routine->Body;
+    Tokenizer.ErrorStream = &Discard;
+
+    token NameToken;
+    while(GetNextRunTarget(&Tokenizer, &NameToken))
+    {
+        // NOTE(alex): A #run of a routine that isn't there fails, so it
+        // doesn't matter what it's keyed by.
+        u64 TargetKey = 0;
+
+        routine_definition *Target = GetRoutine(Parser, NameToken.Text);
+        if(Target && Target->HasBody)
+        {
+            TargetKey = GetRunKey(Parser, Target);
+        }
+
+        Key = HashU64(Key, TargetKey);
+    }
+
+    Routine->RunKey = Key;
+    Routine->RunKeyState = RunKey_Done;
+
+    return Key;
+}
+
+internal run_cache_entry *GetRunCacheEntry(run_cache *Cache, string Body, u32 BodyHash, u64 RunKey,
+                                           b32 HasResult, s32 Argument)
+{
+    run_cache_entry *Result = 0;
+
+    u32 HashIndex = (BodyHash ^ (u32)Argument) & (ArrayCount(Cache->Hash) - 1);
+    for(run_cache_entry *Search = Cache->Hash[HashIndex]; Search; Search = Search->NextInHash)
+    {
+        // NOTE(alex): The hash only gets us to the bucket, the text has to
+        // actually match for two bodies to be the same routine.
+        if((Search->BodyHash == BodyHash) &&
+           (Search->RunKey == RunKey) &&
+           (Search->Argument == Argument) &&
+           (Search->HasResult == HasResult) &&
+           StringsAreEqual(Search->Body, Body))
+        {
+            Result = Search;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+internal void AddRunCacheEntry(run_cache *Cache, string Body, u32 BodyHash, u64 RunKey,
+                               b32 HasResult, s32 Argument, s32 Value)
+{
+    run_cache_entry *Entry = PushStruct(&Cache->Arena, run_cache_entry);
+    // NOTE(alex): The cache outlives the file the body came from
+    Entry->Body.Count = Body.Count;
+    Entry->Body.Data = (u8 *)PushCopy(&Cache->Arena, Body.Count, Body.Data, NoClear());
+    Entry->BodyHash = BodyHash;
+    Entry->RunKey = RunKey;
+    Entry->HasResult = HasResult;
+    Entry->Argument = Argument;
+    Entry->Value = Value;
+
+    u32 HashIndex = (BodyHash ^ (u32)Argument) & (ArrayCount(Cache->Hash) - 1);
+    Entry->NextInHash = Cache->Hash[HashIndex];
+    Cache->Hash[HashIndex] = Entry;
+}
+
+// NOTE(alex): Entries never go stale, since a routine that changes (or
+// #runs something that did) gets a new key, but they never go away either.
+// So anything that compiles over and over, like the server, starts the
+// cache over once it gets too big.
+internal void ResetRunCache(run_cache *Cache)
+{
+    Clear(&Cache->Arena);
+    ZeroArray(ArrayCount(Cache->Hash), Cache->Hash);
+    Cache->HitCount = 0;
+    Cache->MissCount = 0;
+}
+
+internal b32 RunAtCompileTime(parser *Parser, tokenizer *Tokenizer, token NameToken,
+                              routine_definition *Routine, s32 Argument, s32 *Value)
+{
+    TIMED_FUNCTION();
+
+    b32 Result = false;
+
+    // NOTE(alex): Only the runs in the file itself are counted, since the
+    // ones nested inside of them only happen on a cache miss. Routines of
+    // the same file may be parsed on several threads.
+    if(Parser->MetaDepth == 0)
+    {
+        parser *Root = GetRootParser(Parser);
+        AtomicAddU32(&Root->RunCount, 1);
+    }
+
+    run_cache *Cache = &GlobalRunCache;
+
+    string Body = Routine->Body.Input;
+    u32 BodyHash = Routine->BodyHash;
+    b32 HasResult = (Routine->TypeToken.Type == Token_Identifier);
+
+    BeginTicketMutex(&Cache->Mutex);
+    u64 RunKey = GetRunKey(Parser, Routine);
+    run_cache_entry *Cached = GetRunCacheEntry(Cache, Body, BodyHash, RunKey, HasResult, Argument);
+    if(Cached)
+    {
+        ++Cache->HitCount;
+        *Value = Cached->Value;
+    }
+    else
+    {
+        ++Cache->MissCount;
+    }
+    EndTicketMutex(&Cache->Mutex);
+
+    if(Cached)
+    {
+        Result = true;
+    }
+    else if(Parser->MetaDepth >= META_MAX_DEPTH)
+    {
+        Error(Tokenizer, NameToken, "#run nested more than %u deep", META_MAX_DEPTH);
+    }
+    else
+    {
+        stream Discard = {};
+
+        parser *Meta = BeginChildParser(Parser);
+        Meta->Out = &Discard;
+        Meta->MetaDepth = Parser->MetaDepth + 1;
+        Meta->ExecuteMode = Execute_None;
+
+        BeginGraph(Meta);
+
+        tokenizer RoutineTokenizer = Routine->Body;
+        RoutineTokenizer.ErrorStream = Tokenizer->ErrorStream;
+        ParseRoutineBody(Meta, &RoutineTokenizer, HasResult);
+
+        if(RoutineTokenizer.Error)
+        {
+            // NOTE(alex): Whatever went wrong in the body was already reported
+            // where it happened, so this only has to stop the outer parse.
+            Tokenizer->Error = true;
+        }
+        else
+        {
+            // NOTE(alex): The interpreter checks the budget before it
+            // allocates, so this counts what the parse used as well.
+            graph_interpreter *Interpreter =
+                BeginGraphInterpreter(&Meta->Arena, Meta->EndNode, Meta->NextNodeID, META_MAX_MEMORY);
+            if(!Interpreter)
+            {
+                Error(Tokenizer, NameToken, "#run used more than %llu bytes", (u64)META_MAX_MEMORY);
+            }
+            else
+            {
+                Interpreter->Out = &Discard;
+                Interpreter->StepLimit = META_MAX_STEPS;
+
+                s32 RunResult = RunGraph(Interpreter, Meta->StartNode, Argument);
+                if(Interpreter->OutOfSteps)
+                {
+                    Error(Tokenizer, NameToken, "#run took more than %u steps", META_MAX_STEPS);
+                }
+                else if(Interpreter->DividedByZero)
+                {
+                    Error(Tokenizer, NameToken, "#run divided by zero");
+                }
+                else
+                {
+                    *Value = RunResult;
+                    Result = true;
+
+                    BeginTicketMutex(&Cache->Mutex);
+                    if(!GetRunCacheEntry(Cache, Body, BodyHash, RunKey, HasResult, Argument))
+                    {
+                        AddRunCacheEntry(Cache, Body, BodyHash, RunKey, HasResult, Argument, RunResult);
+                    }
+                    EndTicketMutex(&Cache->Mutex);
+                }
+            }
+        }
+
+        EndChildParser(Meta);
+    }
+
+    return Result;
+}
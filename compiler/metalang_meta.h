@@ -0,0 +1,56 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+// NOTE(alex): Budgets for a single #run. Nested runs each get their own.
+#define META_MAX_DEPTH 64
+#define META_MAX_STEPS 1000000
+#define META_MAX_MEMORY Megabytes(256)
+
+// NOTE(alex): How big the run cache gets before the server starts it over
+#define RUN_CACHE_MAX_SIZE Megabytes(64)
+
+// NOTE(alex): What a routine that's part of a #run cycle gets keyed by.
+// Runs like that never finish, so they never get a cache entry either.
+#define RUN_KEY_CYCLE 0x9E3779B97F4A7C15ull
+
+struct run_cache_entry
+{
+    string Body;
+    u32 BodyHash;
+    u64 RunKey;
+    b32 HasResult;
+    s32 Argument;
+
+    s32 Value;
+
+    run_cache_entry *NextInHash;
+};
+
+// NOTE(alex): A routine can only see its argument and the routines it #runs.
+// Those are looked up in the file doing the #run, so the same body can #run
+// something else in another file. An entry is keyed by the body text, the
+// argument, and the routine's run key, which covers the body and the keys
+// of every routine it #runs, all the way down.
+struct run_cache
+{
+    ticket_mutex Mutex;
+    memory_arena Arena;
+
+    u32 HitCount;
+    u32 MissCount;
+
+    run_cache_entry *Hash[1024];
+};
+
+internal void ResetRunCache(run_cache *Cache);
+internal b32 RunAtCompileTime(parser *Parser, tokenizer *Tokenizer, token NameToken,
+                              routine_definition *Routine, s32 Argument, s32 *Value);
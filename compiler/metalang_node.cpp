@@ -132,6 +132,19 @@ internal b32 TypesAreEqual(data_type A, data_type B)
     return Result;
 }
 
+// NOTE(alex): For looking constants up by their type. The whole type fits
+// in a word, and a multiply spreads it over the upper half, which is the
+// half that's kept.
+inline u32 DataTypeHashOf(data_type Type)
+{
+    u64 Bits = ((u64)Type.Class |
+                ((u64)Type.Flags << 16) |
+                ((u64)(u32)Type.Value << 32));
+
+    u32 Result = (u32)((Bits*STRING_HASH_MULTIPLIER) >> 32);
+    return Result;
+}
+
 internal data_type Meet(data_type A, data_type B)
 {
     data_type Result = {};
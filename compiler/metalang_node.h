@@ -127,3 +127,12 @@ internal node *GetOperand(node *Node, u32 Index)
     node *Result = (&Node->Array)[Index];
     return Result;
 }
+
+// NOTE(alex): A phi's operands are the value from each branch, and then the
+// region that merges them.
+inline node *GetPhiRegion(node *Phi)
+{
+    Assert(Phi->Type == Node_Phi);
+    node *Result = GetOperand(Phi, 2);
+    return Result;
+}
@@ -0,0 +1,339 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+internal void CountLiveNodes(memory_arena *Arena, node *EndNode, u32 NodeCapacity, node_stats *Stats)
+{
+    temporary_memory TempMem = BeginTemporaryMemory(Arena);
+
+    ZeroStruct(*Stats);
+
+    u8 *Found = PushArray(Arena, NodeCapacity, u8);
+    node **Order = PushArray(Arena, NodeCapacity, node *, NoClear());
+    u32 NodeCount = 0;
+
+    Found[EndNode->ID] = true;
+    Order[NodeCount++] = EndNode;
+    for(u32 OrderIndex = 0; OrderIndex < NodeCount; ++OrderIndex)
+    {
+        node *Node = Order[OrderIndex];
+        ++Stats->TypeCounts[Node->Type];
+
+        for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+        {
+            node *Operand = GetOperand(Node, OperandIndex);
+            if(Operand && !Found[Operand->ID])
+            {
+                Found[Operand->ID] = true;
+                Order[NodeCount++] = Operand;
+            }
+        }
+    }
+
+    Stats->NodeCount = NodeCount;
+
+    EndTemporaryMemory(TempMem);
+}
+
+internal node_stats_file *BeginNodeStats(void)
+{
+    node_stats_file *File = BootstrapPushStruct(node_stats_file, Arena);
+    return File;
+}
+
+internal void EndNodeStats(node_stats_file *File)
+{
+    Clear(&File->Arena);
+}
+
+internal node_stats_entry *PushNodeStatsEntry(node_stats_file *File, string Name)
+{
+    node_stats_entry *Entry = PushStruct(&File->Arena, node_stats_entry);
+
+    // NOTE(alex): The name points into the source, which goes away before
+    // the file does.
+    Entry->Name = BundleString(Name.Count, (char *)PushCopy(&File->Arena, Name.Count, Name.Data, NoClear()));
+
+    if(File->Last)
+    {
+        File->Last->Next = Entry;
+    }
+    else
+    {
+        File->First = Entry;
+    }
+    File->Last = Entry;
+
+    return Entry;
+}
+
+internal void AddNodeStats(node_stats_file *File, string Name, node_stats *Stats)
+{
+    node_stats_entry *Entry = PushNodeStatsEntry(File, Name);
+    Entry->Stats = *Stats;
+}
+
+internal void AddFailedNodeStats(node_stats_file *File, string Name)
+{
+    node_stats_entry *Entry = PushNodeStatsEntry(File, Name);
+    Entry->Failed = true;
+}
+
+internal node_stats_entry *FindNodeStats(node_stats_entry *First, string Name)
+{
+    node_stats_entry *Result = 0;
+    for(node_stats_entry *Entry = First; Entry; Entry = Entry->Next)
+    {
+        if(StringsAreEqual(Entry->Name, Name))
+        {
+            Result = Entry;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+internal void OutputNodeTypeCounts(stream *Out, node_stats *Stats)
+{
+    char *Separator = "";
+    for(u32 Type = 0; Type < Node_Count; ++Type)
+    {
+        if(Stats->TypeCounts[Type])
+        {
+            Outf(Out, "%s%.*s %u", Separator, ExpandString(GetNodeTypeName((node_type)Type)), Stats->TypeCounts[Type]);
+            Separator = ", ";
+        }
+    }
+}
+
+internal b32 WriteNodeStats(node_stats_file *File, char *FileName)
+{
+    b32 Result = false;
+
+    FILE *Handle = fopen(FileName, "wb");
+    if(Handle)
+    {
+        stream Out = OnFile(Handle);
+        Outf(&Out, "// Written by -nodes-record: the live nodes of every routine, by type\n");
+        for(node_stats_entry *Entry = File->First; Entry; Entry = Entry->Next)
+        {
+            if(Entry->Failed)
+            {
+                Outf(&Out, "%.*s: failed;\n", ExpandString(Entry->Name));
+            }
+            else
+            {
+                Outf(&Out, "%.*s: %u (", ExpandString(Entry->Name), Entry->Stats.NodeCount);
+                OutputNodeTypeCounts(&Out, &Entry->Stats);
+                Outf(&Out, ");\n");
+            }
+        }
+
+        fclose(Handle);
+        Result = true;
+    }
+
+    return Result;
+}
+
+/* NOTE(alex): A golden file is just a list of
+
+       Name: NodeCount (type count, type count, ...);
+       Name: failed;
+
+   so it gets read with the same tokenizer as the source.
+*/
+internal node_stats_entry *ReadNodeStats(node_stats_file *File, char *FileName, stream *Errors, b32 *Valid)
+{
+    node_stats_entry *First = 0;
+    node_stats_entry *Last = 0;
+
+    *Valid = false;
+
+    FILE *Handle = fopen(FileName, "rb");
+    if(Handle)
+    {
+        fseek(Handle, 0, SEEK_END);
+        umm Size = ftell(Handle);
+        fseek(Handle, 0, SEEK_SET);
+
+        char *Contents = PushArray(&File->Arena, Size, char, NoClear());
+        b32 Read = (fread(Contents, Size, 1, Handle) == 1) || (Size == 0);
+        fclose(Handle);
+
+        if(Read)
+        {
+            tokenizer Tokenizer = Tokenize(BundleString(Size, Contents), WrapZ(FileName), Errors);
+            while(Parsing(&Tokenizer) && !OptionalToken(&Tokenizer, Token_EndOfStream))
+            {
+                token Name = RequireToken(&Tokenizer, Token_Identifier);
+                RequireToken(&Tokenizer, Token_Colon);
+
+                node_stats_entry *Entry = PushStruct(&File->Arena, node_stats_entry);
+                Entry->Name = Name.Text;
+
+                token Failed = PeekToken(&Tokenizer);
+                if((Failed.Type == Token_Identifier) && TokenEquals(Failed, "failed"))
+                {
+                    GetToken(&Tokenizer);
+                    Entry->Failed = true;
+                }
+                else
+                {
+                    Entry->Stats.NodeCount = RequireToken(&Tokenizer, Token_Number).S32;
+
+                    RequireToken(&Tokenizer, Token_OpenParen);
+                    while(Parsing(&Tokenizer) && !OptionalToken(&Tokenizer, Token_CloseParen))
+                    {
+                        token TypeName = RequireToken(&Tokenizer, Token_Identifier);
+                        s32 Count = RequireToken(&Tokenizer, Token_Number).S32;
+
+                        u32 Type = 0;
+                        while((Type < Node_Count) && !StringsAreEqual(GetNodeTypeName((node_type)Type), TypeName.Text))
+                        {
+                            ++Type;
+                        }
+
+                        if(Type < Node_Count)
+                        {
+                            Entry->Stats.TypeCounts[Type] = Count;
+                        }
+                        else if(Parsing(&Tokenizer))
+                        {
+                            Error(&Tokenizer, TypeName, "Unknown node type");
+                        }
+
+                        if(PeekToken(&Tokenizer).Type != Token_CloseParen)
+                        {
+                            RequireToken(&Tokenizer, Token_Comma);
+                        }
+                    }
+                }
+
+                RequireToken(&Tokenizer, Token_Semicolon);
+
+                if(Last)
+                {
+                    Last->Next = Entry;
+                }
+                else
+                {
+                    First = Entry;
+                }
+                Last = Entry;
+            }
+
+            *Valid = Parsing(&Tokenizer);
+        }
+    }
+    else
+    {
+        Outf(Errors, "Error: Cannot open golden file \"%s\", -nodes-record writes it\n", FileName);
+    }
+
+    return First;
+}
+
+internal void OutputNodeTypeChanges(stream *Out, node_stats *Golden, node_stats *Stats)
+{
+    char *Separator = "";
+    for(u32 Type = 0; Type < Node_Count; ++Type)
+    {
+        s32 Change = (s32)Stats->TypeCounts[Type] - (s32)Golden->TypeCounts[Type];
+        if(Change)
+        {
+            Outf(Out, "%s%.*s %s%d", Separator, ExpandString(GetNodeTypeName((node_type)Type)),
+                 (Change > 0) ? "+" : "", Change);
+            Separator = ", ";
+        }
+    }
+}
+
+internal b32 CheckNodeStats(node_stats_file *File, char *GoldenFileName, u32 SlackPercent,
+                            stream *Out, stream *Errors)
+{
+    b32 Valid = false;
+    node_stats_entry *Golden = ReadNodeStats(File, GoldenFileName, Errors, &Valid);
+
+    u32 CheckedCount = 0;
+    u32 FailedCount = 0;
+    for(node_stats_entry *Entry = File->First; Valid && Entry; Entry = Entry->Next)
+    {
+        node_stats *Stats = &Entry->Stats;
+
+        ++CheckedCount;
+        node_stats_entry *GoldenEntry = FindNodeStats(Golden, Entry->Name);
+        if(!GoldenEntry)
+        {
+            Outf(Errors, "Error: %.*s isn't in \"%s\", -nodes-record adds it\n",
+                 ExpandString(Entry->Name), GoldenFileName);
+            ++FailedCount;
+        }
+        else if(Entry->Failed)
+        {
+            if(!GoldenEntry->Failed)
+            {
+                Outf(Errors, "Error: %.*s compiled in \"%s\", but doesn't anymore\n",
+                     ExpandString(Entry->Name), GoldenFileName);
+                ++FailedCount;
+            }
+        }
+        else if(GoldenEntry->Failed)
+        {
+            Outf(Out, "--- %.*s compiles now, -nodes-record keeps it ---\n",
+                 ExpandString(Entry->Name));
+        }
+        else
+        {
+            node_stats *Expected = &GoldenEntry->Stats;
+
+            // NOTE(alex): Rounded down, so with the default of no slack at
+            // all any growth fails.
+            u32 Budget = Expected->NodeCount + (Expected->NodeCount*SlackPercent) / 100;
+            if(Stats->NodeCount > Budget)
+            {
+                Outf(Errors, "Error: %.*s has %u live nodes, over its budget of %u in \"%s\" (",
+                     ExpandString(Entry->Name), Stats->NodeCount, Budget, GoldenFileName);
+                OutputNodeTypeChanges(Errors, Expected, Stats);
+                Outf(Errors, ")\n");
+                ++FailedCount;
+            }
+            else if(Stats->NodeCount != Expected->NodeCount)
+            {
+                Outf(Out, "--- %.*s went from %u to %u live nodes (",
+                     ExpandString(Entry->Name), Expected->NodeCount, Stats->NodeCount);
+                OutputNodeTypeChanges(Out, Expected, Stats);
+                Outf(Out, "), -nodes-record keeps it ---\n");
+            }
+        }
+    }
+
+    for(node_stats_entry *GoldenEntry = Golden; Valid && GoldenEntry; GoldenEntry = GoldenEntry->Next)
+    {
+        if(!FindNodeStats(File->First, GoldenEntry->Name))
+        {
+            Outf(Errors, "Error: %.*s is in \"%s\", but wasn't compiled\n",
+                 ExpandString(GoldenEntry->Name), GoldenFileName);
+            ++CheckedCount;
+            ++FailedCount;
+        }
+    }
+
+    if(Valid)
+    {
+        Outf(Out, "--- Node budget: %u of %u routines over \"%s\" ---\n",
+             FailedCount, CheckedCount, GoldenFileName);
+    }
+
+    b32 Result = (Valid && (FailedCount == 0));
+    return Result;
+}
@@ -0,0 +1,71 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): The "(%u nodes)" at the end of a procedure is every node that
+   got made while parsing it. What's left once the peepholes are done is only
+   what's still reachable from End, and that is what ends up as code, so
+   that's what gets counted here, in total and by node type.
+
+   -nodes-record writes the counts for every routine of a file into a golden
+   file, and -nodes-check compares against it. A routine that grew by more
+   than -nodes-slack percent fails the check, one that shrank just says so,
+   so the golden file can be recorded again. tests/golden has the files for
+   the tests, and test.bat checks all of them.
+
+   A routine that doesn't compile is written as failed instead of its
+   counts, so the tests that use what isn't implemented yet still have a
+   golden file. One that compiled in the golden file and doesn't anymore
+   (or is gone) fails the check.
+*/
+
+#define NODE_STATS_EXTENSION ".nodes"
+
+enum node_stats_mode
+{
+    NodeStats_None,
+    NodeStats_Record,
+    NodeStats_Check,
+};
+
+struct node_stats
+{
+    u32 NodeCount;
+    u32 TypeCounts[Node_Count];
+};
+
+struct node_stats_entry
+{
+    string Name;
+    b32 Failed;
+    node_stats Stats;
+
+    node_stats_entry *Next;
+};
+
+struct node_stats_file
+{
+    memory_arena Arena;
+
+    // NOTE(alex): In the order the routines appear in the source
+    node_stats_entry *First;
+    node_stats_entry *Last;
+};
+
+internal void CountLiveNodes(memory_arena *Arena, node *EndNode, u32 NodeCapacity, node_stats *Stats);
+
+internal node_stats_file *BeginNodeStats(void);
+internal void EndNodeStats(node_stats_file *File);
+internal void AddNodeStats(node_stats_file *File, string Name, node_stats *Stats);
+internal void AddFailedNodeStats(node_stats_file *File, string Name);
+internal b32 WriteNodeStats(node_stats_file *File, char *FileName);
+internal b32 CheckNodeStats(node_stats_file *File, char *GoldenFileName, u32 SlackPercent,
+                            stream *Out, stream *Errors);
@@ -0,0 +1,608 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+//
+// NOTE(alex): Writing
+//
+
+internal void WriteNodeTraceEntry(stream *Dest, node_trace_entry *Entry)
+{
+    u8 Buffer[sizeof(node_trace_event) + sizeof(Entry->Operands) + 3*sizeof(u32) + sizeof(data_type)];
+    u8 *At = Buffer;
+
+    node_trace_event *Event = (node_trace_event *)At;
+    Event->Op = (u8)Entry->Op;
+    Event->Type = (u8)Entry->Type;
+    Event->OperandMask = (u8)Entry->OperandMask;
+    Event->Flags = 0;
+    Event->ID = Entry->ID;
+    At += sizeof(node_trace_event);
+
+    for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+    {
+        if(Entry->OperandMask & (1 << OperandIndex))
+        {
+            Copy(sizeof(u32), &Entry->Operands[OperandIndex], At);
+            At += sizeof(u32);
+        }
+    }
+
+    if(Entry->Index)
+    {
+        Event->Flags |= NodeTraceFlag_Index;
+        Copy(sizeof(u32), &Entry->Index, At);
+        At += sizeof(u32);
+    }
+
+    if(Entry->DataType.Class || Entry->DataType.Flags || Entry->DataType.Value)
+    {
+        Event->Flags |= NodeTraceFlag_DataType;
+        Copy(sizeof(data_type), &Entry->DataType, At);
+        At += sizeof(data_type);
+    }
+
+    if((Entry->Op == NodeTrace_Peephole) || (Entry->Op == NodeTrace_EndRoutine))
+    {
+        Event->Flags |= NodeTraceFlag_Result;
+        Copy(sizeof(u32), &Entry->Result, At);
+        At += sizeof(u32);
+    }
+
+    if(Entry->Op == NodeTrace_BeginRoutine)
+    {
+        Event->Flags |= NodeTraceFlag_Name;
+        u32 NameCount = (u32)Entry->Name.Count;
+        Copy(sizeof(u32), &NameCount, At);
+        At += sizeof(u32);
+    }
+
+    WriteToStream(Dest, At - Buffer, Buffer);
+    if(Event->Flags & NodeTraceFlag_Name)
+    {
+        WriteToStream(Dest, Entry->Name.Count, Entry->Name.Data);
+    }
+}
+
+internal void BeginNodeTraceFile(stream *Dest, b32 DisablePeephole)
+{
+    node_trace_header Header = {};
+    Header.Magic = NODE_TRACE_MAGIC;
+    Header.Version = NODE_TRACE_VERSION;
+    Header.DisablePeephole = DisablePeephole;
+    WriteToStream(Dest, sizeof(Header), &Header);
+}
+
+internal void SetTraceOperands(node_trace_entry *Entry, node *Node)
+{
+    for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+    {
+        node *Operand = GetOperand(Node, OperandIndex);
+        if(Operand)
+        {
+            Entry->OperandMask |= (1 << OperandIndex);
+            Entry->Operands[OperandIndex] = Operand->ID;
+        }
+    }
+}
+
+internal void FlushPendingNode(node_trace *Trace)
+{
+    node *Node = Trace->Pending;
+    if(Node)
+    {
+        node_trace_entry Entry = {};
+        Entry.Op = NodeTrace_Create;
+        Entry.Type = Node->Type;
+        Entry.ID = Node->ID;
+        Entry.Index = Node->Index;
+        Entry.DataType = Node->DataType;
+        SetTraceOperands(&Entry, Node);
+        WriteNodeTraceEntry(Trace->Dest, &Entry);
+
+        Trace->Pending = 0;
+    }
+}
+
+// NOTE(alex): Returns the trace only if the operation should be written down
+internal node_trace *BeginNodeTrace(parser *Parser)
+{
+    node_trace *Result = 0;
+
+    node_trace *Trace = Parser->NodeTrace;
+    if(Trace)
+    {
+        if(Trace->Depth++ == 0)
+        {
+            FlushPendingNode(Trace);
+            Result = Trace;
+        }
+    }
+
+    return Result;
+}
+
+internal void EndNodeTrace(parser *Parser)
+{
+    node_trace *Trace = Parser->NodeTrace;
+    if(Trace)
+    {
+        Assert(Trace->Depth > 0);
+        --Trace->Depth;
+    }
+}
+
+internal void TraceNodeCreated(node_trace *Trace, node *Node)
+{
+    Assert(!Trace->Pending);
+    Trace->Pending = Node;
+}
+
+internal void TraceNodeEvent(node_trace *Trace, node_trace_op Op, u32 ID)
+{
+    node_trace_entry Entry = {};
+    Entry.Op = Op;
+    Entry.ID = ID;
+    WriteNodeTraceEntry(Trace->Dest, &Entry);
+}
+
+internal void TracePeephole(node_trace *Trace, u32 ID, u32 ResultID)
+{
+    node_trace_entry Entry = {};
+    Entry.Op = NodeTrace_Peephole;
+    Entry.ID = ID;
+    Entry.Result = ResultID;
+    WriteNodeTraceEntry(Trace->Dest, &Entry);
+}
+
+internal void BeginRoutineTrace(parser *Parser, string Name)
+{
+    node_trace *Trace = Parser->NodeTrace;
+    if(Trace)
+    {
+        node_trace_entry Entry = {};
+        Entry.Op = NodeTrace_BeginRoutine;
+        Entry.Name = Name;
+        WriteNodeTraceEntry(Trace->Dest, &Entry);
+    }
+}
+
+internal void EndRoutineTrace(parser *Parser)
+{
+    node_trace *Trace = Parser->NodeTrace;
+    if(Trace)
+    {
+        Assert(Trace->Depth == 0);
+        FlushPendingNode(Trace);
+
+        // NOTE(alex): End gets its operands without any of the traced
+        // operations, so they're written down here.
+        node *EndNode = Parser->EndNode;
+
+        node_stats Stats;
+        CountLiveNodes(&Parser->Arena, EndNode, Parser->NextNodeID, &Stats);
+
+        node_trace_entry Entry = {};
+        Entry.Op = NodeTrace_EndRoutine;
+        Entry.ID = EndNode->ID;
+        Entry.Index = Parser->NextNodeID;
+        Entry.Result = Stats.NodeCount;
+        SetTraceOperands(&Entry, EndNode);
+        WriteNodeTraceEntry(Trace->Dest, &Entry);
+
+        Parser->NodeTrace = 0;
+    }
+}
+
+//
+// NOTE(alex): Replaying
+//
+
+struct node_trace_reader
+{
+    u8 *At;
+    u8 *End;
+    b32 Valid;
+};
+
+internal b32 ReadFromTrace(node_trace_reader *Reader, umm Size, void *Dest)
+{
+    if(Reader->Valid && (Size <= (umm)(Reader->End - Reader->At)))
+    {
+        Copy(Size, Reader->At, Dest);
+        Reader->At += Size;
+    }
+    else
+    {
+        Reader->Valid = false;
+    }
+
+    return Reader->Valid;
+}
+
+internal b32 ReadNodeTraceEntry(node_trace_reader *Reader, node_trace_entry *Entry)
+{
+    ZeroStruct(*Entry);
+
+    node_trace_event Event;
+    if(ReadFromTrace(Reader, sizeof(Event), &Event))
+    {
+        Entry->Op = (node_trace_op)Event.Op;
+        Entry->Type = (node_type)Event.Type;
+        Entry->ID = Event.ID;
+        Entry->OperandMask = Event.OperandMask;
+
+        Reader->Valid = ((Event.Op < NodeTrace_Count) &&
+                         (Event.Type < Node_Count) &&
+                         (Event.OperandMask < (1 << MAX_NODE_OPERAND_COUNT)));
+
+        for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+        {
+            if(Event.OperandMask & (1 << OperandIndex))
+            {
+                ReadFromTrace(Reader, sizeof(u32), &Entry->Operands[OperandIndex]);
+            }
+        }
+
+        if(Event.Flags & NodeTraceFlag_Index)
+        {
+            ReadFromTrace(Reader, sizeof(u32), &Entry->Index);
+        }
+
+        if(Event.Flags & NodeTraceFlag_DataType)
+        {
+            ReadFromTrace(Reader, sizeof(data_type), &Entry->DataType);
+        }
+
+        if(Event.Flags & NodeTraceFlag_Result)
+        {
+            ReadFromTrace(Reader, sizeof(u32), &Entry->Result);
+        }
+
+        if(Event.Flags & NodeTraceFlag_Name)
+        {
+            u32 NameCount = 0;
+            if(ReadFromTrace(Reader, sizeof(u32), &NameCount) &&
+               (NameCount <= (umm)(Reader->End - Reader->At)))
+            {
+                Entry->Name = BundleString(NameCount, (char *)Reader->At);
+                Reader->At += NameCount;
+            }
+            else
+            {
+                Reader->Valid = false;
+            }
+        }
+    }
+
+    return Reader->Valid;
+}
+
+struct node_trace_routine
+{
+    string Name;
+
+    // NOTE(alex): Everything between the begin and the end event
+    u8 *Events;
+    u8 *EventsEnd;
+    u32 EventCount;
+    u32 PeepholeCount;
+
+    node_trace_entry End;
+};
+
+/* NOTE(alex): Everything gets checked once up front, so replaying can
+   trust the trace: every routine is complete, and every ID in it is below
+   the number of IDs the routine used.
+*/
+internal node_trace_routine *ScanNodeTrace(memory_arena *Arena, string Contents, u32 *RoutineCount,
+                                           node_trace_header *Header)
+{
+    node_trace_routine *Routines = 0;
+    u32 Count = 0;
+
+    node_trace_reader Reader = {};
+    Reader.At = (u8 *)Contents.Data;
+    Reader.End = Reader.At + Contents.Count;
+    Reader.Valid = true;
+
+    b32 Valid = (ReadFromTrace(&Reader, sizeof(*Header), Header) &&
+                 (Header->Magic == NODE_TRACE_MAGIC) &&
+                 (Header->Version == NODE_TRACE_VERSION));
+    if(Valid)
+    {
+        // NOTE(alex): Every routine needs at least a begin and an end event
+        u32 MaxRoutineCount = (u32)((Reader.End - Reader.At) / (2*sizeof(node_trace_event)));
+        Routines = PushArray(Arena, MaxRoutineCount, node_trace_routine);
+    }
+
+    while(Valid && (Reader.At < Reader.End))
+    {
+        node_trace_routine *Routine = Routines + Count++;
+
+        node_trace_entry Entry;
+        Valid = (ReadNodeTraceEntry(&Reader, &Entry) && (Entry.Op == NodeTrace_BeginRoutine));
+        Routine->Name = Entry.Name;
+        Routine->Events = Reader.At;
+
+        while(Valid)
+        {
+            u8 *EventStart = Reader.At;
+            Valid = ReadNodeTraceEntry(&Reader, &Entry) && (Entry.Op != NodeTrace_BeginRoutine);
+            if(Valid && (Entry.Op == NodeTrace_EndRoutine))
+            {
+                Routine->EventsEnd = EventStart;
+                Routine->End = Entry;
+                break;
+            }
+
+            ++Routine->EventCount;
+            if(Entry.Op == NodeTrace_Peephole)
+            {
+                ++Routine->PeepholeCount;
+            }
+        }
+
+        // NOTE(alex): Index of the end event is how many IDs there are
+        u32 NodeCapacity = Routine->End.Index;
+        node_trace_reader Check = {Routine->Events, Reader.At, Valid};
+        while(Valid && (Check.At < Check.End))
+        {
+            Valid = ReadNodeTraceEntry(&Check, &Entry) && (Entry.ID < NodeCapacity);
+            for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+            {
+                if(Entry.OperandMask & (1 << OperandIndex))
+                {
+                    Valid &= (Entry.Operands[OperandIndex] < NodeCapacity);
+                }
+            }
+
+            if(Entry.Op == NodeTrace_Peephole)
+            {
+                Valid &= (Entry.Result < NodeCapacity);
+            }
+        }
+    }
+
+    *RoutineCount = Count;
+    if(!Valid)
+    {
+        Routines = 0;
+        *RoutineCount = 0;
+    }
+
+    return Routines;
+}
+
+// NOTE(alex): Returns how many events went as recorded, which is all of
+// them unless the routine diverged.
+internal u32 ReplayRoutine(parser *Parser, node_trace_routine *Routine, node **Nodes)
+{
+    node_trace_reader Reader = {Routine->Events, Routine->EventsEnd, true};
+
+    u32 EventIndex = 0;
+    b32 Diverged = false;
+    while(!Diverged && (EventIndex < Routine->EventCount))
+    {
+        node_trace_entry Entry;
+        ReadNodeTraceEntry(&Reader, &Entry);
+
+        node *Node = Nodes[Entry.ID];
+        switch(Entry.Op)
+        {
+            default:
+            {
+                Diverged = true;
+            } break;
+
+            case NodeTrace_Create:
+            {
+                node *Operands[MAX_NODE_OPERAND_COUNT] = {};
+                for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+                {
+                    if(Entry.OperandMask & (1 << OperandIndex))
+                    {
+                        Operands[OperandIndex] = Nodes[Entry.Operands[OperandIndex]];
+                        Diverged |= !Operands[OperandIndex];
+                    }
+                }
+
+                if(!Diverged && (Entry.Type == Node_Constant))
+                {
+                    // NOTE(alex): Has to go through the table, so the folds
+                    // later on find it again. It may well be there already.
+                    Node = GetOrCreateConstant(Parser, Entry.DataType);
+
+                    Diverged = (Node->ID != Entry.ID);
+                    Nodes[Entry.ID] = Node;
+                }
+                else if(!Diverged)
+                {
+                    Node = GetOrCreateNodeInternal(Parser, Entry.Type, ArrayCount(Operands), Operands);
+                    Node->Index = Entry.Index;
+                    Node->DataType = Entry.DataType;
+
+                    Diverged = (Node->ID != Entry.ID);
+                    Nodes[Entry.ID] = Node;
+                }
+            } break;
+
+            case NodeTrace_Peephole:
+            {
+                Diverged = !Node;
+                if(!Diverged)
+                {
+                    node *Peepholed = Peephole(Parser, Node);
+
+                    Diverged = (Peepholed->ID != Entry.Result);
+                    Nodes[Entry.Result] = Peepholed;
+                }
+            } break;
+
+            case NodeTrace_AddReference:
+            {
+                Diverged = !Node;
+                if(!Diverged)
+                {
+                    AddReference(Parser, Node);
+                }
+            } break;
+
+            case NodeTrace_RemoveReference:
+            {
+                Diverged = (!Node || (Node->RefCount == 0));
+                if(!Diverged)
+                {
+                    RemoveReference(Parser, Node);
+                }
+            } break;
+        }
+
+        if(!Diverged)
+        {
+            ++EventIndex;
+        }
+    }
+
+    return EventIndex;
+}
+
+// NOTE(alex): Hooks End up the way the parser left it, and checks that the
+// same nodes are live as when the trace was written.
+internal b32 FinishReplayedRoutine(parser *Parser, node_trace_routine *Routine, node **Nodes)
+{
+    node_trace_entry *Entry = &Routine->End;
+
+    node *EndNode = Nodes[Entry->ID];
+    b32 Result = (EndNode && (EndNode->Type == Node_End));
+    for(u32 OperandIndex = 0; Result && (OperandIndex < MAX_NODE_OPERAND_COUNT); ++OperandIndex)
+    {
+        node *Operand = 0;
+        if(Entry->OperandMask & (1 << OperandIndex))
+        {
+            Operand = Nodes[Entry->Operands[OperandIndex]];
+            Result = (Operand != 0);
+        }
+        (&EndNode->Array)[OperandIndex] = Operand;
+    }
+
+    if(Result)
+    {
+        node_stats Stats;
+        CountLiveNodes(&Parser->Arena, EndNode, Parser->NextNodeID, &Stats);
+        Result = (Stats.NodeCount == Entry->Result);
+    }
+
+    return Result;
+}
+
+internal void ReplayNodeTrace(string Contents, u32 RunCount, node_trace_replay_result *Result)
+{
+    ZeroStruct(*Result);
+
+    memory_arena Arena = {};
+
+    node_trace_header Header;
+    u32 RoutineCount = 0;
+    node_trace_routine *Routines = ScanNodeTrace(&Arena, Contents, &RoutineCount, &Header);
+
+    Result->Valid = (Routines != 0);
+    Result->DisablePeephole = Header.DisablePeephole;
+    Result->RoutineCount = RoutineCount;
+
+    stream Discard = {};
+
+    u64 StartCycles = __rdtsc();
+    u64 StartMicroseconds = GetWallClockMicroseconds();
+
+    RunCount = Maximum(RunCount, 1);
+    for(u32 RunIndex = 0; Result->Valid && (RunIndex < RunCount); ++RunIndex)
+    {
+        u64 Cycles = 0;
+
+        parser *Parser = BootstrapParser();
+        Parser->Out = &Discard;
+        Parser->Errors = &Discard;
+        Parser->DisablePeephole = Header.DisablePeephole;
+
+        for(u32 RoutineIndex = 0; RoutineIndex < RoutineCount; ++RoutineIndex)
+        {
+            node_trace_routine *Routine = Routines + RoutineIndex;
+
+            // NOTE(alex): The same as BeginGraph, minus the nodes, which are
+            // in the trace.
+            parser *RoutineParser = BeginChildParser(Parser);
+            RoutineParser->FirstFreeNode = 0;
+            RoutineParser->NextNodeID = 0;
+            InitHashTable(&RoutineParser->Constants, &RoutineParser->Arena);
+            RoutineParser->MostRecentVariable = 0;
+            RoutineParser->FirstFreeVariable = 0;
+
+            node **Nodes = PushArray(&RoutineParser->Arena, Routine->End.Index, node *);
+
+            u64 RoutineStartCycles = __rdtsc();
+            u32 ReplayedCount = ReplayRoutine(RoutineParser, Routine, Nodes);
+            Cycles += __rdtsc() - RoutineStartCycles;
+
+            if(RunIndex == 0)
+            {
+                Result->EventCount += Routine->EventCount;
+                Result->PeepholeCount += Routine->PeepholeCount;
+                Result->NodeCount += RoutineParser->NextNodeID;
+
+                if((ReplayedCount != Routine->EventCount) ||
+                   !FinishReplayedRoutine(RoutineParser, Routine, Nodes))
+                {
+                    if(!Result->DivergedCount)
+                    {
+                        Result->FirstDivergedName = Routine->Name;
+                        Result->FirstDivergedEvent = ReplayedCount;
+                    }
+                    ++Result->DivergedCount;
+                }
+            }
+
+            EndChildParser(RoutineParser);
+        }
+
+        FreeParser(Parser);
+
+        if((RunIndex == 0) || (Cycles < Result->Cycles))
+        {
+            Result->Cycles = Cycles;
+        }
+    }
+
+    u64 ElapsedCycles = __rdtsc() - StartCycles;
+    u64 ElapsedMicroseconds = GetWallClockMicroseconds() - StartMicroseconds;
+    Result->CyclesPerSecond = ElapsedMicroseconds ? (1000000.0*(f64)ElapsedCycles / (f64)ElapsedMicroseconds) : 0.0;
+
+    Clear(&Arena);
+}
+
+internal void OutputNodeTraceReplay(stream *Out, char *FileName, u32 RunCount, node_trace_replay_result *Result)
+{
+    f64 Seconds = (Result->CyclesPerSecond > 0.0) ? ((f64)Result->Cycles / Result->CyclesPerSecond) : 0.0;
+
+    Outf(Out, "--- Replay %s: %u routines, %llu events, %llu nodes, %llu peepholes%s (best of %u) ---\n",
+         FileName, Result->RoutineCount, Result->EventCount, Result->NodeCount, Result->PeepholeCount,
+         Result->DisablePeephole ? " (-nopeephole)" : "", RunCount);
+    Outf(Out, "--- %.3f ms, %llu events/s, %llu nodes/s ---\n", 1000.0*Seconds,
+         (u64)((Seconds > 0.0) ? ((f64)Result->EventCount / Seconds) : 0.0),
+         (u64)((Seconds > 0.0) ? ((f64)Result->NodeCount / Seconds) : 0.0));
+
+    if(Result->DivergedCount)
+    {
+        Outf(Out, "--- %u of %u routines diverged from the trace, the first was %.*s after %u events ---\n",
+             Result->DivergedCount, Result->RoutineCount, ExpandString(Result->FirstDivergedName),
+             Result->FirstDivergedEvent);
+    }
+}
@@ -0,0 +1,150 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): -trace-nodes writes down everything the parser asks of the
+   node graph while it builds a routine: every node it creates, every
+   peephole it runs, and every reference it adds or removes. -replay then
+   does exactly the same to a fresh graph, straight from the trace, so the
+   graph and the peepholes can be measured without the tokenizer and the
+   parser getting in the way, on whatever program the trace came from.
+
+   Only what the parser itself does is written down. What those operations
+   do on the way (the nodes a peephole makes, the references that go away
+   with a node) happens again when they get replayed, so if they start
+   doing something else, the nodes stop getting the IDs they had, and the
+   routine is reported as having diverged from the trace.
+
+   A trace is a header followed by the routines, each of which is a begin
+   event, its node events, and an end event. Every event is an eight byte
+   node_trace_event, followed by whatever its flags and operand mask say.
+   Cached routines aren't parsed, so they aren't in the trace either.
+*/
+
+#define NODE_TRACE_VERSION 2
+#define NODE_TRACE_MAGIC 0x544E4D4D // NOTE(alex): "MMNT"
+#define NODE_TRACE_EXTENSION ".trace"
+
+struct node_trace_header
+{
+    u32 Magic;
+    u32 Version;
+
+    // NOTE(alex): The peepholes have to be off for the replay too, or it
+    // diverges at the first one.
+    b32 DisablePeephole;
+    u32 Reserved;
+};
+
+enum node_trace_op
+{
+    NodeTrace_BeginRoutine,
+    NodeTrace_EndRoutine,
+    NodeTrace_Create,
+    NodeTrace_Peephole,
+    NodeTrace_AddReference,
+    NodeTrace_RemoveReference,
+
+    NodeTrace_Count,
+};
+
+enum node_trace_flags
+{
+    NodeTraceFlag_Index = 0x1,
+    NodeTraceFlag_DataType = 0x2,
+    NodeTraceFlag_Result = 0x4,
+    NodeTraceFlag_Name = 0x8,
+};
+
+// NOTE(alex): Followed by one u32 ID per bit in OperandMask, then the
+// Index, the data_type, the result and the name, if their flag is set.
+struct node_trace_event
+{
+    u8 Op;
+    u8 Type;
+    u8 OperandMask;
+    u8 Flags;
+    u32 ID;
+};
+
+/* NOTE(alex): An event with everything that can follow it. What the fields
+   mean depends on the op:
+
+   Create: the node that was made, with its operands and final Index and
+   DataType (Proj and Constant set them right after they're made). For a
+   constant, it's the one the parser got, which may be one made earlier.
+
+   Peephole: ID went in, Result came out.
+
+   BeginRoutine: just the Name.
+
+   EndRoutine: ID and Operands are End's, Index is how many IDs the routine
+   used, and Result how many nodes were still live, as a check on the replay.
+*/
+struct node_trace_entry
+{
+    node_trace_op Op;
+    node_type Type;
+    u32 ID;
+    u32 OperandMask;
+    u32 Operands[MAX_NODE_OPERAND_COUNT];
+    u32 Index;
+    data_type DataType;
+    u32 Result;
+    string Name;
+};
+
+struct node_trace
+{
+    stream *Dest;
+
+    // NOTE(alex): Above zero while one of the traced operations is running,
+    // so the ones it does on the way aren't traced.
+    u32 Depth;
+
+    // NOTE(alex): A created node is only written once the next event comes
+    // along, by which time whoever made it is done setting it up.
+    node *Pending;
+};
+
+struct node_trace_replay_result
+{
+    b32 Valid;
+    b32 DisablePeephole;
+
+    u32 RoutineCount;
+    u64 EventCount;
+    u64 NodeCount;
+    u64 PeepholeCount;
+
+    u32 DivergedCount;
+    string FirstDivergedName;
+    u32 FirstDivergedEvent;
+
+    // NOTE(alex): The best of all the runs
+    u64 Cycles;
+    f64 CyclesPerSecond;
+};
+
+struct parser;
+
+internal void BeginNodeTraceFile(stream *Dest, b32 DisablePeephole);
+internal void BeginRoutineTrace(parser *Parser, string Name);
+internal void EndRoutineTrace(parser *Parser);
+
+internal node_trace *BeginNodeTrace(parser *Parser);
+internal void EndNodeTrace(parser *Parser);
+internal void TraceNodeCreated(node_trace *Trace, node *Node);
+internal void TraceNodeEvent(node_trace *Trace, node_trace_op Op, u32 ID);
+internal void TracePeephole(node_trace *Trace, u32 ID, u32 ResultID);
+
+internal void ReplayNodeTrace(string Contents, u32 RunCount, node_trace_replay_result *Result);
+internal void OutputNodeTraceReplay(stream *Out, char *FileName, u32 RunCount, node_trace_replay_result *Result);
@@ -0,0 +1,470 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): This writes a relocatable ELF64 object for x86-64 directly,
+   without going through an assembler. We only need a tiny slice of the
+   format, so the structures are spelled out here rather than pulling in
+   <elf.h>, which doesn't exist on Windows anyway.
+
+   The section layout is always the same:
+
+   0 (null)
+   1 .text
+   2 .rodata
+   3 .rela.text
+   4 .symtab
+   5 .strtab
+   6 .shstrtab
+   7 .note.GNU-stack (empty, so the linker doesn't make the stack executable)
+
+   The symbol table starts with the null symbol and the section symbols for
+   .text and .rodata, which are the only locals. Every symbol in the builder
+   is global, and they follow in the order they were added.
+*/
+
+#define ELF_SECTION_COUNT 8
+#define ELF_LOCAL_SYMBOL_COUNT 3
+
+struct elf64_header
+{
+    u8 Ident[16];
+    u16 Type;
+    u16 Machine;
+    u32 Version;
+    u64 Entry;
+    u64 ProgramHeaderOffset;
+    u64 SectionHeaderOffset;
+    u32 Flags;
+    u16 HeaderSize;
+    u16 ProgramHeaderSize;
+    u16 ProgramHeaderCount;
+    u16 SectionHeaderSize;
+    u16 SectionHeaderCount;
+    u16 SectionNameIndex;
+};
+
+struct elf64_section_header
+{
+    u32 Name;
+    u32 Type;
+    u64 Flags;
+    u64 Address;
+    u64 Offset;
+    u64 Size;
+    u32 Link;
+    u32 Info;
+    u64 Alignment;
+    u64 EntrySize;
+};
+
+struct elf64_symbol
+{
+    u32 Name;
+    u8 Info;
+    u8 Other;
+    u16 SectionIndex;
+    u64 Value;
+    u64 Size;
+};
+
+struct elf64_rela
+{
+    u64 Offset;
+    u64 Info;
+    s64 Addend;
+};
+
+enum elf_constants
+{
+    ELFType_Relocatable = 1,
+    ELFMachine_X64 = 62,
+
+    ELFSection_ProgramBits = 1,
+    ELFSection_SymbolTable = 2,
+    ELFSection_StringTable = 3,
+    ELFSection_Rela = 4,
+
+    ELFSectionFlag_Write = 0x1,
+    ELFSectionFlag_Alloc = 0x2,
+    ELFSectionFlag_Execute = 0x4,
+    ELFSectionFlag_InfoLink = 0x40,
+
+    ELFSymbol_NoType = 0,
+    ELFSymbol_Function = 2,
+    ELFSymbol_Section = 3,
+
+    ELFBinding_Local = 0,
+    ELFBinding_Global = 1,
+
+    ELFRelocation_PC32 = 2,
+    ELFRelocation_PLT32 = 4,
+};
+
+#define ELFSymbolInfo(Binding, Type) (u8)(((Binding) << 4) | (Type))
+#define ELFRelaInfo(Symbol, Type) (((u64)(Symbol) << 32) | (u64)(Type))
+
+internal object_builder *BeginObject(void)
+{
+    object_builder *Object = BootstrapPushStruct(object_builder, Arena);
+    return Object;
+}
+
+internal void EndObject(object_builder *Object)
+{
+    Clear(&Object->Arena);
+}
+
+internal void ReserveBuffer(memory_arena *Arena, object_buffer *Buffer, umm Size)
+{
+    if((Buffer->Size + Size) > Buffer->Capacity)
+    {
+        // NOTE(alex): The old storage just stays in the arena, which is fine
+        // since the capacity doubles and the whole arena goes away when the
+        // object is written.
+        umm NewCapacity = Maximum(2*Buffer->Capacity, Kilobytes(4));
+        while(NewCapacity < (Buffer->Size + Size))
+        {
+            NewCapacity *= 2;
+        }
+
+        u8 *NewData = PushArray(Arena, NewCapacity, u8, AlignNoClear(16));
+        if(Buffer->Size)
+        {
+            Copy(Buffer->Size, Buffer->Data, NewData);
+        }
+
+        Buffer->Data = NewData;
+        Buffer->Capacity = NewCapacity;
+    }
+}
+
+internal u8 *ReserveText(object_builder *Object, umm Size)
+{
+    object_buffer *Text = &Object->Text;
+    ReserveBuffer(&Object->Arena, Text, Size);
+
+    u8 *Result = Text->Data + Text->Size;
+    Text->Size += Size;
+
+    return Result;
+}
+
+internal u32 AddReadOnlyString(object_builder *Object, char *Z)
+{
+    object_buffer *ReadOnly = &Object->ReadOnly;
+    umm Size = StringLength(Z) + 1;
+
+    // NOTE(alex): .rodata only ever holds a handful of format strings, so
+    // just look for an identical one first.
+    for(umm Offset = 0; (Offset + Size) <= ReadOnly->Size; ++Offset)
+    {
+        if(StringsAreEqual(Size, (char *)ReadOnly->Data + Offset, Size, Z))
+        {
+            return (u32)Offset;
+        }
+    }
+
+    ReserveBuffer(&Object->Arena, ReadOnly, Size);
+
+    u32 Result = (u32)ReadOnly->Size;
+    Copy(Size, Z, ReadOnly->Data + ReadOnly->Size);
+    ReadOnly->Size += Size;
+
+    return Result;
+}
+
+internal u32 GetOrAddSymbol(object_builder *Object, string Name)
+{
+    for(u32 SymbolIndex = 0; SymbolIndex < Object->SymbolCount; ++SymbolIndex)
+    {
+        if(StringsAreEqual(Object->Symbols[SymbolIndex].Name, Name))
+        {
+            return SymbolIndex;
+        }
+    }
+
+    if(Object->SymbolCount == Object->SymbolCapacity)
+    {
+        u32 NewCapacity = Maximum(2*Object->SymbolCapacity, 64);
+        object_symbol *NewSymbols = PushArray(&Object->Arena, NewCapacity, object_symbol, NoClear());
+        if(Object->SymbolCount)
+        {
+            CopyArray(Object->SymbolCount, Object->Symbols, NewSymbols);
+        }
+
+        Object->Symbols = NewSymbols;
+        Object->SymbolCapacity = NewCapacity;
+    }
+
+    u32 Result = Object->SymbolCount++;
+    object_symbol *Symbol = Object->Symbols + Result;
+    Symbol->Name.Count = Name.Count;
+    Symbol->Name.Data = (u8 *)PushCopy(&Object->Arena, Name.Count, Name.Data, NoClear());
+    Symbol->Section = Section_Undefined;
+    Symbol->Offset = 0;
+    Symbol->Size = 0;
+
+    return Result;
+}
+
+internal void DefineSymbol(object_builder *Object, u32 SymbolIndex, u32 Section, u32 Offset, u32 Size)
+{
+    Assert(SymbolIndex < Object->SymbolCount);
+
+    object_symbol *Symbol = Object->Symbols + SymbolIndex;
+    Symbol->Section = Section;
+    Symbol->Offset = Offset;
+    Symbol->Size = Size;
+}
+
+internal void AddRelocation(object_builder *Object, u32 Offset, object_relocation_type Type, u32 Section, u32 Symbol, s32 Addend)
+{
+    if(Object->RelocationCount == Object->RelocationCapacity)
+    {
+        u32 NewCapacity = Maximum(2*Object->RelocationCapacity, 64);
+        object_relocation *NewRelocations = PushArray(&Object->Arena, NewCapacity, object_relocation, NoClear());
+        if(Object->RelocationCount)
+        {
+            CopyArray(Object->RelocationCount, Object->Relocations, NewRelocations);
+        }
+
+        Object->Relocations = NewRelocations;
+        Object->RelocationCapacity = NewCapacity;
+    }
+
+    object_relocation *Relocation = Object->Relocations + Object->RelocationCount++;
+    Relocation->Offset = Offset;
+    Relocation->Type = Type;
+    Relocation->Section = Section;
+    Relocation->Symbol = Symbol;
+    Relocation->Addend = Addend;
+}
+
+internal u32 AddELFString(u8 *Table, u32 *Size, string String)
+{
+    u32 Result = *Size;
+    Copy(String.Count, String.Data, Table + Result);
+    Table[Result + String.Count] = 0;
+    *Size += (u32)String.Count + 1;
+
+    return Result;
+}
+
+internal b32 WriteELFObject(object_builder *Object, char *FileName)
+{
+    TIMED_FUNCTION();
+
+    b32 Result = false;
+
+    temporary_memory ImageMemory = BeginTemporaryMemory(&Object->Arena);
+
+    string SectionNames[ELF_SECTION_COUNT] =
+    {
+        ConstZ(""),
+        ConstZ(".text"),
+        ConstZ(".rodata"),
+        ConstZ(".rela.text"),
+        ConstZ(".symtab"),
+        ConstZ(".strtab"),
+        ConstZ(".shstrtab"),
+        ConstZ(".note.GNU-stack"),
+    };
+
+    //
+    // NOTE(alex): Size everything up front so the whole image can be built
+    // in one block and written out with a single call.
+    //
+
+    u32 SymbolCount = ELF_LOCAL_SYMBOL_COUNT + Object->SymbolCount;
+
+    umm StringTableSize = 1;
+    for(u32 SymbolIndex = 0; SymbolIndex < Object->SymbolCount; ++SymbolIndex)
+    {
+        StringTableSize += Object->Symbols[SymbolIndex].Name.Count + 1;
+    }
+
+    umm SectionNameTableSize = 0;
+    for(u32 SectionIndex = 0; SectionIndex < ELF_SECTION_COUNT; ++SectionIndex)
+    {
+        SectionNameTableSize += SectionNames[SectionIndex].Count + 1;
+    }
+
+    umm TextOffset = sizeof(elf64_header);
+    umm ReadOnlyOffset = TextOffset + Object->Text.Size;
+    umm RelaOffset = Align8(ReadOnlyOffset + Object->ReadOnly.Size);
+    umm RelaSize = Object->RelocationCount*sizeof(elf64_rela);
+    umm SymbolTableOffset = RelaOffset + RelaSize;
+    umm SymbolTableSize = SymbolCount*sizeof(elf64_symbol);
+    umm StringTableOffset = SymbolTableOffset + SymbolTableSize;
+    umm SectionNameTableOffset = StringTableOffset + StringTableSize;
+    umm SectionHeaderOffset = Align8(SectionNameTableOffset + SectionNameTableSize);
+    umm ImageSize = SectionHeaderOffset + ELF_SECTION_COUNT*sizeof(elf64_section_header);
+
+    u8 *Image = PushArray(&Object->Arena, ImageSize, u8, Align(16, true));
+
+    //
+    // NOTE(alex): Header
+    //
+
+    elf64_header *Header = (elf64_header *)Image;
+    Header->Ident[0] = 0x7f;
+    Header->Ident[1] = 'E';
+    Header->Ident[2] = 'L';
+    Header->Ident[3] = 'F';
+    Header->Ident[4] = 2; // NOTE(alex): 64-bit
+    Header->Ident[5] = 1; // NOTE(alex): Little endian
+    Header->Ident[6] = 1; // NOTE(alex): Current version
+    Header->Type = ELFType_Relocatable;
+    Header->Machine = ELFMachine_X64;
+    Header->Version = 1;
+    Header->SectionHeaderOffset = SectionHeaderOffset;
+    Header->HeaderSize = sizeof(elf64_header);
+    Header->SectionHeaderSize = sizeof(elf64_section_header);
+    Header->SectionHeaderCount = ELF_SECTION_COUNT;
+    Header->SectionNameIndex = 6;
+
+    //
+    // NOTE(alex): Section contents
+    //
+
+    if(Object->Text.Size)
+    {
+        Copy(Object->Text.Size, Object->Text.Data, Image + TextOffset);
+    }
+
+    if(Object->ReadOnly.Size)
+    {
+        Copy(Object->ReadOnly.Size, Object->ReadOnly.Data, Image + ReadOnlyOffset);
+    }
+
+    elf64_rela *Relas = (elf64_rela *)(Image + RelaOffset);
+    for(u32 RelocationIndex = 0; RelocationIndex < Object->RelocationCount; ++RelocationIndex)
+    {
+        object_relocation *Relocation = Object->Relocations + RelocationIndex;
+        elf64_rela *Rela = Relas + RelocationIndex;
+
+        u32 Symbol = (Relocation->Section == Section_ReadOnly) ? 2 : (ELF_LOCAL_SYMBOL_COUNT + Relocation->Symbol);
+        u32 Type = (Relocation->Type == Relocation_PLT32) ? ELFRelocation_PLT32 : ELFRelocation_PC32;
+
+        Rela->Offset = Relocation->Offset;
+        Rela->Info = ELFRelaInfo(Symbol, Type);
+        Rela->Addend = Relocation->Addend;
+    }
+
+    u8 *StringTable = Image + StringTableOffset;
+    u32 StringTableAt = 1;
+
+    elf64_symbol *Symbols = (elf64_symbol *)(Image + SymbolTableOffset);
+    Symbols[1].Info = ELFSymbolInfo(ELFBinding_Local, ELFSymbol_Section);
+    Symbols[1].SectionIndex = 1;
+    Symbols[2].Info = ELFSymbolInfo(ELFBinding_Local, ELFSymbol_Section);
+    Symbols[2].SectionIndex = 2;
+    for(u32 SymbolIndex = 0; SymbolIndex < Object->SymbolCount; ++SymbolIndex)
+    {
+        object_symbol *Source = Object->Symbols + SymbolIndex;
+        elf64_symbol *Symbol = Symbols + ELF_LOCAL_SYMBOL_COUNT + SymbolIndex;
+
+        Symbol->Name = AddELFString(StringTable, &StringTableAt, Source->Name);
+        if(Source->Section == Section_Undefined)
+        {
+            Symbol->Info = ELFSymbolInfo(ELFBinding_Global, ELFSymbol_NoType);
+        }
+        else
+        {
+            Symbol->Info = ELFSymbolInfo(ELFBinding_Global,
+                                         (Source->Section == Section_Text) ? ELFSymbol_Function : ELFSymbol_NoType);
+            Symbol->SectionIndex = (u16)Source->Section;
+            Symbol->Value = Source->Offset;
+            Symbol->Size = Source->Size;
+        }
+    }
+    Assert(StringTableAt == StringTableSize);
+
+    u8 *SectionNameTable = Image + SectionNameTableOffset;
+    u32 SectionNameTableAt = 0;
+
+    //
+    // NOTE(alex): Section headers
+    //
+
+    elf64_section_header *Sections = (elf64_section_header *)(Image + SectionHeaderOffset);
+    for(u32 SectionIndex = 0; SectionIndex < ELF_SECTION_COUNT; ++SectionIndex)
+    {
+        Sections[SectionIndex].Name = AddELFString(SectionNameTable, &SectionNameTableAt, SectionNames[SectionIndex]);
+    }
+    Assert(SectionNameTableAt == SectionNameTableSize);
+
+    elf64_section_header *Text = Sections + 1;
+    Text->Type = ELFSection_ProgramBits;
+    Text->Flags = ELFSectionFlag_Alloc|ELFSectionFlag_Execute;
+    Text->Offset = TextOffset;
+    Text->Size = Object->Text.Size;
+    Text->Alignment = 16;
+
+    elf64_section_header *ReadOnly = Sections + 2;
+    ReadOnly->Type = ELFSection_ProgramBits;
+    ReadOnly->Flags = ELFSectionFlag_Alloc;
+    ReadOnly->Offset = ReadOnlyOffset;
+    ReadOnly->Size = Object->ReadOnly.Size;
+    ReadOnly->Alignment = 1;
+
+    elf64_section_header *Rela = Sections + 3;
+    Rela->Type = ELFSection_Rela;
+    Rela->Flags = ELFSectionFlag_InfoLink;
+    Rela->Offset = RelaOffset;
+    Rela->Size = RelaSize;
+    Rela->Link = 4;
+    Rela->Info = 1;
+    Rela->Alignment = 8;
+    Rela->EntrySize = sizeof(elf64_rela);
+
+    elf64_section_header *SymbolTable = Sections + 4;
+    SymbolTable->Type = ELFSection_SymbolTable;
+    SymbolTable->Offset = SymbolTableOffset;
+    SymbolTable->Size = SymbolTableSize;
+    SymbolTable->Link = 5;
+    SymbolTable->Info = ELF_LOCAL_SYMBOL_COUNT;
+    SymbolTable->Alignment = 8;
+    SymbolTable->EntrySize = sizeof(elf64_symbol);
+
+    elf64_section_header *StringTableSection = Sections + 5;
+    StringTableSection->Type = ELFSection_StringTable;
+    StringTableSection->Offset = StringTableOffset;
+    StringTableSection->Size = StringTableSize;
+    StringTableSection->Alignment = 1;
+
+    elf64_section_header *SectionNameSection = Sections + 6;
+    SectionNameSection->Type = ELFSection_StringTable;
+    SectionNameSection->Offset = SectionNameTableOffset;
+    SectionNameSection->Size = SectionNameTableSize;
+    SectionNameSection->Alignment = 1;
+
+    elf64_section_header *Stack = Sections + 7;
+    Stack->Type = ELFSection_ProgramBits;
+    Stack->Offset = SectionHeaderOffset;
+    Stack->Alignment = 1;
+
+    //
+    // NOTE(alex): Write it
+    //
+
+    FILE *Out = fopen(FileName, "wb");
+    if(Out)
+    {
+        Result = (fwrite(Image, ImageSize, 1, Out) == 1);
+        fclose(Out);
+    }
+
+    EndTemporaryMemory(ImageMemory);
+
+    return Result;
+}
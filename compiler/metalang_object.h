@@ -0,0 +1,79 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+enum object_section
+{
+    Section_Undefined,
+    Section_Text,
+    Section_ReadOnly,
+};
+
+enum object_relocation_type
+{
+    // NOTE(alex): 32-bit PC-relative to the symbol (rip-relative addressing)
+    Relocation_PC32,
+
+    // NOTE(alex): 32-bit PC-relative call target, may go through the PLT
+    Relocation_PLT32,
+};
+
+struct object_symbol
+{
+    string Name;
+    u32 Section;
+    u32 Offset;
+    u32 Size;
+};
+
+struct object_relocation
+{
+    u32 Offset; // NOTE(alex): Into .text
+    u32 Type;
+
+    // NOTE(alex): Relocations against .rodata go through the section itself,
+    // in which case Symbol is ignored and Addend carries the offset.
+    u32 Section;
+    u32 Symbol;
+    s32 Addend;
+};
+
+struct object_buffer
+{
+    umm Size;
+    umm Capacity;
+    u8 *Data;
+};
+
+struct object_builder
+{
+    memory_arena Arena;
+
+    object_buffer Text;
+    object_buffer ReadOnly;
+
+    u32 SymbolCount;
+    u32 SymbolCapacity;
+    object_symbol *Symbols;
+
+    u32 RelocationCount;
+    u32 RelocationCapacity;
+    object_relocation *Relocations;
+};
+
+internal object_builder *BeginObject(void);
+internal void EndObject(object_builder *Object);
+internal u8 *ReserveText(object_builder *Object, umm Size);
+internal u32 AddReadOnlyString(object_builder *Object, char *Z);
+internal u32 GetOrAddSymbol(object_builder *Object, string Name);
+internal void DefineSymbol(object_builder *Object, u32 SymbolIndex, u32 Section, u32 Offset, u32 Size);
+internal void AddRelocation(object_builder *Object, u32 Offset, object_relocation_type Type, u32 Section, u32 Symbol, s32 Addend);
+internal b32 WriteELFObject(object_builder *Object, char *FileName);
@@ -10,6 +10,9 @@
 
    ======================================================================== */
 
+// NOTE(alex): Printing every node operation is only any good for tiny
+// programs. -trace-nodes writes them down compactly enough for real ones,
+// and can replay them too (see metalang_nodetrace.h).
 #if 1
 
 #define DEBUG_RECORD_ALLOCATION(Node)
@@ -48,29 +51,29 @@ internal void DebugTokens(tokenizer *Tokenizer)
     }
 }
 
-internal void DebugType(data_type Type)
+internal void DebugType(stream *Out, data_type Type)
 {
-    printf("%.*s", ExpandString(GetDataTypeName(Type)));
+    Outf(Out, "%.*s", ExpandString(GetDataTypeName(Type)));
 
     if(IsConstantInteger(Type))
     {
-        printf("(%d)", Type.Value);
+        Outf(Out, "(%d)", Type.Value);
     }
 }
 
-internal void DebugNode(node *Node)
+internal void DebugNode(stream *Out, node *Node)
 {
     if(IsValid(Node->DebugLabel))
     {
-        printf("%.*s", ExpandString(Node->DebugLabel));
+        Outf(Out, "%.*s", ExpandString(Node->DebugLabel));
     }
     else
     {
-        printf("%.*s(", ExpandString(GetNodeTypeName(Node->Type)));
+        Outf(Out, "%.*s(", ExpandString(GetNodeTypeName(Node->Type)));
 
         if(IsConstant(Node) && IsConstantInteger(Node->DataType))
         {
-            printf("%d", Node->DataType.Value);
+            Outf(Out, "%d", Node->DataType.Value);
         }
         else
         {
@@ -83,9 +86,9 @@ internal void DebugNode(node *Node)
                 {
                     if(!First)
                     {
-                        printf(", ");
+                        Outf(Out, ", ");
                     }
-                    DebugNode(Operand);
+                    DebugNode(Out, Operand);
                     First = false;
                 }
             }
@@ -94,13 +97,13 @@ internal void DebugNode(node *Node)
             {
                 if(!First)
                 {
-                    printf(", ");
+                    Outf(Out, ", ");
                 }
-                printf("%u", Node->Index);
+                Outf(Out, "%u", Node->Index);
             }
         }
 
-        printf(")");
+        Outf(Out, ")");
     }
 }
 
@@ -256,21 +259,28 @@ inline variable_binding *GetVariableInScope(parser *Parser, variable_scope Scope
     return Result;
 }
 
-internal void DebugVariable(variable_binding *Variable)
+internal void DebugVariable(stream *Out, variable_binding *Variable)
 {
-    printf("%.*s = ", ExpandString(Variable->Name));
-    DebugNode(Variable->Value);
-    printf("\n");
+    Outf(Out, "%.*s = ", ExpandString(Variable->Name));
+    DebugNode(Out, Variable->Value);
+    Outf(Out, "\n");
 }
 
 internal void DebugScope(parser *Parser, variable_scope Scope)
 {
-    for(variable_iterator Iter = IterateVariablesIn(Parser, Scope);
-        IsValid(Iter);
-        Iter = Next(Iter))
+    // NOTE(alex): DebugNode prints the graph as a tree, which gets
+    // exponentially large, so it isn't even walked unless it's going somewhere.
+    if(IsOpen(Parser->Out, StreamLevel_Scopes))
     {
-        variable_binding *Variable = Iter.At;
-        DebugVariable(Variable);
+        for(variable_iterator Iter = IterateVariablesIn(Parser, Scope);
+            IsValid(Iter);
+            Iter = Next(Iter))
+        {
+            variable_binding *Variable = Iter.At;
+            DebugVariable(Parser->Out, Variable);
+        }
+
+        Outf(Parser->Out, "--- End scope ---\n");
     }
 }
 
@@ -293,6 +303,8 @@ internal variable_binding *GetVariableToMerge(variable_iterator Iter, variable_b
 
 internal node *GetOrCreateNodeInternal(parser *Parser, node_type Type, u32 OperandCount, node **Operands)
 {
+    node_trace *Trace = BeginNodeTrace(Parser);
+
     if(!Parser->FirstFreeNode)
     {
         Parser->FirstFreeNode = PushStruct(&Parser->Arena, node, NoClear());
@@ -323,6 +335,12 @@ internal node *GetOrCreateNodeInternal(parser *Parser, node_type Type, u32 Opera
 
     DEBUG_RECORD_ALLOCATION(Result);
 
+    if(Trace)
+    {
+        TraceNodeCreated(Trace, Result);
+    }
+    EndNodeTrace(Parser);
+
     return Result;
 }
 
@@ -374,10 +392,46 @@ internal node *GetOrCreatePhi(parser *Parser, node *Region, node *True, node *Fa
     return Result;
 }
 
+inline b32 HashKeysAreEqual(node *Constant, data_type DataType)
+{
+    b32 Result = TypesAreEqual(Constant->DataType, DataType);
+    return Result;
+}
+
+/* NOTE(alex): A routine that says 0 a thousand times only gets one 0, and
+   so does every fold that comes out as 0. That keeps the graph small, and
+   it means two uses of the same value are the same node, so a peephole
+   that compares operands sees that they're equal.
+
+   The table's reference is never given back while the routine is parsed,
+   so a constant never goes away while the table still knows it, even when
+   nothing else uses it anymore.
+
+   The trace gets a create for every constant the parser asks for, new or
+   not. One it already had may have been made inside a peephole, which
+   isn't traced, so the replay wouldn't know it by its ID otherwise. The
+   replay asks the table too, and gets the same node back.
+*/
 internal node *GetOrCreateConstant(parser *Parser, data_type DataType)
 {
-    node *Result = GetOrCreateNode(Parser, Node_Constant);
-    Result->DataType = DataType;
+    node_trace *Trace = BeginNodeTrace(Parser);
+
+    u32 HashValue = DataTypeHashOf(DataType);
+    node *Result = GetHashValue(&Parser->Constants, HashValue, DataType);
+    if(!Result)
+    {
+        Result = GetOrCreateNode(Parser, Node_Constant);
+        Result->DataType = DataType;
+
+        AddHashValue(&Parser->Constants, HashValue, Result);
+        AddReference(Parser, Result);
+    }
+
+    if(Trace)
+    {
+        TraceNodeCreated(Trace, Result);
+    }
+    EndNodeTrace(Parser);
 
     return Result;
 }
@@ -393,7 +447,15 @@ internal void AddReference(parser *Parser, node *Node)
 {
     DEBUG_RECORD_REFERENCE(Node);
 
+    node_trace *Trace = BeginNodeTrace(Parser);
+    if(Trace)
+    {
+        TraceNodeEvent(Trace, NodeTrace_AddReference, Node->ID);
+    }
+
     ++Node->RefCount;
+
+    EndNodeTrace(Parser);
 }
 
 internal void FreeNode(parser *Parser, node *Node)
@@ -403,6 +465,7 @@ internal void FreeNode(parser *Parser, node *Node)
     Assert(Node->RefCount == 0);
     Node->NextFree = Parser->FirstFreeNode;
     Parser->FirstFreeNode = Node;
+    ++Parser->FreedNodeCount;
 }
 
 internal void RemoveChildReferences(parser *Parser, node *Parent)
@@ -421,6 +484,12 @@ internal void RemoveReference(parser *Parser, node *Node)
 {
     DEBUG_RECORD_UNREFERENCE(Node);
 
+    node_trace *Trace = BeginNodeTrace(Parser);
+    if(Trace)
+    {
+        TraceNodeEvent(Trace, NodeTrace_RemoveReference, Node->ID);
+    }
+
     Assert(Node->RefCount > 0);
     --Node->RefCount;
 
@@ -429,6 +498,8 @@ internal void RemoveReference(parser *Parser, node *Node)
         RemoveChildReferences(Parser, Node);
         FreeNode(Parser, Node);
     }
+
+    EndNodeTrace(Parser);
 }
 
 internal type_id TypeIDFromToken(token Token)
@@ -469,16 +540,14 @@ internal b32 SkipBalancedBlock(tokenizer *Tokenizer, token_type OpenType, token_
     return Result;
 }
 
-internal parser *ParseTopLevelRoutines(tokenizer Tokenizer_)
+// NOTE(alex): Sets up the nodes every routine shares, and returns the node
+// for the routine's argument.
+internal node *BeginGraph(parser *Parser)
 {
-    tokenizer *Tokenizer = &Tokenizer_;
-
-    parser *Parser = BootstrapPushStruct(parser, Arena, DefaultBootstrapParams(), NoClear());
-    routine_definition *Sentinel = &Parser->RoutineSentinel;
-    Sentinel->Prev = Sentinel->Next = Sentinel;
-
     Parser->FirstFreeNode = 0;
     Parser->NextNodeID = 0;
+    Parser->FreedNodeCount = 0;
+    InitHashTable(&Parser->Constants, &Parser->Arena);
 
     Parser->MostRecentVariable = 0;
     Parser->FirstFreeVariable = 0;
@@ -488,13 +557,82 @@ internal parser *ParseTopLevelRoutines(tokenizer Tokenizer_)
 
     string ARG0 = ConstZ("arg");
     node *Value = GetOrCreateProj(Parser, Parser->StartNode, 1, ARG0);
-#if 1
     Value->DataType = GetIntegerBottomType();
-#else
-    Value->DataType = GetIntegerType(2);
-#endif
     AddVariable(Parser, ARG0, Value);
 
+    return Value;
+}
+
+// NOTE(alex): How many routine parsers a file parser holds on to. Past that
+// they're freed, so one huge file doesn't keep its memory forever.
+#define MAX_POOLED_PARSERS 64
+
+internal parser *BootstrapParser(void)
+{
+    parser *Parser = BootstrapPushStruct(parser, Arena, DefaultBootstrapParams(), NoClear());
+    Parser->Scope = BeginTemporaryMemory(&Parser->Arena);
+
+    ZeroStruct(Parser->PoolMutex);
+    Parser->PooledCount = 0;
+    Parser->FirstPooled = 0;
+    Parser->NextPooled = 0;
+    Parser->PeepholeStats = 0;
+
+    return Parser;
+}
+
+inline void ResetParser(parser *Parser)
+{
+    EndTemporaryMemory(Parser->Scope);
+    Parser->Scope = BeginTemporaryMemory(&Parser->Arena);
+}
+
+internal void FreeParser(parser *Parser)
+{
+    while(Parser->FirstPooled)
+    {
+        parser *Pooled = Parser->FirstPooled;
+        Parser->FirstPooled = Pooled->NextPooled;
+        Clear(&Pooled->Arena);
+    }
+
+    Clear(&Parser->Arena);
+}
+
+// NOTE(alex): The parser may have been used for another file before, so
+// everything that isn't part of its scope gets set up again here.
+internal void ParseTopLevelRoutines(parser *Parser, tokenizer Tokenizer_)
+{
+    TIMED_FUNCTION();
+
+    tokenizer *Tokenizer = &Tokenizer_;
+
+    // NOTE(alex): The routines go on the same arena while it's in use, so it
+    // stays around until the parser's scope goes.
+    structural_index Structure;
+    BuildStructuralIndex(&Parser->Arena, Tokenizer->Input, &Structure);
+
+    routine_definition *Sentinel = &Parser->RoutineSentinel;
+    Sentinel->Prev = Sentinel->Next = Sentinel;
+
+    // NOTE(alex): On the arena, so they go away with the parser's scope
+    InitHashTable(&Parser->Routines, &Parser->Arena);
+    InitHashTable(&Parser->Types, &Parser->Arena);
+
+    Parser->Object = 0;
+    Parser->NodeStats = 0;
+    Parser->NodeTraceOut = 0;
+    Parser->NodeTrace = 0;
+    Parser->PeepholeStats = 0;
+    Parser->Queue = 0;
+    Parser->Parent = 0;
+    Parser->MetaDepth = 0;
+    Parser->RunCount = 0;
+    Parser->CacheDirectory = 0;
+    Parser->CacheHitCount = 0;
+    Parser->CacheMissCount = 0;
+    Parser->CacheWriteFailCount = 0;
+
     while(Parsing(Tokenizer))
     {
         token Token = GetToken(Tokenizer);
@@ -518,228 +656,247 @@ internal parser *ParseTopLevelRoutines(tokenizer Tokenizer_)
             b32 GotParameterList = false;
             if(OptionalToken(Tokenizer, Token_OpenParen))
             {
-                GotParameterList = SkipBalancedBlock(Tokenizer, Token_OpenParen, Token_CloseParen);
-            }
-
-            if(GotParameterList && OptionalToken(Tokenizer, Token_OpenBrace))
-            {
-                SkipBalancedBlock(Tokenizer, Token_OpenBrace, Token_CloseBrace);
+                GotParameterList = SkipBalancedBlock(Tokenizer, &Structure);
             }
 
             routine_definition Routine = {};
             Routine.TypeToken = TypeToken;
             Routine.NameToken = NameToken;
 
-            routine_definition *Result = 0;
-
-            u32 HashValue = StringHashOf(Routine.NameToken.Text);
-            u32 HashIndex = HashValue & (ArrayCount(Parser->RoutineHash) - 1);
-
-            routine_definition **HashSlot = Parser->RoutineHash + HashIndex;
-            for(routine_definition *Search = *HashSlot; Search; Search = Search->NextInHash)
+            if(GotParameterList && OptionalToken(Tokenizer, Token_OpenBrace))
             {
-                if(StringsAreEqual(Search->NameToken.Text, Routine.NameToken.Text))
-                {
-                    Result = Search;
-                    break;
-                }
+                Routine.Body = *Tokenizer;
+                Routine.HasBody = SkipBalancedBlock(Tokenizer, &Structure);
+                Routine.Body.Input.Count = Tokenizer->Input.Data - Routine.Body.Input.Data;
+                Routine.BodyHash = StringHashOf(Routine.Body.Input);
             }
 
-            if(!Result)
+            // NOTE(alex): When a name comes up twice, the first one wins
+            u32 HashValue = StringHashOf(Routine.NameToken.Text);
+            if(!GetHashValue(&Parser->Routines, HashValue, Routine.NameToken.Text))
             {
-                Result = PushStruct(&Parser->Arena, routine_definition, NoClear());
+                routine_definition *Result = PushStruct(&Parser->Arena, routine_definition, NoClear());
                 *Result = Routine;
                 Result->NameHash = HashValue;
                 Result->Next = Sentinel;
                 Result->Prev = Sentinel->Prev;
                 Result->Prev->Next = Result;
                 Result->Next->Prev = Result;
-                Result->NextInHash = *HashSlot;
-                *HashSlot = Result;
+                AddHashValue(&Parser->Routines, HashValue, Result);
             }
         }
     }
-
-    return Parser;
 }
 
-internal node *DeadCodeEliminate(parser *Parser, node *Old, node *New)
+inline parser *GetRootParser(parser *Parser)
 {
-    if((Old != New) &&
-       (Old->RefCount == 0))
+    parser *Result = Parser;
+    while(Result->Parent)
     {
-        RemoveChildReferences(Parser, Old);
-        FreeNode(Parser, Old);
+        Result = Result->Parent;
     }
 
-    return New;
+    return Result;
 }
 
-internal node *Idealize(parser *Parser, node *Node)
+// NOTE(alex): A parser for part of a file, which looks routines up in the
+// parser it came from, and inherits its settings.
+internal parser *BeginChildParser(parser *Parent)
 {
-    node *Result = 0;
-
-    node *LHS = Node->Operands[0];
-    node *RHS = Node->Operands[1];
+    parser *Root = GetRootParser(Parent);
 
-    switch(Node->Type)
+    BeginTicketMutex(&Root->PoolMutex);
+    parser *Parser = Root->FirstPooled;
+    if(Parser)
     {
-        case Node_Add:
-        {
-            Assert(!(IsConstantType(LHS->DataType) && IsConstantType(RHS->DataType)));
+        Root->FirstPooled = Parser->NextPooled;
+        --Root->PooledCount;
+    }
+    EndTicketMutex(&Root->PoolMutex);
 
-            if(IsConstantInteger(RHS->DataType) && (RHS->DataType.Value == 0))
-            {
-                Result = LHS;
-            }
-            else if(LHS == RHS)
-            {
-                node *Two = GetOrCreateInteger(Parser, 2);
-                Result = GetOrCreateNode(Parser, Node_Mul, LHS, Two);
-            }
-            else if((LHS->Type != Node_Add) &&
-                    (RHS->Type == Node_Add))
-            {
-                Result = SwapOperands(Node);
-            }
-            else if(RHS->Type == Node_Add)
-            {
-                node *X = LHS;
-                node *Y = RHS->Operands[0];
-                node *Z = RHS->Operands[1];
+    if(!Parser)
+    {
+        Parser = BootstrapParser();
+    }
 
-                node *XY = Peephole(Parser, GetOrCreateNode(Parser, Node_Add, X, Y));
-                Result = GetOrCreateNode(Parser, Node_Add, XY, Z);
-            }
-            else if(LHS->Type != Node_Add)
-            {
-                if(SplineCompare(LHS, RHS))
-                {
-                    Result = SwapOperands(Node);
-                }
-            }
-            else if(IsConstantType(LHS->Operands[1]->DataType) &&
-                    IsConstantType(RHS->DataType))
-            {
-                node *X = LHS->Operands[0];
-                node *Y = LHS->Operands[1];
-                node *Z = RHS;
+    Parser->Stream = Parent->Stream;
+    Parser->Out = Parent->Out;
+    Parser->Errors = Parent->Errors;
+    Parser->Queue = 0;
+    Parser->Parent = Parent;
+    Parser->MetaDepth = Parent->MetaDepth;
+    Parser->RunCount = 0;
+    Parser->CacheDirectory = 0;
+    Parser->CacheHitCount = 0;
+    Parser->CacheMissCount = 0;
+    Parser->CacheWriteFailCount = 0;
+    Parser->Object = 0;
+    Parser->NodeStats = 0;
+    Parser->NodeTraceOut = 0;
+    Parser->NodeTrace = 0;
+    Parser->PeepholeStats = Parent->PeepholeStats;
+    Parser->Lazy = false;
+    Parser->DisablePeephole = Parent->DisablePeephole;
+    Parser->ExecuteMode = Parent->ExecuteMode;
+    Parser->ExecuteArgument = Parent->ExecuteArgument;
+    Parser->BenchmarkCount = Parent->BenchmarkCount;
 
-                node *YZ = Peephole(Parser, GetOrCreateNode(Parser, Node_Add, Y, Z));
-                Result = GetOrCreateNode(Parser, Node_Add, X, YZ);
-            }
-            else
-            {
-                if(SplineCompare(LHS->Operands[1], RHS))
-                {
-                    node *X = LHS->Operands[0];
-                    node *Y = RHS;
-                    node *Z = LHS->Operands[1];
+    return Parser;
+}
 
-                    node *XY = Peephole(Parser, GetOrCreateNode(Parser, Node_Add, X, Y));
-                    Result = GetOrCreateNode(Parser, Node_Add, XY, Z);
-                }
-            }
-        } break;
+internal void EndChildParser(parser *Parser)
+{
+    parser *Root = GetRootParser(Parser);
+    ResetParser(Parser);
 
-        case Node_Mul:
-        {
-            Assert(!(IsConstantType(LHS->DataType) && IsConstantType(RHS->DataType)));
+    b32 Pooled = false;
+    BeginTicketMutex(&Root->PoolMutex);
+    if(Root->PooledCount < MAX_POOLED_PARSERS)
+    {
+        Parser->NextPooled = Root->FirstPooled;
+        Root->FirstPooled = Parser;
+        ++Root->PooledCount;
+        Pooled = true;
+    }
+    EndTicketMutex(&Root->PoolMutex);
 
-            if(IsConstantInteger(RHS->DataType) && (RHS->DataType.Value == 1))
-            {
-                Result = LHS;
-            }
-            else if(IsConstantType(LHS->DataType) &&
-                    !IsConstantType(RHS->DataType))
-            {
-                Result = SwapOperands(Node);
-            }
-        } break;
+    if(!Pooled)
+    {
+        Clear(&Parser->Arena);
+    }
+}
 
-        case Node_Div:
-        {
-            Assert(!(IsConstantType(LHS->DataType) && IsConstantType(RHS->DataType)));
+internal routine_definition *GetRoutine(parser *Parser, string Name)
+{
+    // NOTE(alex): Only the top level parser knows about routines
+    Parser = GetRootParser(Parser);
 
-            if(IsConstantInteger(RHS->DataType) && (RHS->DataType.Value == 1))
-            {
-                Result = LHS;
-            }
-        } break;
+    routine_definition *Result = GetHashValue(&Parser->Routines, StringHashOf(Name), Name);
 
-        case Node_Neg: {} break;
+    return Result;
+}
 
-        case Node_Not:
-        {
-            Assert(!IsConstantType(LHS->DataType));
+inline b32 HashKeysAreEqual(string *Name, string Key)
+{
+    b32 Result = StringsAreEqual(*Name, Key);
+    return Result;
+}
 
-            switch(LHS->Type)
-            {
-                case Node_EQ:
-                {
-                    Result = GetOrCreateNode(Parser, Node_NE, LHS->Operands[0], LHS->Operands[1]);
-                } break;
+// NOTE(alex): For -hashstats: the routine table as it is, and every distinct
+// identifier in the file put through a table of its own, since those are
+// the names the variables and types get hashed by.
+internal void OutputSymbolHashStats(parser *Parser, tokenizer Tokenizer, stream *Out)
+{
+    temporary_memory TempMem = BeginTemporaryMemory(&Parser->Arena);
 
-                case Node_LT:
-                {
-                    Result = GetOrCreateNode(Parser, Node_LE, LHS->Operands[1], LHS->Operands[0]);
-                } break;
+    hash_table_stats Stats;
+    GetHashTableStats(&Parser->Routines, &Parser->Arena, &Stats);
+    OutputHashTableStats(Out, "Routines", &Stats);
 
-                case Node_LE:
-                {
-                    Result = GetOrCreateNode(Parser, Node_LT, LHS->Operands[1], LHS->Operands[0]);
-                } break;
-            }
-        } break;
+    hash_table<string> Identifiers;
+    InitHashTable(&Identifiers, &Parser->Arena);
 
-        case Node_Phi:
+    for(token Token = GetToken(&Tokenizer);
+        Parsing(&Tokenizer) && (Token.Type != Token_EndOfStream);
+        Token = GetToken(&Tokenizer))
+    {
+        if(Token.Type == Token_Identifier)
         {
-            if(LHS == RHS)
-            {
-                Result = LHS;
-            }
-            else if(IsOperator(LHS) &&
-                    (LHS->Type == RHS->Type))
+            u32 HashValue = StringHashOf(Token.Text);
+            if(!GetHashValue(&Identifiers, HashValue, Token.Text))
             {
-                node *PhiLHS = Peephole(Parser, GetOrCreateNode(Parser, Node_Phi, LHS->Operands[0], RHS->Operands[0]));
-                node *PhiRHS = Peephole(Parser, GetOrCreateNode(Parser, Node_Phi, LHS->Operands[1], RHS->Operands[1]));
-                Result = GetOrCreateNode(Parser, LHS->Type, PhiLHS, PhiRHS);
+                string *Name = PushStruct(&Parser->Arena, string, NoClear());
+                *Name = Token.Text;
+                AddHashValue(&Identifiers, HashValue, Name);
             }
-        } break;
+        }
     }
 
-    return Result;
+    GetHashTableStats(&Identifiers, &Parser->Arena, &Stats);
+    OutputHashTableStats(Out, "Identifiers", &Stats);
+
+    EndTemporaryMemory(TempMem);
+}
+
+internal node *DeadCodeEliminate(parser *Parser, node *Old, node *New)
+{
+    if((Old != New) &&
+       (Old->RefCount == 0))
+    {
+        // NOTE(alex): New is often one of Old's operands (x*1 becomes x), and
+        // then Old may have been the only thing keeping it alive. So it's
+        // held on to while Old goes away, or it would go away with it.
+        AddReference(Parser, New);
+        RemoveChildReferences(Parser, Old);
+        FreeNode(Parser, Old);
+
+        DEBUG_RECORD_UNREFERENCE(New);
+        --New->RefCount;
+    }
+
+    return New;
 }
 
 internal node *Peephole(parser *Parser, node *Node)
 {
+    TIMED_FUNCTION();
+
+    // NOTE(alex): Node may well be gone by the time we're done
+    node_trace *Trace = BeginNodeTrace(Parser);
+    u32 NodeID = Node->ID;
+
     node *Result = Node;
 
+    peephole_counter Counter = BeginPeepholeCounter(Parser);
+
     data_type Type = Node->DataType = ComputeType(Node);
 
-    if(!IsConstant(Node) && IsConstantType(Type))
+    if(Parser->DisablePeephole)
+    {
+        // NOTE(alex): Types are still needed by the backend, but the graph
+        // is left exactly as it was parsed.
+    }
+    else if(!IsConstant(Node) && IsConstantType(Type))
     {
+        node_type FoldedType = Node->Type;
         node *Constant = GetOrCreateConstant(Parser, Type);
         Result = DeadCodeEliminate(Parser, Node, Constant);
+        CountPeepholeFold(Parser, &Counter, FoldedType);
     }
     else
     {
-        node *TestNode = Idealize(Parser, Node);
+        peephole_rule *Rule = 0;
+        node *TestNode = Idealize(Parser, Node, &Rule);
         if(TestNode)
         {
             node *Replacement = DeadCodeEliminate(Parser, Node, TestNode);
+            CountPeepholeRule(Parser, &Counter, Rule);
             Result = Peephole(Parser, Replacement);
             // Result = DeadCodeEliminate(Parser, Node, Peephole(Parser, TestNode));
         }
+        else
+        {
+            CountPeepholeMiss(Parser, &Counter);
+        }
     }
 
+    EndPeepholeCounter(Parser, &Counter);
+
+    if(Trace)
+    {
+        TracePeephole(Trace, NodeID, Result->ID);
+    }
+    EndNodeTrace(Parser);
+
     return Result;
 }
 
-internal void MergeScopes(parser *Parser, node *Region,
+internal void MergeScopes(parser *Parser, node *Region, variable_scope Scope,
                           variable_iterator TrueScope,
                           variable_iterator FalseScope)
 {
+    TIMED_FUNCTION();
+
     // TODO(alex): This code is kinda turtles! Possible low-hanging fruit to gain some speed:
     // - Stop iterating the entire variable tree. There probably aren't that many variables,
     //   so this may end up just not mattering. But if we see this function start to show up
@@ -750,11 +907,16 @@ internal void MergeScopes(parser *Parser, node *Region,
     //   a particular scope, it might be pretty easy to just throw a hash table in there and
     //   then all of our lookups become basically free.
 
+    b32 InScope = true;
     for(variable_iterator Iter = IterateVariables(Parser);
         IsValid(Iter);
         Iter = Next(Iter))
     {
         variable_binding *Variable = Iter.At;
+        if(Variable == Scope.End)
+        {
+            InScope = false;
+        }
 
         variable_binding *TrueVar = GetVariableToMerge(TrueScope, Variable);
         variable_binding *FalseVar = GetVariableToMerge(FalseScope, Variable);
@@ -767,13 +929,26 @@ internal void MergeScopes(parser *Parser, node *Region,
             // TODO(alex): There are a few places where we overwrite a variable's value,
             // and it gets kind of tricky to keep the reference counting straight, so
             // we should make a utility for this.
-            if(TrueVar && FalseVar)
+            node *Phi = Peephole(Parser, GetOrCreatePhi(Parser, Region, LHS, RHS));
+            if(InScope)
             {
-                RemoveReference(Parser, Variable->Value);
-            }
+                if(TrueVar && FalseVar)
+                {
+                    RemoveReference(Parser, Variable->Value);
+                }
 
-            Variable->Value = Peephole(Parser, GetOrCreatePhi(Parser, Region, LHS, RHS));
-            AddReference(Parser, Variable->Value);
+                Variable->Value = Phi;
+                AddReference(Parser, Variable->Value);
+            }
+            else
+            {
+                // NOTE(alex): The variable lives outside the block this if is in,
+                // so the merge is an assignment like any other, and gets a binding
+                // in this block. Writing it directly would hide it from the merge
+                // of an enclosing if, which then never makes a phi for it.
+                variable_binding *NewVariable = AddVariable(Parser, Variable->Name, Phi);
+                NewVariable->Original = Variable;
+            }
         }
     }
 
@@ -781,6 +956,71 @@ internal void MergeScopes(parser *Parser, node *Region,
     FreeVariables(Parser, FalseScope);
 }
 
+internal node *ParseDirective(parser *Parser, tokenizer *Tokenizer, token PoundToken)
+{
+    node *Result = 0;
+
+    token Directive = RequireToken(Tokenizer, Token_Identifier);
+    if(TokenEquals(Directive, "run"))
+    {
+        token NameToken = RequireToken(Tokenizer, Token_Identifier);
+        RequireToken(Tokenizer, Token_OpenParen);
+
+        node *Argument = 0;
+        if(PeekToken(Tokenizer).Type != Token_CloseParen)
+        {
+            Argument = ParseExpression(Parser, Tokenizer);
+        }
+
+        RequireToken(Tokenizer, Token_CloseParen);
+
+        if(Parsing(Tokenizer))
+        {
+            routine_definition *Routine = GetRoutine(Parser, NameToken.Text);
+            if(Routine && (Parser->MetaDepth == 0))
+            {
+                // NOTE(alex): References made while evaluating a #run don't
+                // count, since those only get parsed on a cache miss.
+                AtomicAddU32(&Routine->ReferenceCount, 1);
+            }
+
+            if(!Routine || !Routine->HasBody)
+            {
+                Error(Tokenizer, NameToken, "Undeclared routine");
+            }
+            // NOTE(alex): The type is computed even when peepholes are off,
+            // so this doesn't depend on the argument having been folded.
+            else if(Argument && !IsConstantInteger(Argument->DataType))
+            {
+                Error(Tokenizer, NameToken, "#run arguments must be known at compile time");
+            }
+            else
+            {
+                s32 ArgumentValue = Argument ? Argument->DataType.Value : 0;
+
+                s32 Value = 0;
+                if(RunAtCompileTime(Parser, Tokenizer, NameToken, Routine, ArgumentValue, &Value))
+                {
+                    Result = GetOrCreateInteger(Parser, Value);
+                }
+            }
+        }
+    }
+    else
+    {
+        Error(Tokenizer, Directive, "Unknown directive");
+    }
+
+    if(!Result)
+    {
+        // NOTE(alex): The error already stopped parsing, this just keeps the
+        // expression we're in the middle of from having a null operand.
+        Result = GetOrCreateInteger(Parser, 0);
+    }
+
+    return Result;
+}
+
 internal node *ParsePrimaryExpression(parser *Parser, tokenizer *Tokenizer)
 {
     node *Result = 0;
@@ -809,12 +1049,26 @@ internal node *ParsePrimaryExpression(parser *Parser, tokenizer *Tokenizer)
 
         case Token_Number:
         {
-            Result = GetOrCreateInteger(Parser, Token.S32);
+            // NOTE(alex): Anything that fits in 32 bits is fine, so
+            // 0xFFFFFFFF is -1, the same as it would be in C.
+            if(Token.Overflowed || (Token.U64 > U32Max))
+            {
+                Error(Tokenizer, Token, "Number doesn't fit in 32 bits");
+            }
+            else
+            {
+                Result = GetOrCreateInteger(Parser, Token.S32);
+            }
         } break;
 
         case Token_String:
         {
-            Assert(!"Strings are not implement yet");
+            Error(Tokenizer, Token, "Strings are not implemented yet");
+        } break;
+
+        case Token_Pound:
+        {
+            Result = ParseDirective(Parser, Tokenizer, Token);
         } break;
 
         default:
@@ -847,8 +1101,11 @@ internal node *ParseUnaryOp(parser *Parser, tokenizer *Tokenizer)
     if(OpType)
     {
         node *RHS = ParseUnaryOp(Parser, Tokenizer);
-        node *UnaryOp = GetOrCreateNode(Parser, OpType, RHS);
-        Result = Peephole(Parser, UnaryOp);
+        if(RHS)
+        {
+            node *UnaryOp = GetOrCreateNode(Parser, OpType, RHS);
+            Result = Peephole(Parser, UnaryOp);
+        }
     }
 
     return Result;
@@ -859,9 +1116,9 @@ internal node *ParseMultiplication(parser *Parser, tokenizer *Tokenizer)
     node *LHS = ParseUnaryOp(Parser, Tokenizer);
     if(LHS && OptionalToken(Tokenizer, Token_Asterisk))
     {
+        // NOTE(alex): If the right side failed, so did the whole thing
         node *RHS = ParseMultiplication(Parser, Tokenizer);
-        node *BinaryOp = GetOrCreateNode(Parser, Node_Mul, LHS, RHS);
-        LHS = Peephole(Parser, BinaryOp);
+        LHS = RHS ? Peephole(Parser, GetOrCreateNode(Parser, Node_Mul, LHS, RHS)) : 0;
     }
 
     return LHS;
@@ -885,8 +1142,7 @@ internal node *ParseAddition(parser *Parser, tokenizer *Tokenizer)
     if(LHS && OpType)
     {
         node *RHS = ParseAddition(Parser, Tokenizer);
-        node *BinaryOp = GetOrCreateNode(Parser, OpType, LHS, RHS);
-        LHS = Peephole(Parser, BinaryOp);
+        LHS = RHS ? Peephole(Parser, GetOrCreateNode(Parser, OpType, LHS, RHS)) : 0;
     }
 
     return LHS;
@@ -951,8 +1207,7 @@ internal node *ParseComparison(parser *Parser, tokenizer *Tokenizer)
             RHS = Result;
         }
 
-        node *BinaryOp = GetOrCreateNode(Parser, OpType, LHS, RHS);
-        Result = Peephole(Parser, BinaryOp);
+        Result = (LHS && RHS) ? Peephole(Parser, GetOrCreateNode(Parser, OpType, LHS, RHS)) : 0;
     }
 
     return Result;
@@ -1034,7 +1289,6 @@ internal variable_iterator ParseBlock(parser *Parser, tokenizer *Tokenizer)
     variable_iterator Result = IterateVariablesIn(Parser, Scope);
 
     DebugScope(Parser, Scope);
-    printf("--- End scope ---\n");
 
     EndScope(Parser, Scope);
 
@@ -1060,11 +1314,17 @@ internal node *ParseExpressionStatement(parser *Parser, tokenizer *Tokenizer, va
         node *RHS = ParseExpression(Parser, Tokenizer);
 
         variable_binding *Variable = GetVariableInScope(Parser, Scope, NameToken.Text);
-        if(Variable)
+        if(!RHS)
+        {
+            // NOTE(alex): The expression already reported why it has no value
+        }
+        else if(Variable)
         {
+            // NOTE(alex): The new value can be the old one (x = x + 0), so it
+            // gets its reference before the old one loses its own.
+            AddReference(Parser, RHS);
             RemoveReference(Parser, Variable->Value);
             Variable->Value = RHS;
-            AddReference(Parser, Variable->Value);
         }
         // TODO(alex): This is a little bit wasteful, as we first iterate the current scope
         // and then iterate the entire stack again. We could just start at the end of the
@@ -1133,21 +1393,25 @@ internal void ParseStatement(parser *Parser, tokenizer *Tokenizer, variable_scop
             Parser->ControlNode = TrueBranch;
             RequireToken(Tokenizer, Token_OpenBrace);
             variable_iterator TrueScope = ParseBlock(Parser, Tokenizer);
+            node *TrueEnd = Parser->ControlNode;
 
             Parser->ControlNode = FalseBranch;
-            variable_iterator FalseScope = IterateVariables(Parser);
+            // NOTE(alex): Without an else, the false side didn't assign anything
+            variable_iterator FalseScope = IterateVariablesIn(Parser, BeginScope(Parser));
             if(OptionalToken(Tokenizer, "else"))
             {
                 RequireToken(Tokenizer, Token_OpenBrace);
                 FalseScope = ParseBlock(Parser, Tokenizer);
             }
+            node *FalseEnd = Parser->ControlNode;
 
-            node *Region = GetOrCreateRegion(Parser,
-                                             Parser->ControlNode->Control.Prev,
-                                             TrueBranch, FalseBranch);
+            // NOTE(alex): The region points at the last control node of each
+            // branch (not at the projections), so anything that happened
+            // inside the branches stays reachable from the End node.
+            node *Region = GetOrCreateRegion(Parser, IF, TrueEnd, FalseEnd);
             Parser->ControlNode = Region;
 
-            MergeScopes(Parser, Region, TrueScope, FalseScope);
+            MergeScopes(Parser, Region, Scope, TrueScope, FalseScope);
         }
         else
         {
@@ -1164,16 +1428,266 @@ internal void ParseStatement(parser *Parser, tokenizer *Tokenizer, variable_scop
     }
 }
 
-internal void ParseFile(parser *Parser, tokenizer Tokenizer_)
+// NOTE(alex): Routines that declare a return type get an implicit Result
+// variable, which is what ends up being returned.
+internal void ParseRoutineBody(parser *Parser, tokenizer *Tokenizer, b32 HasResult)
 {
-    tokenizer *Tokenizer = &Tokenizer_;
+    TIMED_FUNCTION();
+
+    variable_scope Scope = BeginScope(Parser);
+
+    variable_binding *ResultVariable = 0;
+    if(HasResult)
+    {
+        ResultVariable = AddVariable(Parser, ConstZ("Result"), GetOrCreateInteger(Parser, 0));
+    }
+
+    variable_iterator Range = ParseBlock(Parser, Tokenizer);
+
+    node *ReturnValue = 0;
+    if(ResultVariable)
+    {
+        // NOTE(alex): Assigning to Result in the body (or merging it after an
+        // if) creates a new binding in the body's scope.
+        variable_binding *Assigned = GetVariableToMerge(Range, ResultVariable);
+        ReturnValue = Assigned ? Assigned->Value : ResultVariable->Value;
+    }
+
+    node *EndNode = Parser->EndNode;
+    EndNode->Control.Prev = Parser->ControlNode;
+    Parser->ControlNode = EndNode;
+
+    if(EndNode->Control.Data)
+    {
+        RemoveReference(Parser, EndNode->Control.Data);
+    }
+
+    EndNode->Control.Data = ReturnValue;
+    if(ReturnValue)
+    {
+        AddReference(Parser, ReturnValue);
+    }
+
+    FreeVariables(Parser, Range);
+    FreeVariables(Parser, IterateVariablesIn(Parser, Scope));
+    EndScope(Parser, Scope);
+}
+
+internal void ParseRoutine(routine_job *Job)
+{
+    parser *FileParser = Job->FileParser;
+    routine_definition *Routine = Job->Routine;
+    string Name = Routine->NameToken.Text;
+
+    TIMED_FUNCTION();
+    TIMED_ROUTINE(Name);
+
+    parser *Parser = BeginChildParser(FileParser);
+    Job->Parser = Parser;
+
+    if(FileParser->PeepholeStats)
+    {
+        // NOTE(alex): So the routines on other threads don't count into
+        // the same place.
+        Parser->PeepholeStats = PushPeepholeStats(&Parser->Arena);
+    }
+
+    if(FileParser->Queue)
+    {
+        Job->Out = OnMemory(&Parser->Arena);
+        Job->Out.Level = FileParser->Out->Level;
+        Job->Errors = OnMemory(&Parser->Arena);
+        Parser->Out = &Job->Out;
+        Parser->Errors = &Job->Errors;
+    }
+
+    u32 BodyNodeCount = 0;
+
+    b32 Cached = false;
+    char *CacheDirectory = FileParser->CacheDirectory;
+    if(CacheDirectory)
+    {
+        Cached = LoadCachedGraph(Parser, CacheDirectory, Routine->CacheKey, &BodyNodeCount);
+        AtomicAddU32(Cached ? &FileParser->CacheHitCount : &FileParser->CacheMissCount, 1);
+    }
+
+    if(Cached)
+    {
+        Outf(Parser->Out, "--- Begin procedure %.*s (cached) ---\n", ExpandString(Name));
+
+        // NOTE(alex): The body isn't parsed, so its #runs have to be
+        // counted from what was found while computing its key.
+        for(routine_reference *Reference = Routine->FirstRunTarget;
+            Reference;
+            Reference = Reference->Next)
+        {
+            AtomicAddU32(&Reference->Routine->ReferenceCount, 1);
+        }
+    }
+    else
+    {
+        if(FileParser->NodeTraceOut)
+        {
+            // NOTE(alex): Collected even without a queue, so the file's
+            // trace gets every routine in one piece.
+            Job->NodeTrace = OnMemory(&Parser->Arena);
+            Parser->NodeTrace = PushStruct(&Parser->Arena, node_trace);
+            Parser->NodeTrace->Dest = &Job->NodeTrace;
+        }
+
+        BeginRoutineTrace(Parser, Name);
+        BeginGraph(Parser);
+
+        Outf(Parser->Out, "--- Begin procedure %.*s ---\n", ExpandString(Name));
+
+        u32 StartNodeCount = Parser->NextNodeID;
+
+        tokenizer Tokenizer = Routine->Body;
+        Tokenizer.ErrorStream = Parser->Errors;
+        ParseRoutineBody(Parser, &Tokenizer, (Routine->TypeToken.Type == Token_Identifier));
+        Job->Failed = Tokenizer.Error;
+        EndRoutineTrace(Parser);
+
+        BodyNodeCount = Parser->NextNodeID - StartNodeCount;
+
+        if(CacheDirectory && !Job->Failed)
+        {
+            if(!StoreCachedGraph(Parser, CacheDirectory, Routine->CacheKey, BodyNodeCount))
+            {
+                AtomicAddU32(&FileParser->CacheWriteFailCount, 1);
+            }
+        }
+    }
+
+    if(IsOpen(Parser->Out, StreamLevel_Graph))
+    {
+        for(node *Node = Parser->EndNode;
+            Node;
+            Node = Node->Control.Prev)
+        {
+            // Assert(IsControl(Node));
+            DebugNode(Parser->Out, Node);
+            Outf(Parser->Out, "\n");
+        }
+    }
+
+    if(FileParser->NodeStats && !Job->Failed)
+    {
+        CountLiveNodes(&Parser->Arena, Parser->EndNode, Parser->NextNodeID, &Job->NodeStats);
+    }
+
+    if(!Job->Failed)
+    {
+        // NOTE(alex): These stay around until the routine's code gets written,
+        // which has to happen one routine at a time.
+        schedule *Schedule = ScheduleRoutine(&Parser->Arena, Parser->EndNode, Parser->NextNodeID);
+
+        // NOTE(alex): From here on the routine is the compacted copy, which
+        // has nothing on the free list, no IDs past its node count, and
+        // none of the old constants.
+        Parser->NextNodeID = CompactSchedule(&Parser->Arena, Schedule, &Parser->StartNode, &Parser->EndNode);
+        Parser->ControlNode = Parser->EndNode;
+        Parser->FirstFreeNode = 0;
+        InitHashTable(&Parser->Constants, &Parser->Arena);
+
+        register_allocation *Allocation =
+            AllocateRegisters(&Parser->Arena, Schedule, X64_ALLOCATABLE_REGISTER_COUNT);
+        Job->Schedule = Schedule;
+        Job->Allocation = Allocation;
+
+        if(IsOpen(Parser->Out, StreamLevel_Graph))
+        {
+            Outf(Parser->Out, "--- Allocated %u values in %u blocks to %u registers (%u spilled) ---\n",
+                 Allocation->ValueCount, Schedule->BlockCount,
+                 Allocation->RegistersUsed, Allocation->SpillCount);
+        }
+
+        if((Parser->ExecuteMode != Execute_None) && StringsAreEqual(Name, "Main"))
+        {
+            if(Parser->ExecuteMode == Execute_Graph)
+            {
+                ExecuteRoutineGraph(&Parser->Arena, Parser->Out, Parser->Errors, Name,
+                                    Parser->StartNode, Parser->EndNode, Parser->NextNodeID,
+                                    Parser->ExecuteArgument, Parser->BenchmarkCount);
+            }
+            else
+            {
+                ExecuteRoutineBytecode(&Parser->Arena, Parser->Out, Parser->Errors, Name,
+                                       Schedule, Parser->ExecuteArgument, Parser->BenchmarkCount);
+            }
+        }
+    }
+
+    Outf(Parser->Out, "--- End procedure %.*s (%u nodes) ---\n", ExpandString(Name), BodyNodeCount);
+}
+
+internal PLATFORM_WORK_QUEUE_CALLBACK(ParseRoutineWork)
+{
+    routine_job *Job = (routine_job *)Data;
+    ParseRoutine(Job);
+}
+
+// NOTE(alex): Writes a routine's output and code where the file's go, and
+// lets go of its parser. Returns false if the routine failed to parse.
+internal b32 EndRoutineJob(parser *Parser, routine_job *Job)
+{
+    FlushStream(&Job->Out, Parser->Out);
+    FlushStream(&Job->Errors, Parser->Errors);
+    if(Parser->NodeTraceOut)
+    {
+        FlushStream(&Job->NodeTrace, Parser->NodeTraceOut);
+    }
+
+    if(Parser->PeepholeStats)
+    {
+        AddPeepholeStats(Parser->PeepholeStats, Job->Parser->PeepholeStats);
+    }
+
+    if(!Job->Failed)
+    {
+        if(Parser->Object)
+        {
+            GenerateX64Routine(&Job->Parser->Arena, Parser->Object, Job->Routine->NameToken.Text,
+                               Job->Schedule, Job->Allocation);
+        }
+
+        if(Parser->NodeStats)
+        {
+            AddNodeStats(Parser->NodeStats, Job->Routine->NameToken.Text, &Job->NodeStats);
+        }
+    }
+    else if(Parser->NodeStats)
+    {
+        AddFailedNodeStats(Parser->NodeStats, Job->Routine->NameToken.Text);
+    }
+
+    EndChildParser(Job->Parser);
+    Job->Parser = 0;
+    Job->Schedule = 0;
+    Job->Allocation = 0;
+
+    b32 Result = !Job->Failed;
+    return Result;
+}
+
+internal void ParseFile(parser *Parser)
+{
+    TIMED_FUNCTION();
 
     string EntryName = ConstZ("Main");
     u32 EntryHash = StringHashOf(EntryName);
 
     routine_definition *Sentinel = &Parser->RoutineSentinel;
 
+    if(Parser->CacheDirectory)
+    {
+        // NOTE(alex): Keys depend on other routines' keys, so they're all
+        // worked out before any of the routines start.
+        ComputeGraphCacheKeys(Parser);
+    }
+
     routine_definition *EntryPoint = 0;
+    u32 JobCount = 0;
     for(routine_definition *Routine = Sentinel->Next;
         Routine != Sentinel;
         Routine = Routine->Next)
@@ -1182,63 +1696,150 @@ internal void ParseFile(parser *Parser, tokenizer Tokenizer_)
            StringsAreEqual(Routine->NameToken.Text, EntryName))
         {
             EntryPoint = Routine;
-            break;
         }
-    }
 
-    while(Parsing(Tokenizer))
-    {
-        if(OptionalToken(Tokenizer, Token_EndOfStream))
+        if(Routine->HasBody)
         {
-            break;
+            ++JobCount;
         }
+    }
 
-        token Token = RequireToken(Tokenizer, Token_Identifier);
-        if(Token.Type == Token_Identifier)
+    u32 RoutineCount = JobCount;
+    routine_job *Jobs = PushArray(&Parser->Arena, RoutineCount, routine_job);
+
+    /* NOTE(alex): In lazy mode we start with just the entry point, and every
+       round of parsing adds the routines that the previous round referenced
+       for the first time. Until there are calls, a #run is the only way to
+       reference a routine.
+
+       Routines are added in the order they appear in the file, so the jobs
+       (and with them the output) always come out in the same order.
+    */
+    JobCount = 0;
+    if(Parser->Lazy)
+    {
+        if(EntryPoint && EntryPoint->HasBody)
         {
-            token TypeToken = {};
-            token NameToken = Token;
+            EntryPoint->Compiled = true;
 
-            token Token = PeekToken(Tokenizer);
-            if(Token.Type == Token_Identifier)
+            routine_job *Job = Jobs + JobCount++;
+            Job->FileParser = Parser;
+            Job->Routine = EntryPoint;
+        }
+    }
+    else
+    {
+        for(routine_definition *Routine = Sentinel->Next;
+            Routine != Sentinel;
+            Routine = Routine->Next)
+        {
+            if(Routine->HasBody)
             {
-                TypeToken = NameToken;
-                NameToken = GetToken(Tokenizer);
+                Routine->Compiled = true;
+
+                routine_job *Job = Jobs + JobCount++;
+                Job->FileParser = Parser;
+                Job->Routine = Routine;
             }
+        }
+    }
 
-            b32 GotParameterList = false;
-            if(OptionalToken(Tokenizer, Token_OpenParen))
+    /* NOTE(alex): Every routine's nodes, schedule and output live in its own
+       parser, and the whole parser gets reset once the routine has been
+       written out. So rather than running all of them and then writing them
+       all out, they run a batch at a time, and each batch is written out and
+       let go of before the next one starts. That way a file never holds more
+       than a batch of routines at once, however many it has.
+
+       A batch is as many parsers as get pooled, so the next batch reuses the
+       memory of the last one. Without a queue nothing runs side by side, so
+       one routine at a time is enough.
+    */
+    u32 BatchSize = Parser->Queue ? MAX_POOLED_PARSERS : 1;
+
+    b32 Failed = false;
+    u32 FirstJob = 0;
+    while(FirstJob < JobCount)
+    {
+        u32 RoundJobCount = JobCount;
+        while(FirstJob < RoundJobCount)
+        {
+            u32 OnePastLastJob = Minimum(FirstJob + BatchSize, RoundJobCount);
+            if(Parser->Queue)
+            {
+                // NOTE(alex): We may well be running on the queue ourselves, so this
+                // can only wait for the routines of this file.
+                platform_work_group Group = {};
+                for(u32 JobIndex = FirstJob; JobIndex < OnePastLastJob; ++JobIndex)
+                {
+                    Platform.AddWorkQueueEntry(Parser->Queue, &Group, ParseRoutineWork, Jobs + JobIndex);
+                }
+                Platform.CompleteWorkGroup(Parser->Queue, &Group);
+            }
+            else
             {
-                GotParameterList = SkipBalancedBlock(Tokenizer, Token_OpenParen, Token_CloseParen);
+                for(u32 JobIndex = FirstJob; JobIndex < OnePastLastJob; ++JobIndex)
+                {
+                    ParseRoutine(Jobs + JobIndex);
+                }
             }
 
-            if(GotParameterList && OptionalToken(Tokenizer, Token_OpenBrace))
+            // NOTE(alex): The jobs are in the order the routines appear, so
+            // writing out every batch in order keeps the output in that order.
+            for(u32 JobIndex = FirstJob; JobIndex < OnePastLastJob; ++JobIndex)
             {
-                printf("--- Begin procedure %.*s ---\n", ExpandString(NameToken.Text));
+                if(!EndRoutineJob(Parser, Jobs + JobIndex))
+                {
+                    Failed = true;
+                }
+            }
 
-                u32 StartNodeCount = Parser->NextNodeID;
+            FirstJob = OnePastLastJob;
+        }
 
-                ParseBlock(Parser, Tokenizer);
+        for(routine_definition *Routine = Sentinel->Next;
+            Routine != Sentinel;
+            Routine = Routine->Next)
+        {
+            if(Routine->HasBody && Routine->ReferenceCount && !Routine->Compiled)
+            {
+                Routine->Compiled = true;
 
-                Parser->EndNode->Control.Prev = Parser->ControlNode;
-                Parser->ControlNode = Parser->EndNode;
+                routine_job *Job = Jobs + JobCount++;
+                Job->FileParser = Parser;
+                Job->Routine = Routine;
+            }
+        }
+    }
 
-                for(node *Node = Parser->EndNode;
-                    Node;
-                    Node = Node->Control.Prev)
-                {
-                    // Assert(IsControl(Node));
-                    DebugNode(Node);
-                    printf("\n");
-                }
+    if(Parser->Lazy)
+    {
+        Outf(Parser->Out, "--- Compiled %u of %u routines, only those reachable from %.*s ---\n",
+             JobCount, RoutineCount, ExpandString(EntryName));
+    }
+
+    if(Parser->Object && EntryPoint && !Failed)
+    {
+        GenerateX64EntryPoint(Parser->Object, EntryPoint->NameToken.Text);
+    }
 
-                Parser->ControlNode = Parser->StartNode;
+    if(Parser->RunCount)
+    {
+        Outf(Parser->Out, "--- Compile-time runs: %u ---\n", Parser->RunCount);
+    }
 
-                u32 EndNodeCount = Parser->NextNodeID;
-                u32 Difference = EndNodeCount - StartNodeCount;
+    if(Parser->CacheDirectory)
+    {
+        u32 LookupCount = Parser->CacheHitCount + Parser->CacheMissCount;
+        Outf(Parser->Out, "--- Graph cache: %u hits, %u misses (%u%%) ---\n",
+             Parser->CacheHitCount, Parser->CacheMissCount,
+             LookupCount ? (100*Parser->CacheHitCount / LookupCount) : 0);
 
-                printf("--- End procedure %.*s (%u nodes) ---\n", ExpandString(NameToken.Text), Difference);
-            }
+        // NOTE(alex): Once per file, rather than for every routine
+        if(Parser->CacheWriteFailCount)
+        {
+            Outf(Parser->Errors, "Error: Cannot write cache file for %u routines in \"%s\"\n",
+                 Parser->CacheWriteFailCount, Parser->CacheDirectory);
         }
     }
 }
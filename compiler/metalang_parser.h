@@ -26,16 +26,27 @@ struct type_definition
 
     string ID;
     u32 HashValue;
-
-    type_definition *NextInHash;
 };
 
+inline b32 HashKeysAreEqual(type_definition *Type, string Name)
+{
+    b32 Result = StringsAreEqual(Type->NameToken.Text, Name);
+    return Result;
+}
+
 struct parameter_definition
 {
     type_id Type;
     token NameToken;
 };
 
+struct routine_definition;
+struct routine_reference
+{
+    routine_definition *Routine;
+    routine_reference *Next;
+};
+
 struct routine_definition
 {
     token TypeToken;
@@ -45,14 +56,40 @@ struct routine_definition
     u32 ParameterCount;
     parameter_definition *Parameters;
 
+    // NOTE(alex): Positioned right after the opening brace, with its input
+    // ending at the closing one, so the body can be parsed again on its own.
+    b32 HasBody;
+    tokenizer Body;
+    u32 BodyHash;
+
+    // NOTE(alex): How many times the bodies being compiled mention this
+    // routine, which is what lazy mode follows.
+    u32 volatile ReferenceCount;
+    b32 Compiled;
+
+    // NOTE(alex): Only computed for routines that get #run, while holding
+    // the run cache's lock.
+    u32 RunKeyState;
+    u64 RunKey;
+
+    // NOTE(alex): Only computed when there's a graph cache. The key covers
+    // the body and the keys of every routine it #runs.
+    u32 CacheKeyState;
+    u64 CacheKey;
+    routine_reference *FirstRunTarget;
+
     // TODO(alex): If we never end up needing to remove routines,
     // we can just make this a singly linked list.
     routine_definition *Prev;
     routine_definition *Next;
-
-    routine_definition *NextInHash;
 };
 
+inline b32 HashKeysAreEqual(routine_definition *Routine, string Name)
+{
+    b32 Result = StringsAreEqual(Routine->NameToken.Text, Name);
+    return Result;
+}
+
 struct variable_binding
 {
     string Name;
@@ -71,25 +108,117 @@ struct variable_scope
     variable_binding *End;
 };
 
+enum execute_mode
+{
+    Execute_None,
+    Execute_Bytecode,
+    Execute_Graph,
+};
+
+struct peephole_stats;
+
 struct parser
 {
     memory_arena Arena;
     FILE *Stream;
 
+    // NOTE(alex): Begun right after the parser itself was pushed. Ending it
+    // resets the parser, but keeps its first block for the next use.
+    temporary_memory Scope;
+
+    // NOTE(alex): Routine parsers are handed back to the file parser once
+    // they're done, and file parsers to the driver, so the memory they've
+    // already touched gets used again instead of being mapped fresh.
+    ticket_mutex PoolMutex;
+    u32 PooledCount;
+    parser *FirstPooled;
+    parser *NextPooled;
+
+    // NOTE(alex): Set by the driver, everything this file prints goes here
+    stream *Out;
+    stream *Errors;
+
+    // NOTE(alex): Only set when routines should be parsed in parallel
+    platform_work_queue *Queue;
+
+    // NOTE(alex): Only set for parsers that evaluate a #run, which look
+    // routines up in their parent.
+    parser *Parent;
+    u32 MetaDepth;
+
+    u32 RunCount;
+
+    // NOTE(alex): Only set when finished graphs are kept on disk
+    char *CacheDirectory;
+    u32 volatile CacheHitCount;
+    u32 volatile CacheMissCount;
+    u32 volatile CacheWriteFailCount;
+
+    // NOTE(alex): Only set when we're writing native code
+    object_builder *Object;
+
+    // NOTE(alex): Only set when the live nodes get recorded or checked
+    node_stats_file *NodeStats;
+
+    // NOTE(alex): Only set when the node operations get traced. The file's
+    // parser has where the routines' traces go, and a routine's parser
+    // has the trace it's writing while its body gets parsed.
+    stream *NodeTraceOut;
+    node_trace *NodeTrace;
+
+    // NOTE(alex): Only set for -peepstats. The file's parser has the totals,
+    // and a routine's parser counts its own, which get added to the file's
+    // once it's done. The parsers of its #runs count into the routine's.
+    peephole_stats *PeepholeStats;
+
+    // NOTE(alex): Set by the driver
+    b32 Lazy;
+    b32 DisablePeephole;
+    execute_mode ExecuteMode;
+    s32 ExecuteArgument;
+    u32 BenchmarkCount;
+
     node *StartNode;
     node *EndNode;
     node *ControlNode;
 
     node *FirstFreeNode;
     u32 NextNodeID;
+    u32 FreedNodeCount;
+
+    // NOTE(alex): Every constant of the routine, so each value is only ever
+    // one node. The table holds a reference to all of them.
+    hash_table<node> Constants;
 
     variable_binding *MostRecentVariable;
     variable_binding *FirstFreeVariable;
 
     routine_definition RoutineSentinel;
-    routine_definition *RoutineHash[4096];
+    hash_table<routine_definition> Routines;
+
+    hash_table<type_definition> Types;
+};
 
-    type_definition *TypeHash[4096];
+struct schedule;
+struct register_allocation;
+
+// NOTE(alex): Every routine is parsed with a parser of its own, so they can
+// all be parsed at the same time. Whatever they print is collected, and
+// written out in the order the routines appear in the file.
+struct routine_job
+{
+    parser *FileParser;
+    routine_definition *Routine;
+
+    parser *Parser;
+    stream Out;
+    stream Errors;
+
+    b32 Failed;
+    schedule *Schedule;
+    register_allocation *Allocation;
+    node_stats NodeStats;
+    stream NodeTrace;
 };
 
 internal node *ParseExpression(parser *Parser, tokenizer *Tokenizer);
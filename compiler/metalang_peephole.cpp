@@ -0,0 +1,460 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+#define AnyOperand {Match_Any, Node_Invalid}
+#define ConstantOperand {Match_Constant, Node_Invalid}
+#define NonConstantOperand {Match_NotConstant, Node_Invalid}
+#define OperatorOperand {Match_Operator, Node_Invalid}
+#define TypeOperand(Type) {Match_Type, Type}
+#define NotTypeOperand(Type) {Match_NotType, Type}
+
+global peephole_rule PeepholeRules[] =
+{
+    //
+    // NOTE(alex): Additions are turned into a chain leaning left, with the
+    // constants at the end of it, where they fold into each other, and the
+    // rest in the order SplineCompare puts them in.
+    //
+
+    {"x + 0 -> x", Node_Add, AnyOperand, ConstantOperand, Guard_RHSIsValue, 0, Rewrite_LHS, Node_Invalid},
+    {"x + x -> x * 2", Node_Add, AnyOperand, AnyOperand, Guard_SameOperands, 0, Rewrite_DoubleToMul, Node_Invalid},
+    {"x + (y + z) -> (y + z) + x", Node_Add, NotTypeOperand(Node_Add), TypeOperand(Node_Add), Guard_None, 0, Rewrite_Swap, Node_Invalid},
+    {"(w + x) + (y + z) -> ((w + x) + y) + z", Node_Add, TypeOperand(Node_Add), TypeOperand(Node_Add), Guard_None, 0, Rewrite_AddAssociateLeft, Node_Invalid},
+    {"y + x -> x + y", Node_Add, NotTypeOperand(Node_Add), NotTypeOperand(Node_Add), Guard_SplineOrder, 0, Rewrite_Swap, Node_Invalid},
+    {"(x + c1) + c2 -> x + (c1 + c2)", Node_Add, TypeOperand(Node_Add), ConstantOperand, Guard_LHSRightIsConstant, 0, Rewrite_AddFoldConstants, Node_Invalid},
+    {"(x + z) + y -> (x + y) + z", Node_Add, TypeOperand(Node_Add), NotTypeOperand(Node_Add), Guard_LHSRightSplineOrder, 0, Rewrite_AddSortLeft, Node_Invalid},
+
+    {"x * 1 -> x", Node_Mul, AnyOperand, ConstantOperand, Guard_RHSIsValue, 1, Rewrite_LHS, Node_Invalid},
+    {"c * x -> x * c", Node_Mul, ConstantOperand, NonConstantOperand, Guard_None, 0, Rewrite_Swap, Node_Invalid},
+
+    {"x / 1 -> x", Node_Div, AnyOperand, ConstantOperand, Guard_RHSIsValue, 1, Rewrite_LHS, Node_Invalid},
+
+    {"!(x == y) -> x != y", Node_Not, TypeOperand(Node_EQ), AnyOperand, Guard_None, 0, Rewrite_Compare, Node_NE},
+    {"!(x < y) -> y <= x", Node_Not, TypeOperand(Node_LT), AnyOperand, Guard_None, 0, Rewrite_CompareSwapped, Node_LE},
+    {"!(x <= y) -> y < x", Node_Not, TypeOperand(Node_LE), AnyOperand, Guard_None, 0, Rewrite_CompareSwapped, Node_LT},
+
+    {"phi(x, x) -> x", Node_Phi, AnyOperand, AnyOperand, Guard_SameOperands, 0, Rewrite_LHS, Node_Invalid},
+    {"phi(a op b, c op d) -> phi(a, c) op phi(b, d)", Node_Phi, OperatorOperand, OperatorOperand, Guard_SameBinaryOperator, 0, Rewrite_PhiOfOperators, Node_Invalid},
+};
+
+#undef AnyOperand
+#undef ConstantOperand
+#undef NonConstantOperand
+#undef OperatorOperand
+#undef TypeOperand
+#undef NotTypeOperand
+
+global peephole_matcher *GlobalPeepholeMatcher;
+
+inline u32 GetPeepholeShape(node *Operand)
+{
+    u32 Result = 0;
+    if(Operand)
+    {
+        Result = Operand->Type;
+        if(IsConstantType(Operand->DataType))
+        {
+            Result += Node_Count;
+        }
+    }
+
+    return Result;
+}
+
+internal b32 ShapeMatches(peephole_operand Pattern, u32 Shape)
+{
+    b32 Result = false;
+
+    // NOTE(alex): Only a rule that takes anything takes a missing input
+    if(Pattern.Match == Match_Any)
+    {
+        Result = true;
+    }
+    else if(Shape)
+    {
+        node_type Type = (node_type)(Shape % Node_Count);
+        b32 Constant = (Shape >= Node_Count);
+
+        switch(Pattern.Match)
+        {
+            case Match_Constant: {Result = Constant;} break;
+            case Match_NotConstant: {Result = !Constant;} break;
+            case Match_Type: {Result = (Type == Pattern.Type);} break;
+            case Match_NotType: {Result = (Type != Pattern.Type);} break;
+            case Match_Operator: {Result = (Type >= Node_Add);} break;
+            InvalidDefaultCase;
+        }
+    }
+
+    return Result;
+}
+
+inline u64 *GetPeepholeCandidates(peephole_table *Table, u32 LHSShape, u32 RHSShape)
+{
+    u64 *Result = Table->Candidates + (LHSShape*PEEPHOLE_SHAPE_COUNT + RHSShape)*Table->WordCount;
+    return Result;
+}
+
+// NOTE(alex): Has to happen before anything gets parsed, and only once,
+// since the parsers on the other threads use it without locking.
+internal void BuildPeepholeMatcher(void)
+{
+    Assert(!GlobalPeepholeMatcher);
+    peephole_matcher *Matcher = BootstrapPushStruct(peephole_matcher, Arena);
+
+    u32 RuleCounts[Node_Count] = {};
+    for(u32 RuleIndex = 0; RuleIndex < ArrayCount(PeepholeRules); ++RuleIndex)
+    {
+        ++RuleCounts[PeepholeRules[RuleIndex].Type];
+    }
+
+    for(u32 Type = 0; Type < Node_Count; ++Type)
+    {
+        u32 RuleCount = RuleCounts[Type];
+        if(RuleCount)
+        {
+            peephole_table *Table = PushStruct(&Matcher->Arena, peephole_table);
+            Table->Rules = PushArray(&Matcher->Arena, RuleCount, peephole_rule *);
+            Table->WordCount = (RuleCount + 63) / 64;
+            Table->Candidates = PushArray(&Matcher->Arena,
+                                          PEEPHOLE_SHAPE_COUNT*PEEPHOLE_SHAPE_COUNT*Table->WordCount, u64);
+            Matcher->Tables[Type] = Table;
+        }
+    }
+
+    for(u32 RuleIndex = 0; RuleIndex < ArrayCount(PeepholeRules); ++RuleIndex)
+    {
+        peephole_rule *Rule = PeepholeRules + RuleIndex;
+
+        peephole_table *Table = Matcher->Tables[Rule->Type];
+        u32 WordIndex = Table->RuleCount / 64;
+        u64 Bit = 1ull << (Table->RuleCount % 64);
+        Table->Rules[Table->RuleCount++] = Rule;
+
+        for(u32 LHSShape = 0; LHSShape < PEEPHOLE_SHAPE_COUNT; ++LHSShape)
+        {
+            if(ShapeMatches(Rule->LHS, LHSShape))
+            {
+                for(u32 RHSShape = 0; RHSShape < PEEPHOLE_SHAPE_COUNT; ++RHSShape)
+                {
+                    if(ShapeMatches(Rule->RHS, RHSShape))
+                    {
+                        u64 *Candidates = GetPeepholeCandidates(Table, LHSShape, RHSShape);
+                        Candidates[WordIndex] |= Bit;
+                    }
+                }
+            }
+        }
+    }
+
+    GlobalPeepholeMatcher = Matcher;
+}
+
+internal b32 GuardHolds(peephole_rule *Rule, node *LHS, node *RHS)
+{
+    b32 Result = false;
+
+    switch(Rule->Guard)
+    {
+        case Guard_None:
+        {
+            Result = true;
+        } break;
+
+        case Guard_SameOperands:
+        {
+            Result = (LHS == RHS);
+        } break;
+
+        case Guard_RHSIsValue:
+        {
+            Result = (IsConstantInteger(RHS->DataType) && (RHS->DataType.Value == Rule->Value));
+        } break;
+
+        case Guard_LHSRightIsConstant:
+        {
+            Result = IsConstantType(LHS->Operands[1]->DataType);
+        } break;
+
+        case Guard_SplineOrder:
+        {
+            Result = SplineCompare(LHS, RHS);
+        } break;
+
+        case Guard_LHSRightSplineOrder:
+        {
+            Result = SplineCompare(LHS->Operands[1], RHS);
+        } break;
+
+        case Guard_SameBinaryOperator:
+        {
+            Result = ((LHS->Type == RHS->Type) &&
+                      LHS->Operands[1] && RHS->Operands[1]);
+        } break;
+
+        InvalidDefaultCase;
+    }
+
+    return Result;
+}
+
+internal node *Rewrite(parser *Parser, peephole_rule *Rule, node *Node)
+{
+    node *Result = 0;
+
+    node *LHS = Node->Operands[0];
+    node *RHS = Node->Operands[1];
+
+    switch(Rule->Rewrite)
+    {
+        case Rewrite_LHS:
+        {
+            Result = LHS;
+        } break;
+
+        case Rewrite_Swap:
+        {
+            Result = SwapOperands(Node);
+        } break;
+
+        case Rewrite_DoubleToMul:
+        {
+            node *Two = GetOrCreateInteger(Parser, 2);
+            Result = GetOrCreateNode(Parser, Node_Mul, LHS, Two);
+        } break;
+
+        case Rewrite_AddAssociateLeft:
+        {
+            node *X = LHS;
+            node *Y = RHS->Operands[0];
+            node *Z = RHS->Operands[1];
+
+            node *XY = Peephole(Parser, GetOrCreateNode(Parser, Node_Add, X, Y));
+            Result = GetOrCreateNode(Parser, Node_Add, XY, Z);
+        } break;
+
+        case Rewrite_AddFoldConstants:
+        {
+            node *X = LHS->Operands[0];
+            node *Y = LHS->Operands[1];
+            node *Z = RHS;
+
+            node *YZ = Peephole(Parser, GetOrCreateNode(Parser, Node_Add, Y, Z));
+            Result = GetOrCreateNode(Parser, Node_Add, X, YZ);
+        } break;
+
+        case Rewrite_AddSortLeft:
+        {
+            node *X = LHS->Operands[0];
+            node *Y = RHS;
+            node *Z = LHS->Operands[1];
+
+            node *XY = Peephole(Parser, GetOrCreateNode(Parser, Node_Add, X, Y));
+            Result = GetOrCreateNode(Parser, Node_Add, XY, Z);
+        } break;
+
+        case Rewrite_Compare:
+        {
+            Result = GetOrCreateNode(Parser, Rule->ResultType, LHS->Operands[0], LHS->Operands[1]);
+        } break;
+
+        case Rewrite_CompareSwapped:
+        {
+            Result = GetOrCreateNode(Parser, Rule->ResultType, LHS->Operands[1], LHS->Operands[0]);
+        } break;
+
+        case Rewrite_PhiOfOperators:
+        {
+            // NOTE(alex): The new phis have to hang off the same region, otherwise
+            // the backend can't tell which predecessor each input comes from.
+            node *Region = GetPhiRegion(Node);
+            node *PhiLHS = Peephole(Parser, GetOrCreatePhi(Parser, Region, LHS->Operands[0], RHS->Operands[0]));
+            node *PhiRHS = Peephole(Parser, GetOrCreatePhi(Parser, Region, LHS->Operands[1], RHS->Operands[1]));
+            Result = GetOrCreateNode(Parser, LHS->Type, PhiLHS, PhiRHS);
+        } break;
+
+        InvalidDefaultCase;
+    }
+
+    return Result;
+}
+
+internal node *Idealize(parser *Parser, node *Node, peephole_rule **Matched)
+{
+    node *Result = 0;
+
+    Assert(GlobalPeepholeMatcher);
+    peephole_table *Table = GlobalPeepholeMatcher->Tables[Node->Type];
+    if(Table)
+    {
+        node *LHS = Node->Operands[0];
+        node *RHS = Node->Operands[1];
+
+        u64 *Candidates = GetPeepholeCandidates(Table, GetPeepholeShape(LHS), GetPeepholeShape(RHS));
+        for(u32 WordIndex = 0; !Result && (WordIndex < Table->WordCount); ++WordIndex)
+        {
+            u64 Word = Candidates[WordIndex];
+            while(Word)
+            {
+                peephole_rule *Rule = Table->Rules[64*WordIndex + FindLeastSignificantSetBit(Word)];
+                if(GuardHolds(Rule, LHS, RHS))
+                {
+                    Result = Rewrite(Parser, Rule, Node);
+                    *Matched = Rule;
+                    break;
+                }
+
+                Word &= Word - 1;
+            }
+        }
+    }
+
+    return Result;
+}
+
+internal peephole_stats *PushPeepholeStats(memory_arena *Arena)
+{
+    peephole_stats *Stats = PushStruct(Arena, peephole_stats);
+    Stats->Rules = PushArray(Arena, ArrayCount(PeepholeRules), peephole_counts);
+
+    return Stats;
+}
+
+internal peephole_counter BeginPeepholeCounter(parser *Parser)
+{
+    peephole_counter Result = {};
+
+    peephole_stats *Stats = Parser->PeepholeStats;
+    if(Stats)
+    {
+        ++Stats->RunCount;
+        ++Stats->Depth;
+
+        Result.StartNodeID = Parser->NextNodeID;
+        Result.StartFreedCount = Parser->FreedNodeCount;
+        Result.StartCycles = __rdtsc();
+    }
+
+    return Result;
+}
+
+inline void CountPeephole(parser *Parser, peephole_counter *Counter, peephole_counts *Counts)
+{
+    ++Counts->MatchCount;
+    Counts->CreatedCount += Parser->NextNodeID - Counter->StartNodeID;
+    Counts->FreedCount += Parser->FreedNodeCount - Counter->StartFreedCount;
+    Counts->Cycles += __rdtsc() - Counter->StartCycles;
+}
+
+internal void CountPeepholeRule(parser *Parser, peephole_counter *Counter, peephole_rule *Rule)
+{
+    peephole_stats *Stats = Parser->PeepholeStats;
+    if(Stats)
+    {
+        CountPeephole(Parser, Counter, Stats->Rules + (Rule - PeepholeRules));
+    }
+}
+
+internal void CountPeepholeFold(parser *Parser, peephole_counter *Counter, node_type Type)
+{
+    peephole_stats *Stats = Parser->PeepholeStats;
+    if(Stats)
+    {
+        CountPeephole(Parser, Counter, Stats->Folds + Type);
+    }
+}
+
+internal void CountPeepholeMiss(parser *Parser, peephole_counter *Counter)
+{
+    peephole_stats *Stats = Parser->PeepholeStats;
+    if(Stats)
+    {
+        CountPeephole(Parser, Counter, &Stats->Misses);
+    }
+}
+
+internal void EndPeepholeCounter(parser *Parser, peephole_counter *Counter)
+{
+    peephole_stats *Stats = Parser->PeepholeStats;
+    if(Stats)
+    {
+        Assert(Stats->Depth);
+        if(--Stats->Depth == 0)
+        {
+            Stats->Cycles += __rdtsc() - Counter->StartCycles;
+        }
+    }
+}
+
+inline void AddPeepholeCounts(peephole_counts *Dest, peephole_counts *Source)
+{
+    Dest->MatchCount += Source->MatchCount;
+    Dest->CreatedCount += Source->CreatedCount;
+    Dest->FreedCount += Source->FreedCount;
+    Dest->Cycles += Source->Cycles;
+}
+
+internal void AddPeepholeStats(peephole_stats *Dest, peephole_stats *Source)
+{
+    Assert(!Source->Depth);
+
+    Dest->RunCount += Source->RunCount;
+    Dest->Cycles += Source->Cycles;
+
+    for(u32 RuleIndex = 0; RuleIndex < ArrayCount(PeepholeRules); ++RuleIndex)
+    {
+        AddPeepholeCounts(Dest->Rules + RuleIndex, Source->Rules + RuleIndex);
+    }
+
+    for(u32 Type = 0; Type < Node_Count; ++Type)
+    {
+        AddPeepholeCounts(Dest->Folds + Type, Source->Folds + Type);
+    }
+
+    AddPeepholeCounts(&Dest->Misses, &Source->Misses);
+}
+
+internal void OutputPeepholeCounts(stream *Out, char *Name, peephole_counts *Counts, u64 TotalCycles)
+{
+    Outf(Out, "    %-48s %9llu %9llu %9llu %12llu %6.1f%%\n", Name,
+         Counts->MatchCount, Counts->CreatedCount, Counts->FreedCount, Counts->Cycles,
+         TotalCycles ? 100.0*(f64)Counts->Cycles / (f64)TotalCycles : 0.0);
+}
+
+internal void OutputPeepholeStats(stream *Out, peephole_stats *Stats)
+{
+    Outf(Out, "--- Peepholes: %llu run, %llu cycles, %.1f cycles each ---\n",
+         Stats->RunCount, Stats->Cycles,
+         Stats->RunCount ? (f64)Stats->Cycles / (f64)Stats->RunCount : 0.0);
+    Outf(Out, "    %-48s %9s %9s %9s %12s %7s\n", "Rule", "Matched", "Made", "Freed", "Cycles", "Share");
+
+    // NOTE(alex): Every rule, even the ones that never fired, since those
+    // are the ones worth asking whether they pay for themselves.
+    for(u32 RuleIndex = 0; RuleIndex < ArrayCount(PeepholeRules); ++RuleIndex)
+    {
+        OutputPeepholeCounts(Out, PeepholeRules[RuleIndex].Name, Stats->Rules + RuleIndex, Stats->Cycles);
+    }
+
+    for(u32 Type = 0; Type < Node_Count; ++Type)
+    {
+        peephole_counts *Counts = Stats->Folds + Type;
+        if(Counts->MatchCount)
+        {
+            char Name[64];
+            string TypeName = GetNodeTypeName((node_type)Type);
+            FormatString(sizeof(Name), Name, "fold %.*s", ExpandString(TypeName));
+            OutputPeepholeCounts(Out, Name, Counts, Stats->Cycles);
+        }
+    }
+
+    OutputPeepholeCounts(Out, "(no match)", &Stats->Misses, Stats->Cycles);
+}
@@ -0,0 +1,156 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): The peepholes are a table of rules rather than code. A rule
+   says what kind of node it's about, what its two inputs have to look
+   like, an optional guard that needs to look at more than that, and what
+   to rewrite the node into. The first rule that matches wins, so the order
+   of the table is part of the rules.
+
+   What an input looks like is its node type, and whether its type is
+   constant. That's all most rules care about, so at startup the table is
+   turned into one grid per node type, with a cell for every pair of those
+   shapes, holding the set of rules that can match it. Matching a node is
+   then a lookup, and only the guards of what's left are checked, however
+   many rules the table has.
+*/
+
+enum peephole_match
+{
+    Match_Any,
+    Match_Constant,
+    Match_NotConstant,
+    Match_Type,
+    Match_NotType,
+    Match_Operator,
+};
+
+struct peephole_operand
+{
+    peephole_match Match;
+    node_type Type;
+};
+
+enum peephole_guard
+{
+    Guard_None,
+
+    Guard_SameOperands,
+    Guard_RHSIsValue,
+    Guard_LHSRightIsConstant,
+    Guard_SplineOrder,
+    Guard_LHSRightSplineOrder,
+    Guard_SameBinaryOperator,
+};
+
+enum peephole_rewrite
+{
+    Rewrite_LHS,
+    Rewrite_Swap,
+    Rewrite_DoubleToMul,
+    Rewrite_AddAssociateLeft,
+    Rewrite_AddFoldConstants,
+    Rewrite_AddSortLeft,
+    Rewrite_Compare,
+    Rewrite_CompareSwapped,
+    Rewrite_PhiOfOperators,
+};
+
+struct peephole_rule
+{
+    char *Name;
+
+    node_type Type;
+    peephole_operand LHS;
+    peephole_operand RHS;
+
+    peephole_guard Guard;
+    s32 Value; // NOTE(alex): Only for Guard_RHSIsValue
+
+    peephole_rewrite Rewrite;
+    node_type ResultType; // NOTE(alex): Only for Rewrite_Compare(Swapped)
+};
+
+// NOTE(alex): An input is its node type, plus Node_Count if its type is
+// constant. Zero, which no node has as its type, is no input at all.
+#define PEEPHOLE_SHAPE_COUNT (2*Node_Count)
+
+struct peephole_table
+{
+    u32 RuleCount;
+    peephole_rule **Rules;
+
+    // NOTE(alex): WordCount words for every pair of shapes, as many as it
+    // takes to have a bit for each of the type's rules. Bit N of them is
+    // set if Rules[N] matches the shapes of the inputs.
+    u32 WordCount;
+    u64 *Candidates;
+};
+
+struct peephole_matcher
+{
+    memory_arena Arena;
+
+    // NOTE(alex): Zero for the node types no rule is about
+    peephole_table *Tables[Node_Count];
+};
+
+/* NOTE(alex): For -peepstats. Every rule, and every node type ComputeType
+   folds into a constant, counts how often it fired, how many nodes it made
+   and freed, and how long it took. A rewrite peepholes the nodes it makes
+   along the way, so those count towards it as well, but the peephole of
+   what it rewrote the node into doesn't; that goes to whatever fires on it
+   next. So the cycles of the rules add up to more than the total, which
+   only counts the outermost peepholes.
+*/
+
+struct peephole_counts
+{
+    u64 MatchCount;
+    u64 CreatedCount;
+    u64 FreedCount;
+    u64 Cycles;
+};
+
+struct peephole_stats
+{
+    u64 RunCount;
+    u64 Cycles;
+    u32 Depth;
+
+    // NOTE(alex): One for every rule in the table
+    peephole_counts *Rules;
+    peephole_counts Folds[Node_Count];
+
+    // NOTE(alex): Peepholes that left the node as it was
+    peephole_counts Misses;
+};
+
+struct peephole_counter
+{
+    u64 StartCycles;
+    u32 StartNodeID;
+    u32 StartFreedCount;
+};
+
+struct parser;
+
+internal void BuildPeepholeMatcher(void);
+internal node *Idealize(parser *Parser, node *Node, peephole_rule **Matched);
+
+internal peephole_stats *PushPeepholeStats(memory_arena *Arena);
+internal peephole_counter BeginPeepholeCounter(parser *Parser);
+internal void CountPeepholeRule(parser *Parser, peephole_counter *Counter, peephole_rule *Rule);
+internal void CountPeepholeFold(parser *Parser, peephole_counter *Counter, node_type Type);
+internal void CountPeepholeMiss(parser *Parser, peephole_counter *Counter);
+internal void EndPeepholeCounter(parser *Parser, peephole_counter *Counter);
+internal void AddPeepholeStats(peephole_stats *Dest, peephole_stats *Source);
@@ -23,6 +23,10 @@ struct platform_memory_block
     u8 *Base;
     umm Used;
     platform_memory_block *ArenaPrev;
+
+    // NOTE(alex): The most that was ever used. Blocks come from the OS
+    // cleared, so everything past this is still zero.
+    umm MaxUsed;
 };
 
 #define PLATFORM_ALLOCATE_MEMORY(name) platform_memory_block *name(umm Size, u64 Flags)
@@ -31,9 +35,129 @@ typedef PLATFORM_ALLOCATE_MEMORY(platform_allocate_memory);
 #define PLATFORM_DEALLOCATE_MEMORY(name) void name(platform_memory_block *Block)
 typedef PLATFORM_DEALLOCATE_MEMORY(platform_deallocate_memory);
 
+// NOTE(alex): Sizes are what the arenas asked for, without the headers and
+// guard pages. ResetPeak starts measuring the peak over again from whatever
+// is allocated right now.
+struct platform_memory_stats
+{
+    umm BlockCount;
+    umm TotalSize;
+    umm PeakSize;
+};
+#define PLATFORM_GET_MEMORY_STATS(name) platform_memory_stats name(b32 ResetPeak)
+typedef PLATFORM_GET_MEMORY_STATS(platform_get_memory_stats);
+
+/* NOTE(alex): Every thread of a work queue has its own deque of entries.
+   Entries added from one of the queue's threads go on that thread's deque,
+   and entries added from anywhere else go on the deque of the thread that
+   created the queue. A thread always takes the newest entry of its own
+   deque first, and once that's empty it steals the oldest entry of somebody
+   else's.
+
+   CompleteAllWork has the calling thread help out until there's nothing
+   left to do, so a queue created with a thread count of one runs everything
+   on the calling thread.
+
+   A deque only has room for so many entries, so anything that adds a lot
+   of them adds a batch, completes it, and only then adds the next one.
+
+   DestroyWorkQueue completes whatever is left, stops the queue's threads
+   and frees it. Only the thread that created the queue may call it.
+
+   Work that is itself running on the queue can't wait for the whole queue,
+   since it would be waiting on itself. It puts the entries it adds in a
+   group instead, and only waits for those with CompleteWorkGroup (helping
+   out with whatever else is queued in the meantime).
+*/
+struct platform_work_queue;
+
+struct platform_work_group
+{
+    u32 volatile CompletionGoal;
+    u32 volatile CompletionCount;
+};
+
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(platform_work_queue *Queue, void *Data)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(platform_work_queue_callback);
+
+#define PLATFORM_CREATE_WORK_QUEUE(name) platform_work_queue *name(u32 ThreadCount)
+typedef PLATFORM_CREATE_WORK_QUEUE(platform_create_work_queue);
+
+#define PLATFORM_DESTROY_WORK_QUEUE(name) void name(platform_work_queue *Queue)
+typedef PLATFORM_DESTROY_WORK_QUEUE(platform_destroy_work_queue);
+
+#define PLATFORM_ADD_WORK_QUEUE_ENTRY(name) void name(platform_work_queue *Queue, platform_work_group *Group, platform_work_queue_callback *Callback, void *Data)
+typedef PLATFORM_ADD_WORK_QUEUE_ENTRY(platform_add_work_queue_entry);
+
+#define PLATFORM_COMPLETE_ALL_WORK(name) void name(platform_work_queue *Queue)
+typedef PLATFORM_COMPLETE_ALL_WORK(platform_complete_all_work);
+
+#define PLATFORM_COMPLETE_WORK_GROUP(name) void name(platform_work_queue *Queue, platform_work_group *Group)
+typedef PLATFORM_COMPLETE_WORK_GROUP(platform_complete_work_group);
+
+#define PLATFORM_GET_PROCESSOR_COUNT(name) u32 name(void)
+typedef PLATFORM_GET_PROCESSOR_COUNT(platform_get_processor_count);
+
+/* NOTE(alex): Local stream sockets (AF_UNIX), named by a path on disk.
+   Send and Receive only come back once all of the bytes went through, and
+   return false if the other side went away first.
+*/
+struct platform_socket
+{
+    u64 Handle;
+    b32 Valid;
+};
+
+#define PLATFORM_OPEN_SERVER_SOCKET(name) platform_socket name(char *Path)
+typedef PLATFORM_OPEN_SERVER_SOCKET(platform_open_server_socket);
+
+#define PLATFORM_ACCEPT_CONNECTION(name) platform_socket name(platform_socket Listener)
+typedef PLATFORM_ACCEPT_CONNECTION(platform_accept_connection);
+
+#define PLATFORM_CONNECT_TO_SERVER(name) platform_socket name(char *Path)
+typedef PLATFORM_CONNECT_TO_SERVER(platform_connect_to_server);
+
+#define PLATFORM_SEND_TO_SOCKET(name) b32 name(platform_socket Socket, umm Size, void *Data)
+typedef PLATFORM_SEND_TO_SOCKET(platform_send_to_socket);
+
+#define PLATFORM_RECEIVE_FROM_SOCKET(name) b32 name(platform_socket Socket, umm Size, void *Data)
+typedef PLATFORM_RECEIVE_FROM_SOCKET(platform_receive_from_socket);
+
+#define PLATFORM_CLOSE_SOCKET(name) void name(platform_socket Socket)
+typedef PLATFORM_CLOSE_SOCKET(platform_close_socket);
+
+/* NOTE(alex): MakeDirectory is fine with the directory already being there.
+   MoveFileReplacing moves a file over whatever is at the destination in one
+   step, so anyone opening it gets either the old file or the new one, and
+   never half of one.
+*/
+#define PLATFORM_MAKE_DIRECTORY(name) b32 name(char *Path)
+typedef PLATFORM_MAKE_DIRECTORY(platform_make_directory);
+
+#define PLATFORM_MOVE_FILE_REPLACING(name) b32 name(char *SourcePath, char *DestPath)
+typedef PLATFORM_MOVE_FILE_REPLACING(platform_move_file_replacing);
+
 struct platform_api
 {
     platform_allocate_memory *AllocateMemory;
     platform_deallocate_memory *DeallocateMemory;
+    platform_get_memory_stats *GetMemoryStats;
+
+    platform_create_work_queue *CreateWorkQueue;
+    platform_destroy_work_queue *DestroyWorkQueue;
+    platform_add_work_queue_entry *AddWorkQueueEntry;
+    platform_complete_all_work *CompleteAllWork;
+    platform_complete_work_group *CompleteWorkGroup;
+    platform_get_processor_count *GetProcessorCount;
+
+    platform_open_server_socket *OpenServerSocket;
+    platform_accept_connection *AcceptConnection;
+    platform_connect_to_server *ConnectToServer;
+    platform_send_to_socket *SendToSocket;
+    platform_receive_from_socket *ReceiveFromSocket;
+    platform_close_socket *CloseSocket;
+
+    platform_make_directory *MakeDirectory;
+    platform_move_file_replacing *MoveFileReplacing;
 };
 extern platform_api Platform;
@@ -0,0 +1,380 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+#define PRESCAN_CHUNK_SIZE 32
+
+enum prescan_state
+{
+    Prescan_Code,
+    Prescan_String,
+    Prescan_LineComment,
+    Prescan_BlockComment,
+
+    Prescan_Count,
+};
+
+// NOTE(alex): One bit per byte of a chunk, first byte in the low bit
+struct prescan_chunk
+{
+    u32 Brackets;
+    u32 Opening;
+    u32 Braces;
+
+    // NOTE(alex): The bytes that matter in each state. In code, the brackets
+    // don't count, those are taken all at once up to the next one of these.
+    u32 Interesting[Prescan_Count];
+};
+
+inline u32 GetByteMask(__m128i Low, __m128i High, char C)
+{
+    __m128i Match = _mm_set1_epi8(C);
+    u32 Result = ((u32)_mm_movemask_epi8(_mm_cmpeq_epi8(Low, Match)) |
+                  ((u32)_mm_movemask_epi8(_mm_cmpeq_epi8(High, Match)) << 16));
+    return Result;
+}
+
+// NOTE(alex): The last chunk is copied out and padded with zeroes, which
+// only adds zero bytes past the end, and those end everything anyway.
+inline void LoadChunk(string Source, u32 ChunkStart, __m128i *Low, __m128i *High)
+{
+    u8 *At = Source.Data + ChunkStart;
+    u8 Padded[PRESCAN_CHUNK_SIZE];
+    if((Source.Count - ChunkStart) < PRESCAN_CHUNK_SIZE)
+    {
+        ZeroArray(PRESCAN_CHUNK_SIZE, Padded);
+        Copy(Source.Count - ChunkStart, At, Padded);
+        At = Padded;
+    }
+
+    *Low = _mm_loadu_si128((__m128i *)At);
+    *High = _mm_loadu_si128((__m128i *)(At + 16));
+}
+
+internal prescan_chunk ClassifyChunk(string Source, u32 ChunkStart)
+{
+    __m128i Low, High;
+    LoadChunk(Source, ChunkStart, &Low, &High);
+
+    u32 OpenParens = GetByteMask(Low, High, '(');
+    u32 OpenBraces = GetByteMask(Low, High, '{');
+    u32 CloseBraces = GetByteMask(Low, High, '}');
+    u32 Quotes = GetByteMask(Low, High, '"');
+    u32 Zeroes = GetByteMask(Low, High, 0);
+
+    prescan_chunk Result;
+    Result.Opening = OpenParens | OpenBraces;
+    Result.Braces = OpenBraces | CloseBraces;
+    Result.Brackets = Result.Opening | CloseBraces | GetByteMask(Low, High, ')');
+
+    Result.Interesting[Prescan_Code] = Quotes | GetByteMask(Low, High, '/') | Zeroes;
+    Result.Interesting[Prescan_String] = Quotes | GetByteMask(Low, High, '\\') | Zeroes;
+    Result.Interesting[Prescan_LineComment] = (GetByteMask(Low, High, '\n') | GetByteMask(Low, High, '\r') |
+                                               Zeroes);
+    Result.Interesting[Prescan_BlockComment] = GetByteMask(Low, High, '*') | Zeroes;
+
+    return Result;
+}
+
+inline u8 PeekSource(string Source, u32 Offset)
+{
+    u8 Result = (Offset < Source.Count) ? Source.Data[Offset] : 0;
+    return Result;
+}
+
+internal void BuildStructuralIndex(memory_arena *Arena, string Source, structural_index *Index)
+{
+    TIMED_FUNCTION();
+
+    ZeroStruct(*Index);
+    Index->Source = Source;
+
+    u32 SourceCount = (u32)Source.Count;
+
+    // NOTE(alex): The brackets in strings and comments count too, so this is
+    // enough room for all of them.
+    u32 MaxCount = 0;
+    u32 MaxParenCount = 0;
+    u32 MaxBraceCount = 0;
+    for(u32 ChunkStart = 0; ChunkStart < SourceCount; ChunkStart += PRESCAN_CHUNK_SIZE)
+    {
+        __m128i Low, High;
+        LoadChunk(Source, ChunkStart, &Low, &High);
+        MaxParenCount += CountSetBits(GetByteMask(Low, High, '('));
+        MaxBraceCount += CountSetBits(GetByteMask(Low, High, '{'));
+        MaxCount += CountSetBits(GetByteMask(Low, High, '(') | GetByteMask(Low, High, ')') |
+                                 GetByteMask(Low, High, '{') | GetByteMask(Low, High, '}') |
+                                 GetByteMask(Low, High, 0));
+    }
+
+    u32 *Offsets = PushArray(Arena, MaxCount, u32, NoClear());
+    u32 *Matches = PushArray(Arena, MaxCount, u32, NoClear());
+
+    // NOTE(alex): The ( and the { are matched separately, the same as
+    // skipping token by token only counts the kind it started on. These
+    // are what's still open of each, with room for one more than can ever
+    // be open, see below.
+    temporary_memory TempMem = BeginTemporaryMemory(Arena);
+    u32 *OpenParens = PushArray(Arena, MaxParenCount + 1, u32, NoClear());
+    u32 *OpenBraces = PushArray(Arena, MaxBraceCount + 1, u32, NoClear());
+    u32 OpenParenCount = 0;
+    u32 OpenBraceCount = 0;
+
+    prescan_state State = Prescan_Code;
+    u32 Count = 0;
+
+    // NOTE(alex): Everything before this has been dealt with, which can be
+    // a byte or two into the next chunk.
+    u32 Resume = 0;
+    for(u32 ChunkStart = 0; ChunkStart < SourceCount; ChunkStart += PRESCAN_CHUNK_SIZE)
+    {
+        prescan_chunk Chunk = ClassifyChunk(Source, ChunkStart);
+        for(;;)
+        {
+            u32 Pending = 0xFFFFFFFF;
+            if(Resume > ChunkStart)
+            {
+                u32 Skip = Resume - ChunkStart;
+                Pending = (Skip < PRESCAN_CHUNK_SIZE) ? ~((1u << Skip) - 1) : 0;
+            }
+
+            u32 Mask = Chunk.Interesting[State] & Pending;
+            if(State == Prescan_Code)
+            {
+                u32 Before = Mask ? ((Mask & (0 - Mask)) - 1) : 0xFFFFFFFF;
+                u32 Brackets = Chunk.Brackets & Pending & Before;
+                while(Brackets)
+                {
+                    u32 Bit = FindLeastSignificantSetBit(Brackets);
+                    Brackets &= Brackets - 1;
+
+                    // NOTE(alex): Which of ( ) { } it is changes all the
+                    // time, so there's nothing here worth branching on. A
+                    // close with nothing open writes past the top of the
+                    // stack, and then ends up marking itself unmatched.
+                    u32 IsOpening = (Chunk.Opening >> Bit) & 1;
+                    u32 IsBrace = (Chunk.Braces >> Bit) & 1;
+                    u32 *Open = IsBrace ? OpenBraces : OpenParens;
+                    u32 OpenCount = IsBrace ? OpenBraceCount : OpenParenCount;
+                    u32 HasOpen = (OpenCount != 0);
+                    u32 Closes = HasOpen & (IsOpening ^ 1);
+
+                    Open[OpenCount] = Count;
+                    u32 Top = Open[OpenCount - HasOpen];
+
+                    Offsets[Count] = ChunkStart + Bit;
+                    Matches[Count] = STRUCTURAL_UNMATCHED;
+                    Matches[Closes ? Top : Count] = Closes ? Count : STRUCTURAL_UNMATCHED;
+
+                    OpenCount = OpenCount + IsOpening - Closes;
+                    OpenBraceCount = IsBrace ? OpenCount : OpenBraceCount;
+                    OpenParenCount = IsBrace ? OpenParenCount : OpenCount;
+                    ++Count;
+                }
+            }
+
+            if(!Mask)
+            {
+                break;
+            }
+
+            u32 Offset = ChunkStart + FindLeastSignificantSetBit(Mask);
+            u8 C = PeekSource(Source, Offset);
+            Resume = Offset + 1;
+
+            if(Offset >= SourceCount)
+            {
+                // NOTE(alex): The padding after the last chunk
+                break;
+            }
+            else if(C == 0)
+            {
+                for(u32 OpenIndex = 0; OpenIndex < OpenParenCount; ++OpenIndex)
+                {
+                    Matches[OpenParens[OpenIndex]] = Count;
+                }
+                for(u32 OpenIndex = 0; OpenIndex < OpenBraceCount; ++OpenIndex)
+                {
+                    Matches[OpenBraces[OpenIndex]] = Count;
+                }
+                OpenParenCount = 0;
+                OpenBraceCount = 0;
+
+                Offsets[Count] = Offset;
+                Matches[Count] = STRUCTURAL_UNMATCHED;
+                ++Count;
+
+                State = Prescan_Code;
+                continue;
+            }
+
+            switch(State)
+            {
+                case Prescan_Code:
+                {
+                    if(C == '"')
+                    {
+                        State = Prescan_String;
+                    }
+                    else
+                    {
+                        u8 Next = PeekSource(Source, Offset + 1);
+                        if(Next == '/')
+                        {
+                            State = Prescan_LineComment;
+                            Resume = Offset + 2;
+                        }
+                        else if(Next == '*')
+                        {
+                            State = Prescan_BlockComment;
+                            Resume = Offset + 2;
+                        }
+                    }
+                } break;
+
+                case Prescan_String:
+                {
+                    if(C == '"')
+                    {
+                        State = Prescan_Code;
+                    }
+                    else if(PeekSource(Source, Offset + 1))
+                    {
+                        // NOTE(alex): A backslash, and what it escapes
+                        Resume = Offset + 2;
+                    }
+                } break;
+
+                case Prescan_LineComment:
+                {
+                    State = Prescan_Code;
+                } break;
+
+                case Prescan_BlockComment:
+                {
+                    if(PeekSource(Source, Offset + 1) == '/')
+                    {
+                        State = Prescan_Code;
+                        Resume = Offset + 2;
+                    }
+                } break;
+
+                InvalidDefaultCase;
+            }
+        }
+    }
+
+    Index->Count = Count;
+    Index->Offsets = Offsets;
+    Index->Matches = Matches;
+
+    EndTemporaryMemory(TempMem);
+}
+
+// NOTE(alex): Moves the tokenizer on to Target, counting the lines on the
+// way exactly like the tokenizer would have: \r\n and \n\r are one end of
+// line, anything else with \r or \n in it is one each.
+internal void AdvanceTokenizerTo(tokenizer *Tokenizer, u8 *Target)
+{
+    string Input = Tokenizer->Input;
+    u8 *LineStart = 0;
+
+    u32 SourceCount = (u32)(Target - Input.Data);
+    for(u32 ChunkStart = 0; ChunkStart < SourceCount; ChunkStart += PRESCAN_CHUNK_SIZE)
+    {
+        __m128i Low, High;
+        LoadChunk(BundleString(SourceCount, (char *)Input.Data), ChunkStart, &Low, &High);
+
+        u32 Mask = GetByteMask(Low, High, '\n') | GetByteMask(Low, High, '\r');
+        while(Mask)
+        {
+            u32 Offset = ChunkStart + FindLeastSignificantSetBit(Mask);
+            Mask &= Mask - 1;
+
+            u8 *At = Input.Data + Offset;
+            if(At < LineStart)
+            {
+                // NOTE(alex): The second half of a pair
+                continue;
+            }
+
+            LineStart = At + 1;
+            if((LineStart < Target) &&
+               (((At[0] == '\r') && (At[1] == '\n')) ||
+                ((At[0] == '\n') && (At[1] == '\r'))))
+            {
+                ++LineStart;
+            }
+
+            ++Tokenizer->LineNumber;
+        }
+    }
+
+    if(LineStart)
+    {
+        Tokenizer->ColumnNumber = 1 + (s32)(Target - LineStart);
+    }
+    else
+    {
+        Tokenizer->ColumnNumber += (s32)(Target - Input.Data);
+    }
+
+    Advance(&Tokenizer->Input, Target - Input.Data);
+    Refill(Tokenizer);
+}
+
+// NOTE(alex): Has to be called right after the opening ( or { was taken,
+// and returns the same as skipping it token by token would.
+internal b32 SkipBalancedBlock(tokenizer *Tokenizer, structural_index *Index)
+{
+    b32 Result = false;
+
+    u32 OpenOffset = (u32)(Tokenizer->Input.Data - Index->Source.Data) - 1;
+    while((Index->Cursor < Index->Count) &&
+          (Index->Offsets[Index->Cursor] < OpenOffset))
+    {
+        ++Index->Cursor;
+    }
+
+    if((Index->Cursor < Index->Count) &&
+       (Index->Offsets[Index->Cursor] == OpenOffset))
+    {
+        u32 Match = Index->Matches[Index->Cursor];
+
+        if(Match == STRUCTURAL_UNMATCHED)
+        {
+            AdvanceTokenizerTo(Tokenizer, Index->Source.Data + Index->Source.Count);
+            Index->Cursor = Index->Count;
+
+            // NOTE(alex): Taking the end of the stream counts as a column
+            ++Tokenizer->ColumnNumber;
+        }
+        else
+        {
+            // NOTE(alex): Skipped up to a zero byte, the block isn't closed,
+            // but the tokenizer does go on after it.
+            u32 CloseOffset = Index->Offsets[Match];
+            Result = (Index->Source.Data[CloseOffset] != 0);
+            AdvanceTokenizerTo(Tokenizer, Index->Source.Data + CloseOffset + 1);
+            Index->Cursor = Match + 1;
+        }
+    }
+    else
+    {
+        // NOTE(alex): Only if the prescan and the tokenizer disagreed on
+        // where the block starts, which they shouldn't.
+        token_type OpenType = (Index->Source.Data[OpenOffset] == '(') ? Token_OpenParen : Token_OpenBrace;
+        token_type CloseType = (OpenType == Token_OpenParen) ? Token_CloseParen : Token_CloseBrace;
+        Result = SkipBalancedBlock(Tokenizer, OpenType, CloseType);
+    }
+
+    return Result;
+}
@@ -0,0 +1,53 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): The top level pass only wants to know where the routines are,
+   but skipping a body token by token tokenizes all of it, just to throw the
+   tokens away again (the body gets tokenized for real once it's parsed).
+
+   So before the pass starts, the whole file gets prescanned, the way
+   simdjson's first stage does it: 32 bytes at a time, with SSE2 compares
+   making one bit mask per kind of character. What comes out is every ( ) { }
+   that isn't in a string or a comment, and for each opening one, which one
+   closes it. Skipping a block is then a lookup, plus counting the lines
+   it had, so the tokenizer comes out with the same line and column it would
+   have had.
+
+   It has to agree with the tokenizer on what's a string and a comment, so
+   it follows the same rules: a backslash in a string skips the character
+   after it, // ends at the end of the line, slash-star at the first
+   star-slash after it, and a zero byte ends all of them. The tokenizer takes
+   a zero byte as the end of the stream, but a block skipped up to one picks
+   up after it again, so one of those ends every block still open, and
+   everything starts over after it.
+*/
+
+#define STRUCTURAL_UNMATCHED 0xFFFFFFFF
+
+struct structural_index
+{
+    string Source;
+
+    // NOTE(alex): Where every ( ) { } and zero byte outside of strings and
+    // comments is, and for each ( and {, the index of what ends it: the
+    // matching ) or }, a zero byte, or STRUCTURAL_UNMATCHED when the file
+    // ends first.
+    u32 Count;
+    u32 *Offsets;
+    u32 *Matches;
+
+    // NOTE(alex): Blocks get skipped in order, so this is never far behind
+    u32 Cursor;
+};
+
+internal void BuildStructuralIndex(memory_arena *Arena, string Source, structural_index *Index);
+internal b32 SkipBalancedBlock(tokenizer *Tokenizer, structural_index *Index);
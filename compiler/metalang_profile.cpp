@@ -0,0 +1,457 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+// NOTE(alex): Only good for turning cycle counts into time, over spans long
+// enough that the resolution doesn't matter.
+inline u64 GetWallClockMicroseconds(void)
+{
+    timespec Time;
+    timespec_get(&Time, TIME_UTC);
+
+    u64 Result = (u64)Time.tv_sec*1000000 + (u64)(Time.tv_nsec / 1000);
+    return Result;
+}
+
+#if METALANG_PROFILE
+
+global profile_state GlobalProfile;
+global thread_local_var profile_thread *GlobalProfileThread;
+
+internal void BeginProfile(b32 RecordEvents)
+{
+    profile_state *State = &GlobalProfile;
+    State->RecordEvents = RecordEvents;
+    State->StartCycles = __rdtsc();
+    State->StartMicroseconds = GetWallClockMicroseconds();
+
+    // NOTE(alex): This happens before any of the work gets queued, so the
+    // other threads can't see it half done.
+    State->Enabled = true;
+}
+
+internal profile_thread *GetProfileThread(void)
+{
+    profile_thread *Thread = GlobalProfileThread;
+    if(!Thread)
+    {
+        profile_state *State = &GlobalProfile;
+
+        Thread = BootstrapPushStruct(profile_thread, Arena);
+        Thread->Current = &Thread->Root;
+        Thread->Root.Name = "Total";
+        if(State->RecordEvents)
+        {
+            Thread->Events = PushArray(&Thread->Arena, PROFILE_MAX_EVENT_COUNT, profile_event, NoClear());
+        }
+
+        BeginTicketMutex(&State->Mutex);
+        Thread->ThreadIndex = State->ThreadCount++;
+        Thread->Next = State->FirstThread;
+        State->FirstThread = Thread;
+        EndTicketMutex(&State->Mutex);
+
+        GlobalProfileThread = Thread;
+    }
+
+    return Thread;
+}
+
+inline void RecordProfileEvent(profile_thread *Thread, char *Name, u64 Cycles, profile_event_type Type)
+{
+    profile_event *Event = Thread->Events + Thread->EventCount++;
+    Event->Name = Name;
+    Event->Cycles = Cycles;
+    Event->Type = Type;
+}
+
+timed_block::timed_block(char *Name)
+{
+    Node = 0;
+    RecordedBegin = false;
+
+    if(GlobalProfile.Enabled)
+    {
+        profile_thread *Thread = GetProfileThread();
+
+        b32 Recursive = false;
+        for(profile_node *Open = Thread->Current; Open; Open = Open->Parent)
+        {
+            if(Open->Name == Name)
+            {
+                ++Open->HitCount;
+                Recursive = true;
+                break;
+            }
+        }
+
+        if(!Recursive)
+        {
+            profile_node *Parent = Thread->Current;
+
+            for(Node = Parent->FirstChild; Node; Node = Node->NextSibling)
+            {
+                if(Node->Name == Name)
+                {
+                    break;
+                }
+            }
+
+            if(!Node)
+            {
+                Node = PushStruct(&Thread->Arena, profile_node);
+                Node->Name = Name;
+                Node->Parent = Parent;
+                Node->NextSibling = Parent->FirstChild;
+                Parent->FirstChild = Node;
+            }
+
+            ++Node->HitCount;
+            Thread->Current = Node;
+
+            StartCycles = __rdtsc();
+
+            if(Thread->Events &&
+               ((Thread->EventCount + Thread->OpenEventCount + 2) <= PROFILE_MAX_EVENT_COUNT))
+            {
+                RecordProfileEvent(Thread, Name, StartCycles, ProfileEvent_Begin);
+                ++Thread->OpenEventCount;
+                RecordedBegin = true;
+            }
+            else if(Thread->Events)
+            {
+                Thread->DroppedEvents = true;
+            }
+        }
+    }
+}
+
+timed_block::~timed_block()
+{
+    if(Node)
+    {
+        u64 EndCycles = __rdtsc();
+
+        profile_thread *Thread = GlobalProfileThread;
+        Node->TotalCycles += EndCycles - StartCycles;
+        Thread->Current = Node->Parent;
+
+        if(RecordedBegin)
+        {
+            RecordProfileEvent(Thread, Node->Name, EndCycles, ProfileEvent_End);
+            --Thread->OpenEventCount;
+        }
+    }
+}
+
+timed_routine::timed_routine(string NameInit)
+{
+    Name = NameInit;
+    StartCycles = GlobalProfile.Enabled ? __rdtsc() : 0;
+}
+
+timed_routine::~timed_routine()
+{
+    if(StartCycles)
+    {
+        u64 Cycles = __rdtsc() - StartCycles;
+
+        profile_thread *Thread = GetProfileThread();
+
+        u32 HashValue = StringHashOf(Name);
+        u32 HashIndex = HashValue & (ArrayCount(Thread->RoutineHash) - 1);
+
+        profile_routine *Routine = 0;
+        for(profile_routine *Search = Thread->RoutineHash[HashIndex]; Search; Search = Search->NextInHash)
+        {
+            if((Search->HashValue == HashValue) && StringsAreEqual(Search->Name, Name))
+            {
+                Routine = Search;
+                break;
+            }
+        }
+
+        if(!Routine)
+        {
+            // NOTE(alex): The name points into the file, which doesn't live
+            // until the report.
+            Routine = PushStruct(&Thread->Arena, profile_routine);
+            Routine->Name.Count = Name.Count;
+            Routine->Name.Data = (u8 *)PushCopy(&Thread->Arena, Name.Count, Name.Data, NoClear());
+            Routine->HashValue = HashValue;
+            Routine->NextInHash = Thread->RoutineHash[HashIndex];
+            Thread->RoutineHash[HashIndex] = Routine;
+        }
+
+        ++Routine->HitCount;
+        Routine->TotalCycles += Cycles;
+    }
+}
+
+//
+// NOTE(alex): Reporting. This all happens once the work is done, on the
+// main thread.
+//
+
+internal void MergeProfileNode(memory_arena *Arena, profile_node *Dest, profile_node *Source)
+{
+    Dest->HitCount += Source->HitCount;
+    Dest->TotalCycles += Source->TotalCycles;
+
+    for(profile_node *SourceChild = Source->FirstChild; SourceChild; SourceChild = SourceChild->NextSibling)
+    {
+        profile_node *DestChild = Dest->FirstChild;
+        while(DestChild && !StringsAreEqual(DestChild->Name, SourceChild->Name))
+        {
+            DestChild = DestChild->NextSibling;
+        }
+
+        if(!DestChild)
+        {
+            DestChild = PushStruct(Arena, profile_node);
+            DestChild->Name = SourceChild->Name;
+            DestChild->Parent = Dest;
+            DestChild->NextSibling = Dest->FirstChild;
+            Dest->FirstChild = DestChild;
+        }
+
+        MergeProfileNode(Arena, DestChild, SourceChild);
+    }
+}
+
+internal void OutputProfileNode(memory_arena *Arena, stream *Out, profile_node *Node,
+                                u64 TotalCycles, u32 Depth)
+{
+    u64 ChildCycles = 0;
+    u32 ChildCount = 0;
+    for(profile_node *Child = Node->FirstChild; Child; Child = Child->NextSibling)
+    {
+        ChildCycles += Child->TotalCycles;
+        ++ChildCount;
+    }
+
+    u64 SelfCycles = (Node->TotalCycles > ChildCycles) ? (Node->TotalCycles - ChildCycles) : 0;
+    f64 Percent = TotalCycles ? (100.0*(f64)Node->TotalCycles / (f64)TotalCycles) : 0.0;
+    Outf(Out, "%12llu %12llu %10llu %6.2f%%  ",
+         Node->TotalCycles / 1000, SelfCycles / 1000, Node->HitCount, Percent);
+
+    // NOTE(alex): Outf doesn't pad empty strings, so no %*s for this
+    for(u32 Indent = 0; Indent < Depth; ++Indent)
+    {
+        Outf(Out, "  ");
+    }
+    Outf(Out, "%s\n", Node->Name);
+
+    //
+    // NOTE(alex): Children go from most to fewest cycles
+    //
+
+    temporary_memory TempMem = BeginTemporaryMemory(Arena);
+
+    profile_node **Children = PushArray(Arena, ChildCount, profile_node *, NoClear());
+    u32 ChildIndex = 0;
+    for(profile_node *Child = Node->FirstChild; Child; Child = Child->NextSibling)
+    {
+        Children[ChildIndex++] = Child;
+    }
+
+    for(u32 Outer = 1; Outer < ChildCount; ++Outer)
+    {
+        for(u32 Inner = Outer; (Inner > 0) && (Children[Inner - 1]->TotalCycles < Children[Inner]->TotalCycles); --Inner)
+        {
+            Swap(profile_node *, Children[Inner - 1], Children[Inner]);
+        }
+    }
+
+    for(ChildIndex = 0; ChildIndex < ChildCount; ++ChildIndex)
+    {
+        OutputProfileNode(Arena, Out, Children[ChildIndex], TotalCycles, Depth + 1);
+    }
+
+    EndTemporaryMemory(TempMem);
+}
+
+// NOTE(alex): How many of the slowest routines get listed
+#define PROFILE_ROUTINE_REPORT_COUNT 16
+
+internal void OutputProfile(stream *Out)
+{
+    profile_state *State = &GlobalProfile;
+    State->Enabled = false;
+
+    memory_arena Arena = {};
+
+    profile_node Root = {};
+    Root.Name = "Total";
+    for(profile_thread *Thread = State->FirstThread; Thread; Thread = Thread->Next)
+    {
+        // NOTE(alex): The root itself is never timed, it's just what the
+        // outermost blocks of each thread hang off of.
+        for(profile_node *Child = Thread->Root.FirstChild; Child; Child = Child->NextSibling)
+        {
+            Thread->Root.TotalCycles += Child->TotalCycles;
+        }
+        Thread->Root.HitCount = 1;
+
+        MergeProfileNode(&Arena, &Root, &Thread->Root);
+    }
+
+    Outf(Out, "--- Profile: %llu kcycles on %u threads ---\n", Root.TotalCycles / 1000, State->ThreadCount);
+    Outf(Out, "%12s %12s %10s %7s  %s\n", "kcycles", "self", "hits", "", "block");
+    OutputProfileNode(&Arena, Out, &Root, Root.TotalCycles, 0);
+
+    //
+    // NOTE(alex): Routines with the same name in different files are the
+    // same as far as this is concerned.
+    //
+
+    u32 RoutineCount = 0;
+    for(profile_thread *Thread = State->FirstThread; Thread; Thread = Thread->Next)
+    {
+        for(u32 HashIndex = 0; HashIndex < ArrayCount(Thread->RoutineHash); ++HashIndex)
+        {
+            for(profile_routine *Routine = Thread->RoutineHash[HashIndex]; Routine; Routine = Routine->NextInHash)
+            {
+                ++RoutineCount;
+            }
+        }
+    }
+
+    if(RoutineCount)
+    {
+        profile_routine **Routines = PushArray(&Arena, RoutineCount, profile_routine *);
+        u32 UniqueCount = 0;
+        for(profile_thread *Thread = State->FirstThread; Thread; Thread = Thread->Next)
+        {
+            for(u32 HashIndex = 0; HashIndex < ArrayCount(Thread->RoutineHash); ++HashIndex)
+            {
+                for(profile_routine *Routine = Thread->RoutineHash[HashIndex]; Routine; Routine = Routine->NextInHash)
+                {
+                    profile_routine *Merged = 0;
+                    if(Thread != State->FirstThread)
+                    {
+                        for(u32 Index = 0; Index < UniqueCount; ++Index)
+                        {
+                            if((Routines[Index]->HashValue == Routine->HashValue) &&
+                               StringsAreEqual(Routines[Index]->Name, Routine->Name))
+                            {
+                                Merged = Routines[Index];
+                                break;
+                            }
+                        }
+                    }
+
+                    if(Merged)
+                    {
+                        Merged->HitCount += Routine->HitCount;
+                        Merged->TotalCycles += Routine->TotalCycles;
+                    }
+                    else
+                    {
+                        Routines[UniqueCount++] = Routine;
+                    }
+                }
+            }
+        }
+
+        u32 ReportCount = Minimum(UniqueCount, PROFILE_ROUTINE_REPORT_COUNT);
+        for(u32 Outer = 0; Outer < ReportCount; ++Outer)
+        {
+            for(u32 Inner = Outer + 1; Inner < UniqueCount; ++Inner)
+            {
+                if(Routines[Inner]->TotalCycles > Routines[Outer]->TotalCycles)
+                {
+                    Swap(profile_routine *, Routines[Inner], Routines[Outer]);
+                }
+            }
+        }
+
+        Outf(Out, "--- Slowest %u of %u routines ---\n", ReportCount, UniqueCount);
+        Outf(Out, "%12s %10s  %s\n", "kcycles", "compiles", "routine");
+        for(u32 Index = 0; Index < ReportCount; ++Index)
+        {
+            profile_routine *Routine = Routines[Index];
+            Outf(Out, "%12llu %10llu  %.*s\n", Routine->TotalCycles / 1000, Routine->HitCount,
+                 ExpandString(Routine->Name));
+        }
+    }
+
+    Clear(&Arena);
+}
+
+/* NOTE(alex): The Chrome trace event format, which chrome://tracing and
+   Perfetto both load. Each thread's blocks nest properly, so they're just
+   written as begin and end pairs.
+*/
+internal b32 WriteProfileTrace(char *FileName)
+{
+    b32 Result = false;
+
+    profile_state *State = &GlobalProfile;
+
+    u64 ElapsedCycles = __rdtsc() - State->StartCycles;
+    u64 ElapsedMicroseconds = GetWallClockMicroseconds() - State->StartMicroseconds;
+    f64 MicrosecondsPerCycle = ElapsedCycles ? ((f64)ElapsedMicroseconds / (f64)ElapsedCycles) : 0.0;
+
+    FILE *File = fopen(FileName, "wb");
+    if(File)
+    {
+        stream Out = OnFile(File);
+        Outf(&Out, "{\"traceEvents\":[\n");
+
+        b32 First = true;
+        for(profile_thread *Thread = State->FirstThread; Thread; Thread = Thread->Next)
+        {
+            for(u32 EventIndex = 0; EventIndex < Thread->EventCount; ++EventIndex)
+            {
+                profile_event *Event = Thread->Events + EventIndex;
+                f64 Timestamp = (f64)(Event->Cycles - State->StartCycles)*MicrosecondsPerCycle;
+
+                Outf(&Out, "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.3f,\"pid\":1,\"tid\":%u}",
+                     First ? "" : ",\n", Event->Name,
+                     (Event->Type == ProfileEvent_Begin) ? "B" : "E",
+                     Timestamp, Thread->ThreadIndex);
+                First = false;
+            }
+
+            if(Thread->DroppedEvents)
+            {
+                fprintf(stderr, "Warning: Thread %u had more than %u blocks, the trace is missing the rest\n",
+                        Thread->ThreadIndex, PROFILE_MAX_EVENT_COUNT);
+            }
+        }
+
+        Outf(&Out, "\n]}\n");
+        fclose(File);
+
+        Result = true;
+    }
+
+    return Result;
+}
+
+#else
+
+internal void BeginProfile(b32 RecordEvents)
+{
+}
+
+internal void OutputProfile(stream *Out)
+{
+    Outf(Out, "--- Profiling was compiled out, build with METALANG_PROFILE=1 for -time ---\n");
+}
+
+internal b32 WriteProfileTrace(char *FileName)
+{
+    return false;
+}
+
+#endif
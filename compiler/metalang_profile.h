@@ -0,0 +1,144 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): TIMED_FUNCTION and TIMED_BLOCK measure the cycles spent in a
+   scope, and TIMED_ROUTINE additionally charges them to the routine being
+   compiled. With METALANG_PROFILE off they compile to nothing, and with it
+   on they cost a branch until -time actually turns the profiler on.
+
+   Every thread adds to a tree of its own, where a block's node is a child
+   of the node of whatever block it started in, so nothing is shared while
+   compiling. A block that starts while it's already open further up (a
+   recursive call) is counted as a hit, but its cycles stay with the
+   outermost one. The trees get merged by name for the report.
+*/
+
+#if !defined(METALANG_PROFILE)
+#define METALANG_PROFILE 0
+#endif
+
+#if METALANG_PROFILE
+
+#if COMPILER_MSVC
+#define thread_local_var __declspec(thread)
+#else
+#define thread_local_var __thread
+#endif
+
+// NOTE(alex): Only recorded for -time-trace. Past this many per thread,
+// blocks just stop showing up in the trace, the report still has them.
+#define PROFILE_MAX_EVENT_COUNT (1 << 20)
+
+struct profile_node
+{
+    char *Name;
+    u64 HitCount;
+    u64 TotalCycles;
+
+    profile_node *Parent;
+    profile_node *FirstChild;
+    profile_node *NextSibling;
+};
+
+struct profile_routine
+{
+    string Name;
+    u32 HashValue;
+    u64 HitCount;
+    u64 TotalCycles;
+
+    profile_routine *NextInHash;
+};
+
+enum profile_event_type
+{
+    ProfileEvent_Begin,
+    ProfileEvent_End,
+};
+
+struct profile_event
+{
+    char *Name;
+    u64 Cycles;
+    u32 Type;
+};
+
+struct profile_thread
+{
+    memory_arena Arena;
+    u32 ThreadIndex;
+
+    profile_node Root;
+    profile_node *Current;
+
+    profile_routine *RoutineHash[256];
+
+    // NOTE(alex): A begin is only recorded if there's still room for the
+    // ends of every block that's open, so the trace always matches up.
+    u32 EventCount;
+    u32 OpenEventCount;
+    profile_event *Events;
+    b32 DroppedEvents;
+
+    profile_thread *Next;
+};
+
+struct profile_state
+{
+    b32 Enabled;
+    b32 RecordEvents;
+
+    ticket_mutex Mutex;
+    u32 ThreadCount;
+    profile_thread *FirstThread;
+
+    // NOTE(alex): For turning cycles into time, which the trace needs
+    u64 StartCycles;
+    u64 StartMicroseconds;
+};
+
+struct timed_block
+{
+    profile_node *Node;
+    u64 StartCycles;
+    b32 RecordedBegin;
+
+    timed_block(char *Name);
+    ~timed_block();
+};
+
+struct timed_routine
+{
+    string Name;
+    u64 StartCycles;
+
+    timed_routine(string Name);
+    ~timed_routine();
+};
+
+#define TIMED_BLOCK__(Name, Number) timed_block TimedBlock_##Number((char *)(Name))
+#define TIMED_BLOCK_(Name, Number) TIMED_BLOCK__(Name, Number)
+#define TIMED_BLOCK(Name) TIMED_BLOCK_(Name, __LINE__)
+#define TIMED_FUNCTION() TIMED_BLOCK_(__FUNCTION__, __LINE__)
+#define TIMED_ROUTINE(Name) timed_routine TimedRoutine_(Name)
+
+#else
+
+#define TIMED_BLOCK(...)
+#define TIMED_FUNCTION(...)
+#define TIMED_ROUTINE(...)
+
+#endif
+
+internal void BeginProfile(b32 RecordEvents);
+internal void OutputProfile(stream *Out);
+internal b32 WriteProfileTrace(char *FileName);
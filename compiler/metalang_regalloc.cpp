@@ -0,0 +1,543 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): This is the linear scan allocator from Poletto & Sarkar, with
+   one interval per value. Liveness is computed over the scheduled blocks, so
+   a value that is live out of a block has its interval stretched to the end
+   of that block, which is all we need to stay correct once loops show up.
+
+   Positions: every block gets a start position, then two positions per
+   instruction (uses happen on the even one, the definition on the odd one),
+   and then an end position where the phi copies for its successor happen.
+   Phis are defined on the start position of their block.
+*/
+
+inline b32 LocationsAreEqual(value_location A, value_location B)
+{
+    b32 Result = ((A.Type == B.Type) &&
+                  (A.Index == B.Index) &&
+                  (A.Value == B.Value));
+
+    return Result;
+}
+
+inline value_location RegisterLocation(u32 Register)
+{
+    value_location Result = {};
+    Result.Type = Location_Register;
+    Result.Index = (u16)Register;
+
+    return Result;
+}
+
+internal value_location GetLocation(register_allocation *Allocation, node *Node)
+{
+    value_location Result = {};
+
+    if(IsConstant(Node))
+    {
+        Assert(IsConstantInteger(Node->DataType));
+        Result.Type = Location_Constant;
+        Result.Value = Node->DataType.Value;
+    }
+    else
+    {
+        u32 IntervalIndex = Allocation->IntervalOf[Node->ID];
+        Assert(IntervalIndex);
+        Result = Allocation->Intervals[IntervalIndex - 1].Location;
+    }
+
+    return Result;
+}
+
+inline live_interval *GetInterval(register_allocation *Allocation, node *Node)
+{
+    live_interval *Result = 0;
+
+    if(!IsConstant(Node))
+    {
+        u32 IntervalIndex = Allocation->IntervalOf[Node->ID];
+        Assert(IntervalIndex);
+        Result = Allocation->Intervals + (IntervalIndex - 1);
+    }
+
+    return Result;
+}
+
+inline void SetLive(u64 *Set, live_interval *Interval, live_interval *Base)
+{
+    if(Interval)
+    {
+        u32 Index = (u32)(Interval - Base);
+        Set[Index / 64] |= ((u64)1 << (Index % 64));
+    }
+}
+
+inline void ClearLive(u64 *Set, live_interval *Interval, live_interval *Base)
+{
+    if(Interval)
+    {
+        u32 Index = (u32)(Interval - Base);
+        Set[Index / 64] &= ~((u64)1 << (Index % 64));
+    }
+}
+
+inline u32 GetPredecessorIndex(basic_block *Block, basic_block *Predecessor)
+{
+    u32 Result = 0;
+    while(Block->Predecessors[Result] != Predecessor)
+    {
+        ++Result;
+        Assert(Result < Block->PredecessorCount);
+    }
+
+    return Result;
+}
+
+internal move_list SequentializeMoves(memory_arena *Arena, u32 Count, parallel_move *Pending, u32 ScratchRegister)
+{
+    // NOTE(alex): Every cycle we break costs one extra move, so there can't
+    // be more than twice as many moves as we started with.
+    move_list Result = {};
+    Result.Moves = PushArray(Arena, 2*Count, parallel_move, NoClear());
+
+    value_location Scratch = RegisterLocation(ScratchRegister);
+
+    u32 PendingCount = 0;
+    for(u32 MoveIndex = 0; MoveIndex < Count; ++MoveIndex)
+    {
+        if(!LocationsAreEqual(Pending[MoveIndex].Dest, Pending[MoveIndex].Source))
+        {
+            Pending[PendingCount++] = Pending[MoveIndex];
+        }
+    }
+
+    while(PendingCount)
+    {
+        b32 Emitted = false;
+        for(u32 MoveIndex = 0; MoveIndex < PendingCount; ++MoveIndex)
+        {
+            b32 DestIsRead = false;
+            for(u32 OtherIndex = 0; OtherIndex < PendingCount; ++OtherIndex)
+            {
+                if((OtherIndex != MoveIndex) &&
+                   LocationsAreEqual(Pending[OtherIndex].Source, Pending[MoveIndex].Dest))
+                {
+                    DestIsRead = true;
+                    break;
+                }
+            }
+
+            if(!DestIsRead)
+            {
+                Result.Moves[Result.Count++] = Pending[MoveIndex];
+                Pending[MoveIndex] = Pending[--PendingCount];
+                Emitted = true;
+                break;
+            }
+        }
+
+        if(!Emitted)
+        {
+            // NOTE(alex): Everything left is part of a cycle. Park one of the
+            // destinations in the scratch register, and read it from there.
+            value_location Parked = Pending[0].Dest;
+
+            parallel_move *Save = Result.Moves + Result.Count++;
+            Save->Dest = Scratch;
+            Save->Source = Parked;
+
+            for(u32 MoveIndex = 0; MoveIndex < PendingCount; ++MoveIndex)
+            {
+                if(LocationsAreEqual(Pending[MoveIndex].Source, Parked))
+                {
+                    Pending[MoveIndex].Source = Scratch;
+                }
+            }
+        }
+    }
+
+    Assert(Result.Count <= 2*Count);
+
+    return Result;
+}
+
+internal s32 GetRegisterHint(register_allocation *Allocation, node *Node, u8 *RegisterBusy)
+{
+    s32 Result = -1;
+
+    // NOTE(alex): x64 add, sub and imul overwrite their left operand, so if
+    // an operand dies at this instruction we'd like to just reuse its register.
+    // Add and mul can have their operands swapped, so either one will do.
+    // Phis would like to share a register with one of their inputs, since
+    // that turns the copy at the end of the predecessor into nothing.
+    u32 CandidateCount = 0;
+    switch(Node->Type)
+    {
+        case Node_Sub: {CandidateCount = 1;} break;
+
+        case Node_Add:
+        case Node_Mul:
+        case Node_Phi:
+        {
+            CandidateCount = 2;
+        } break;
+    }
+
+    for(u32 CandidateIndex = 0; CandidateIndex < CandidateCount; ++CandidateIndex)
+    {
+        live_interval *Operand = GetInterval(Allocation, Node->Operands[CandidateIndex]);
+        if(Operand &&
+           (Operand->Location.Type == Location_Register) &&
+           !RegisterBusy[Operand->Location.Index])
+        {
+            Result = Operand->Location.Index;
+            break;
+        }
+    }
+
+    return Result;
+}
+
+internal void InsertActive(live_interval **Active, u32 *ActiveCount, live_interval *Interval)
+{
+    // NOTE(alex): Active is kept sorted by increasing end position
+    u32 Index = (*ActiveCount)++;
+    while(Index && (Active[Index - 1]->End > Interval->End))
+    {
+        Active[Index] = Active[Index - 1];
+        --Index;
+    }
+
+    Active[Index] = Interval;
+}
+
+internal register_allocation *AllocateRegisters(memory_arena *Arena, schedule *Schedule, u32 RegisterCount)
+{
+    TIMED_FUNCTION();
+
+    register_allocation *Allocation = PushStruct(Arena, register_allocation);
+    Allocation->RegisterCount = RegisterCount;
+    Allocation->ScratchRegister = RegisterCount;
+
+    Allocation->IntervalOf = PushArray(Arena, Schedule->NodeCapacity, u32);
+    Allocation->Positions = PushArray(Arena, Schedule->InstructionCount, u32, NoClear());
+    Allocation->BlockStart = PushArray(Arena, Schedule->BlockCount, u32, NoClear());
+    Allocation->BlockEnd = PushArray(Arena, Schedule->BlockCount, u32, NoClear());
+    Allocation->BlockMoves = PushArray(Arena, Schedule->BlockCount, move_list);
+
+    //
+    // NOTE(alex): Number the positions and create one interval per value
+    //
+
+    for(u32 InstructionIndex = 0; InstructionIndex < Schedule->InstructionCount; ++InstructionIndex)
+    {
+        if(IsData(Schedule->Instructions[InstructionIndex]))
+        {
+            ++Allocation->ValueCount;
+        }
+    }
+
+    Allocation->Intervals = PushArray(Arena, Allocation->ValueCount, live_interval);
+
+    u32 Position = 0;
+    u32 ValueIndex = 0;
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+
+        Allocation->BlockStart[BlockIndex] = Position;
+        Position += 2;
+
+        for(u32 InstructionIndex = Block->FirstInstruction;
+            InstructionIndex < (Block->FirstInstruction + Block->InstructionCount);
+            ++InstructionIndex)
+        {
+            node *Node = Schedule->Instructions[InstructionIndex];
+            Allocation->Positions[InstructionIndex] = Position;
+
+            if(IsData(Node))
+            {
+                live_interval *Interval = Allocation->Intervals + ValueIndex++;
+                Interval->Value = Node;
+                Interval->Start = (Node->Type == Node_Phi) ? Allocation->BlockStart[BlockIndex] : (Position + 1);
+                Interval->End = Interval->Start;
+                Allocation->IntervalOf[Node->ID] = ValueIndex;
+            }
+
+            Position += 2;
+        }
+
+        Allocation->BlockEnd[BlockIndex] = Position;
+        Position += 2;
+    }
+
+    //
+    // NOTE(alex): Liveness
+    //
+
+    live_interval *Base = Allocation->Intervals;
+    u32 WordCount = (Allocation->ValueCount + 63) / 64;
+    u64 *LiveIn = PushArray(Arena, Schedule->BlockCount*WordCount, u64);
+    u64 *LiveOut = PushArray(Arena, Schedule->BlockCount*WordCount, u64);
+    u64 *Live = PushArray(Arena, WordCount, u64, NoClear());
+
+    b32 Changed = true;
+    while(Changed)
+    {
+        Changed = false;
+
+        for(u32 BlockIndex = Schedule->BlockCount; BlockIndex--;)
+        {
+            basic_block *Block = Schedule->Blocks + BlockIndex;
+
+            ZeroArray(WordCount, Live);
+            for(u32 SuccessorIndex = 0; SuccessorIndex < Block->SuccessorCount; ++SuccessorIndex)
+            {
+                basic_block *Successor = Block->Successors[SuccessorIndex];
+                u64 *SuccessorIn = LiveIn + Successor->Index*WordCount;
+                for(u32 WordIndex = 0; WordIndex < WordCount; ++WordIndex)
+                {
+                    Live[WordIndex] |= SuccessorIn[WordIndex];
+                }
+
+                u32 PredecessorIndex = GetPredecessorIndex(Successor, Block);
+                for(u32 InstructionIndex = Successor->FirstInstruction;
+                    InstructionIndex < (Successor->FirstInstruction + Successor->InstructionCount);
+                    ++InstructionIndex)
+                {
+                    node *Phi = Schedule->Instructions[InstructionIndex];
+                    if(Phi->Type != Node_Phi)
+                    {
+                        break;
+                    }
+
+                    SetLive(Live, GetInterval(Allocation, Phi->Operands[PredecessorIndex]), Base);
+                }
+            }
+
+            CopyArray(WordCount, Live, LiveOut + BlockIndex*WordCount);
+
+            for(u32 InstructionIndex = Block->FirstInstruction + Block->InstructionCount;
+                InstructionIndex-- > Block->FirstInstruction;)
+            {
+                node *Node = Schedule->Instructions[InstructionIndex];
+                if(IsData(Node))
+                {
+                    ClearLive(Live, GetInterval(Allocation, Node), Base);
+                }
+
+                if(Node->Type != Node_Phi)
+                {
+                    node *Operands[MAX_NODE_OPERAND_COUNT];
+                    u32 OperandCount = GetDataOperands(Node, Operands);
+                    for(u32 OperandIndex = 0; OperandIndex < OperandCount; ++OperandIndex)
+                    {
+                        SetLive(Live, GetInterval(Allocation, Operands[OperandIndex]), Base);
+                    }
+                }
+            }
+
+            u64 *In = LiveIn + BlockIndex*WordCount;
+            for(u32 WordIndex = 0; WordIndex < WordCount; ++WordIndex)
+            {
+                if(In[WordIndex] != Live[WordIndex])
+                {
+                    In[WordIndex] = Live[WordIndex];
+                    Changed = true;
+                }
+            }
+        }
+    }
+
+    //
+    // NOTE(alex): Stretch the intervals over their uses and live-out blocks
+    //
+
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        u32 BlockEnd = Allocation->BlockEnd[BlockIndex];
+
+        for(u32 InstructionIndex = Block->FirstInstruction;
+            InstructionIndex < (Block->FirstInstruction + Block->InstructionCount);
+            ++InstructionIndex)
+        {
+            node *Node = Schedule->Instructions[InstructionIndex];
+            if(Node->Type != Node_Phi)
+            {
+                node *Operands[MAX_NODE_OPERAND_COUNT];
+                u32 OperandCount = GetDataOperands(Node, Operands);
+                for(u32 OperandIndex = 0; OperandIndex < OperandCount; ++OperandIndex)
+                {
+                    live_interval *Interval = GetInterval(Allocation, Operands[OperandIndex]);
+                    if(Interval)
+                    {
+                        Interval->End = Maximum(Interval->End, Allocation->Positions[InstructionIndex]);
+                    }
+                }
+            }
+        }
+
+        for(u32 SuccessorIndex = 0; SuccessorIndex < Block->SuccessorCount; ++SuccessorIndex)
+        {
+            basic_block *Successor = Block->Successors[SuccessorIndex];
+            u32 PredecessorIndex = GetPredecessorIndex(Successor, Block);
+            for(u32 InstructionIndex = Successor->FirstInstruction;
+                InstructionIndex < (Successor->FirstInstruction + Successor->InstructionCount);
+                ++InstructionIndex)
+            {
+                node *Phi = Schedule->Instructions[InstructionIndex];
+                if(Phi->Type != Node_Phi)
+                {
+                    break;
+                }
+
+                live_interval *Interval = GetInterval(Allocation, Phi->Operands[PredecessorIndex]);
+                if(Interval)
+                {
+                    Interval->End = Maximum(Interval->End, BlockEnd);
+                }
+            }
+        }
+
+        u64 *Out = LiveOut + BlockIndex*WordCount;
+        for(u32 ValueIndex = 0; ValueIndex < Allocation->ValueCount; ++ValueIndex)
+        {
+            if(Out[ValueIndex / 64] & ((u64)1 << (ValueIndex % 64)))
+            {
+                live_interval *Interval = Allocation->Intervals + ValueIndex;
+                Interval->End = Maximum(Interval->End, BlockEnd + 1);
+            }
+        }
+    }
+
+    //
+    // NOTE(alex): Linear scan
+    //
+
+    // NOTE(alex): There can never be more registers in use than there are values
+    u32 UsableCount = Minimum(RegisterCount, Allocation->ValueCount);
+    u8 *RegisterBusy = PushArray(Arena, UsableCount, u8);
+    live_interval **Active = PushArray(Arena, UsableCount, live_interval *, NoClear());
+    u32 ActiveCount = 0;
+
+    for(u32 IntervalIndex = 0; IntervalIndex < Allocation->ValueCount; ++IntervalIndex)
+    {
+        live_interval *Interval = Allocation->Intervals + IntervalIndex;
+
+        u32 KeepCount = 0;
+        for(u32 ActiveIndex = 0; ActiveIndex < ActiveCount; ++ActiveIndex)
+        {
+            live_interval *Test = Active[ActiveIndex];
+            if(Test->End < Interval->Start)
+            {
+                RegisterBusy[Test->Location.Index] = false;
+            }
+            else
+            {
+                Active[KeepCount++] = Test;
+            }
+        }
+        ActiveCount = KeepCount;
+
+        if(ActiveCount == RegisterCount)
+        {
+            // NOTE(alex): Out of registers, so whichever interval lives the
+            // longest goes to the stack.
+            live_interval *Spill = Active[ActiveCount - 1];
+
+            value_location Stack = {};
+            Stack.Type = Location_Stack;
+            Stack.Index = (u16)Allocation->SpillSlotCount++;
+
+            if(Spill->End > Interval->End)
+            {
+                Interval->Location = Spill->Location;
+                Spill->Location = Stack;
+
+                --ActiveCount;
+                InsertActive(Active, &ActiveCount, Interval);
+            }
+            else
+            {
+                Interval->Location = Stack;
+            }
+
+            ++Allocation->SpillCount;
+        }
+        else
+        {
+            s32 Register = GetRegisterHint(Allocation, Interval->Value, RegisterBusy);
+            if(Register < 0)
+            {
+                Register = 0;
+                while(RegisterBusy[Register])
+                {
+                    ++Register;
+                }
+            }
+
+            RegisterBusy[Register] = true;
+            Interval->Location = RegisterLocation(Register);
+            InsertActive(Active, &ActiveCount, Interval);
+
+            if(Allocation->RegistersUsed < (u32)(Register + 1))
+            {
+                Allocation->RegistersUsed = Register + 1;
+            }
+        }
+    }
+
+    //
+    // NOTE(alex): Phi resolution
+    //
+
+    parallel_move *Pending = PushArray(Arena, Allocation->ValueCount, parallel_move, NoClear());
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        for(u32 SuccessorIndex = 0; SuccessorIndex < Block->SuccessorCount; ++SuccessorIndex)
+        {
+            basic_block *Successor = Block->Successors[SuccessorIndex];
+            u32 PredecessorIndex = GetPredecessorIndex(Successor, Block);
+
+            u32 PendingCount = 0;
+            for(u32 InstructionIndex = Successor->FirstInstruction;
+                InstructionIndex < (Successor->FirstInstruction + Successor->InstructionCount);
+                ++InstructionIndex)
+            {
+                node *Phi = Schedule->Instructions[InstructionIndex];
+                if(Phi->Type != Node_Phi)
+                {
+                    break;
+                }
+
+                parallel_move *Move = Pending + PendingCount++;
+                Move->Dest = GetLocation(Allocation, Phi);
+                Move->Source = GetLocation(Allocation, Phi->Operands[PredecessorIndex]);
+            }
+
+            if(PendingCount)
+            {
+                // NOTE(alex): There are no critical edges, every If gets two
+                // blocks of its own, so the copies can live at the end of the
+                // predecessor.
+                Assert(Block->SuccessorCount == 1);
+                Allocation->BlockMoves[BlockIndex] =
+                    SequentializeMoves(Arena, PendingCount, Pending, Allocation->ScratchRegister);
+            }
+        }
+    }
+
+    return Allocation;
+}
@@ -0,0 +1,82 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+// NOTE(alex): The native backend only hands out the callee-saved registers
+// (rbx, r12, r13, r14 and r15), so calls made for printing never clobber an
+// allocated value.
+#define X64_ALLOCATABLE_REGISTER_COUNT 5
+
+enum value_location_type
+{
+    Location_None,
+    Location_Register,
+    Location_Stack,
+    Location_Constant,
+};
+
+struct value_location
+{
+    u16 Type;
+    u16 Index; // NOTE(alex): Register index or stack slot
+    s32 Value; // NOTE(alex): Only for Location_Constant
+};
+
+struct live_interval
+{
+    node *Value;
+    u32 Start;
+    u32 End;
+
+    value_location Location;
+};
+
+struct parallel_move
+{
+    value_location Dest;
+    value_location Source;
+};
+
+struct move_list
+{
+    u32 Count;
+    parallel_move *Moves;
+};
+
+struct register_allocation
+{
+    // NOTE(alex): Registers are numbered 0 to RegisterCount - 1. The target
+    // must also reserve one extra register, which is the scratch register
+    // that phi resolution uses to break copy cycles.
+    u32 RegisterCount;
+    u32 ScratchRegister;
+
+    u32 ValueCount;
+    live_interval *Intervals;
+
+    // NOTE(alex): Indexed by node ID, holds the interval index + 1
+    u32 *IntervalOf;
+
+    u32 *Positions;
+    u32 *BlockStart;
+    u32 *BlockEnd;
+
+    u32 RegistersUsed;
+    u32 SpillSlotCount;
+    u32 SpillCount;
+
+    // NOTE(alex): Indexed by block, the already sequentialized copies to
+    // perform at the end of the block to set up the phis of its successor.
+    move_list *BlockMoves;
+};
+
+internal register_allocation *AllocateRegisters(memory_arena *Arena, schedule *Schedule, u32 RegisterCount);
+internal value_location GetLocation(register_allocation *Allocation, node *Node);
@@ -0,0 +1,641 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): The schedule turns the sea of nodes back into something a
+   backend can walk from top to bottom.
+
+   The control chain is built by the parser back-to-front (every control node
+   only knows its predecessor), so we start at the End node and walk towards
+   the Start node. Every Region pulls in the If that split the control flow,
+   and then the two branch chains that end in it. Since the language only
+   has structured control flow at the moment, this gives us the blocks in
+   an order where every block comes after its dominator.
+
+   Data nodes float, so they're placed as early as possible ("schedule early"):
+   a node goes into the deepest block of its operands, and inside a block it
+   is emitted right before its first use.
+*/
+
+struct schedule_builder
+{
+    memory_arena *Arena;
+    schedule *Schedule;
+
+    u32 ControlCount;
+    node **ControlNodes;
+
+    u32 DataCount;
+    node **DataNodes;
+
+    u8 *Emitted;
+};
+
+internal u32 GetDataOperands(node *Node, node **Operands)
+{
+    u32 Count = 0;
+
+    switch(Node->Type)
+    {
+        case Node_Start:
+        case Node_Region:
+        case Node_Constant:
+        case Node_Proj:
+        {
+            // NOTE(alex): No data inputs. A Proj only reads its tuple, which
+            // is always a control node.
+        } break;
+
+        case Node_Print:
+        case Node_If:
+        case Node_End:
+        {
+            if(Node->Control.Data)
+            {
+                Operands[Count++] = Node->Control.Data;
+            }
+        } break;
+
+        case Node_Phi:
+        {
+            Operands[Count++] = Node->Operands[0];
+            Operands[Count++] = Node->Operands[1];
+        } break;
+
+        default:
+        {
+            Assert(IsOperator(Node));
+            for(u32 OperandIndex = 0; OperandIndex < ArrayCount(Node->Operands); ++OperandIndex)
+            {
+                if(Node->Operands[OperandIndex])
+                {
+                    Operands[Count++] = Node->Operands[OperandIndex];
+                }
+            }
+        } break;
+    }
+
+    return Count;
+}
+
+internal node *GetControlPrev(node *Node)
+{
+    node *Result = 0;
+
+    switch(Node->Type)
+    {
+        case Node_Start: {} break;
+        case Node_Proj: {Result = Node->Operand;} break;
+
+        // NOTE(alex): The Prev of a Region is the If it merges
+        case Node_Region: {Result = Node->Region.Prev;} break;
+
+        default: {Result = Node->Control.Prev;} break;
+    }
+
+    return Result;
+}
+
+inline b32 IsChainHead(node *Node, node *StopIf)
+{
+    b32 Result = (StopIf ?
+                  ((Node->Type == Node_Proj) && (Node->Operand == StopIf)) :
+                  (Node->Type == Node_Start));
+
+    return Result;
+}
+
+internal node *FindChainHead(node *Tail, node *StopIf)
+{
+    node *Result = Tail;
+    while(!IsChainHead(Result, StopIf))
+    {
+        Result = GetControlPrev(Result);
+        Assert(Result);
+    }
+
+    return Result;
+}
+
+internal basic_block *NewBlock(schedule_builder *Builder, node *Head, basic_block *Dominator)
+{
+    schedule *Schedule = Builder->Schedule;
+
+    basic_block *Block = Schedule->Blocks + Schedule->BlockCount;
+    Block->Index = Schedule->BlockCount++;
+    Block->Head = Head;
+    Block->Dominator = Dominator;
+    Block->Depth = Dominator ? (Dominator->Depth + 1) : 0;
+    Block->Control = Builder->ControlNodes + Builder->ControlCount;
+
+    Schedule->BlockOf[Head->ID] = Block;
+
+    return Block;
+}
+
+internal void AddEdge(basic_block *From, basic_block *To)
+{
+    Assert(From->SuccessorCount < ArrayCount(From->Successors));
+    Assert(To->PredecessorCount < ArrayCount(To->Predecessors));
+
+    From->Successors[From->SuccessorCount++] = To;
+    To->Predecessors[To->PredecessorCount++] = From;
+}
+
+internal void AppendControl(schedule_builder *Builder, basic_block *Block, node *Node)
+{
+    // NOTE(alex): Blocks are finished in layout order, so each block's control
+    // nodes are a contiguous run of the builder's array.
+    Assert((Block->Control + Block->ControlCount) == (Builder->ControlNodes + Builder->ControlCount));
+
+    Block->Control[Block->ControlCount++] = Node;
+    ++Builder->ControlCount;
+
+    Builder->Schedule->BlockOf[Node->ID] = Block;
+}
+
+internal basic_block *ScheduleChain(schedule_builder *Builder, basic_block *Block, node *Tail, node *StopIf)
+{
+    u32 ChainCount = 0;
+    for(node *At = Tail; !IsChainHead(At, StopIf); At = GetControlPrev(At))
+    {
+        ++ChainCount;
+    }
+
+    node **Chain = PushArray(Builder->Arena, ChainCount, node *, NoClear());
+    u32 ChainIndex = ChainCount;
+    for(node *At = Tail; !IsChainHead(At, StopIf); At = GetControlPrev(At))
+    {
+        Chain[--ChainIndex] = At;
+    }
+
+    for(ChainIndex = 0; ChainIndex < ChainCount; ++ChainIndex)
+    {
+        node *Node = Chain[ChainIndex];
+        if(Node->Type == Node_Region)
+        {
+            node *If = Node->Region.Prev;
+            Assert(Block->ControlCount && (Block->Control[Block->ControlCount - 1] == If));
+
+            node *TrueHead = FindChainHead(Node->Region.TrueBranch, If);
+            basic_block *TrueBlock = NewBlock(Builder, TrueHead, Block);
+            AddEdge(Block, TrueBlock);
+            basic_block *TrueEnd = ScheduleChain(Builder, TrueBlock, Node->Region.TrueBranch, If);
+
+            node *FalseHead = FindChainHead(Node->Region.FalseBranch, If);
+            basic_block *FalseBlock = NewBlock(Builder, FalseHead, Block);
+            AddEdge(Block, FalseBlock);
+            basic_block *FalseEnd = ScheduleChain(Builder, FalseBlock, Node->Region.FalseBranch, If);
+
+            // NOTE(alex): Successor 0 of an If block is always the true branch
+            Assert(TrueHead->Index == 0);
+            Assert(FalseHead->Index == 1);
+
+            basic_block *Merge = NewBlock(Builder, Node, Block);
+            AddEdge(TrueEnd, Merge);
+            AddEdge(FalseEnd, Merge);
+
+            Block = Merge;
+        }
+        else
+        {
+            Assert((Node->Type == Node_Print) ||
+                   (Node->Type == Node_If) ||
+                   (Node->Type == Node_End));
+            AppendControl(Builder, Block, Node);
+        }
+    }
+
+    return Block;
+}
+
+internal basic_block *ScheduleEarly(schedule_builder *Builder, node *Node)
+{
+    schedule *Schedule = Builder->Schedule;
+    basic_block *Entry = Schedule->Blocks;
+
+    basic_block *Result = Schedule->BlockOf[Node->ID];
+    if(!Result)
+    {
+        switch(Node->Type)
+        {
+            case Node_Constant:
+            {
+                // NOTE(alex): Constants are not instructions, so they don't
+                // go into the data list.
+                Result = Entry;
+            } break;
+
+            case Node_Proj:
+            {
+                Assert(Node->Operand->Type == Node_Start);
+                Result = Entry;
+                Builder->DataNodes[Builder->DataCount++] = Node;
+            } break;
+
+            case Node_Phi:
+            {
+                node *Region = GetPhiRegion(Node);
+                Assert(Region && (Region->Type == Node_Region));
+
+                Result = Schedule->BlockOf[Region->ID];
+                Assert(Result);
+
+                // NOTE(alex): A phi is placed by its region, not its inputs,
+                // so mark it before we go looking at them.
+                Schedule->BlockOf[Node->ID] = Result;
+                Builder->DataNodes[Builder->DataCount++] = Node;
+
+                ScheduleEarly(Builder, Node->Operands[0]);
+                ScheduleEarly(Builder, Node->Operands[1]);
+            } break;
+
+            default:
+            {
+                Result = Entry;
+
+                node *Operands[MAX_NODE_OPERAND_COUNT];
+                u32 OperandCount = GetDataOperands(Node, Operands);
+                for(u32 OperandIndex = 0; OperandIndex < OperandCount; ++OperandIndex)
+                {
+                    basic_block *OperandBlock = ScheduleEarly(Builder, Operands[OperandIndex]);
+                    if(OperandBlock->Depth > Result->Depth)
+                    {
+                        Result = OperandBlock;
+                    }
+                }
+
+                Builder->DataNodes[Builder->DataCount++] = Node;
+            } break;
+        }
+
+        Schedule->BlockOf[Node->ID] = Result;
+    }
+
+    return Result;
+}
+
+internal void EmitData(schedule_builder *Builder, basic_block *Block, node *Node)
+{
+    schedule *Schedule = Builder->Schedule;
+
+    if(!IsConstant(Node) && !Builder->Emitted[Node->ID])
+    {
+        // NOTE(alex): Anything living in a dominating block was already emitted
+        // at the end of that block at the latest.
+        Assert(Schedule->BlockOf[Node->ID] == Block);
+        Builder->Emitted[Node->ID] = true;
+
+        if(Node->Type != Node_Phi)
+        {
+            node *Operands[MAX_NODE_OPERAND_COUNT];
+            u32 OperandCount = GetDataOperands(Node, Operands);
+            for(u32 OperandIndex = 0; OperandIndex < OperandCount; ++OperandIndex)
+            {
+                EmitData(Builder, Block, Operands[OperandIndex]);
+            }
+        }
+
+        Schedule->Instructions[Schedule->InstructionCount++] = Node;
+    }
+}
+
+internal void EmitRemainingData(schedule_builder *Builder, basic_block *Block)
+{
+    for(u32 DataIndex = 0; DataIndex < Block->DataCount; ++DataIndex)
+    {
+        EmitData(Builder, Block, Block->Data[DataIndex]);
+    }
+}
+
+internal schedule *ScheduleRoutine(memory_arena *Arena, node *EndNode, u32 NodeCapacity)
+{
+    TIMED_FUNCTION();
+
+    schedule *Schedule = PushStruct(Arena, schedule);
+    Schedule->NodeCapacity = NodeCapacity;
+    Schedule->BlockOf = PushArray(Arena, NodeCapacity, basic_block *);
+
+    schedule_builder Builder_ = {};
+    schedule_builder *Builder = &Builder_;
+    Builder->Arena = Arena;
+    Builder->Schedule = Schedule;
+    Builder->Emitted = PushArray(Arena, NodeCapacity, u8);
+
+    //
+    // NOTE(alex): Count the control nodes so we know how much to allocate
+    //
+
+    u32 RegionCount = 0;
+    u32 ControlCount = 0;
+    {
+        u32 StackCount = 0;
+        node **Stack = PushArray(Arena, NodeCapacity, node *, NoClear());
+
+        Builder->Emitted[EndNode->ID] = true;
+        Stack[StackCount++] = EndNode;
+        while(StackCount)
+        {
+            node *Node = Stack[--StackCount];
+
+            node *Prev[3] = {};
+            switch(Node->Type)
+            {
+                case Node_Start: {} break;
+                case Node_Proj: {Prev[0] = Node->Operand;} break;
+
+                case Node_Region:
+                {
+                    ++RegionCount;
+                    Prev[0] = Node->Region.Prev;
+                    Prev[1] = Node->Region.TrueBranch;
+                    Prev[2] = Node->Region.FalseBranch;
+                } break;
+
+                default:
+                {
+                    ++ControlCount;
+                    Prev[0] = Node->Control.Prev;
+                } break;
+            }
+
+            for(u32 PrevIndex = 0; PrevIndex < ArrayCount(Prev); ++PrevIndex)
+            {
+                node *Pred = Prev[PrevIndex];
+                if(Pred && !Builder->Emitted[Pred->ID])
+                {
+                    Builder->Emitted[Pred->ID] = true;
+                    Stack[StackCount++] = Pred;
+                }
+            }
+        }
+
+        ZeroArray(NodeCapacity, Builder->Emitted);
+    }
+
+    //
+    // NOTE(alex): Build the blocks
+    //
+
+    Schedule->Blocks = PushArray(Arena, 1 + 3*RegionCount, basic_block);
+    Builder->ControlNodes = PushArray(Arena, ControlCount, node *, NoClear());
+
+    node *StartNode = FindChainHead(EndNode, 0);
+    basic_block *Entry = NewBlock(Builder, StartNode, 0);
+    ScheduleChain(Builder, Entry, EndNode, 0);
+
+    Assert(Schedule->BlockCount == (1 + 3*RegionCount));
+    Assert(Builder->ControlCount == ControlCount);
+
+    //
+    // NOTE(alex): Place every data node that is reachable from a control node
+    //
+
+    Builder->DataNodes = PushArray(Arena, NodeCapacity, node *, NoClear());
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        for(u32 ControlIndex = 0; ControlIndex < Block->ControlCount; ++ControlIndex)
+        {
+            node *Operands[MAX_NODE_OPERAND_COUNT];
+            u32 OperandCount = GetDataOperands(Block->Control[ControlIndex], Operands);
+            for(u32 OperandIndex = 0; OperandIndex < OperandCount; ++OperandIndex)
+            {
+                ScheduleEarly(Builder, Operands[OperandIndex]);
+            }
+        }
+    }
+
+    // NOTE(alex): Bucket the data nodes by block, keeping the discovery order
+    for(u32 DataIndex = 0; DataIndex < Builder->DataCount; ++DataIndex)
+    {
+        node *Node = Builder->DataNodes[DataIndex];
+        ++Schedule->BlockOf[Node->ID]->DataCapacity;
+    }
+
+    node **DataStorage = PushArray(Arena, Builder->DataCount, node *, NoClear());
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        Block->Data = DataStorage;
+        DataStorage += Block->DataCapacity;
+    }
+
+    for(u32 DataIndex = 0; DataIndex < Builder->DataCount; ++DataIndex)
+    {
+        node *Node = Builder->DataNodes[DataIndex];
+        basic_block *Block = Schedule->BlockOf[Node->ID];
+        Block->Data[Block->DataCount++] = Node;
+    }
+
+    //
+    // NOTE(alex): Lay out the instructions
+    //
+
+    Schedule->Instructions = PushArray(Arena, ControlCount + Builder->DataCount, node *, NoClear());
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        Block->FirstInstruction = Schedule->InstructionCount;
+
+        // NOTE(alex): Phis and the routine's arguments are defined on entry to
+        // their block, so they go first.
+        for(u32 DataIndex = 0; DataIndex < Block->DataCount; ++DataIndex)
+        {
+            node *Node = Block->Data[DataIndex];
+            if((Node->Type == Node_Phi) ||
+               (Node->Type == Node_Proj))
+            {
+                EmitData(Builder, Block, Node);
+            }
+        }
+
+        b32 Terminated = false;
+        for(u32 ControlIndex = 0; ControlIndex < Block->ControlCount; ++ControlIndex)
+        {
+            node *Node = Block->Control[ControlIndex];
+            if((Node->Type == Node_If) ||
+               (Node->Type == Node_End))
+            {
+                // NOTE(alex): Whatever is left over in this block is used by
+                // a later block, so it has to happen before we leave.
+                EmitRemainingData(Builder, Block);
+                Terminated = true;
+            }
+
+            node *Operands[MAX_NODE_OPERAND_COUNT];
+            u32 OperandCount = GetDataOperands(Node, Operands);
+            for(u32 OperandIndex = 0; OperandIndex < OperandCount; ++OperandIndex)
+            {
+                EmitData(Builder, Block, Operands[OperandIndex]);
+            }
+
+            Schedule->Instructions[Schedule->InstructionCount++] = Node;
+        }
+
+        if(!Terminated)
+        {
+            EmitRemainingData(Builder, Block);
+        }
+
+        Block->InstructionCount = Schedule->InstructionCount - Block->FirstInstruction;
+    }
+
+    Assert(Schedule->InstructionCount == (ControlCount + Builder->DataCount));
+
+    return Schedule;
+}
+
+/* NOTE(alex): By the time a routine is scheduled, its nodes are wherever the
+   free list happened to hand them out, in between the ones the peepholes
+   threw away, and their IDs have gaps everywhere the thrown away ones were.
+   Everything after the schedule walks it in order and indexes arrays by ID,
+   so the live nodes get copied into one block of their own, in the order
+   the schedule uses them, and numbered from zero in that order.
+
+   That's the block heads and instructions, block by block, and then
+   whatever they reach that isn't either of those (the constants, mostly),
+   in the order it's first reached. The schedule is pointed at the copies,
+   and its NodeCapacity becomes the number of live nodes. The old nodes are
+   left alone, they go away with the routine's memory.
+
+   Reference counts are only of use while parsing, but they're counted
+   again anyway, so the copies are a graph that makes sense by itself.
+*/
+struct node_compactor
+{
+    // NOTE(alex): One past the new ID, so zero is a node that isn't numbered yet
+    u32 *NewIDOf;
+    node **Order;
+    u32 NodeCount;
+
+    node *Nodes;
+};
+
+inline void NumberNode(node_compactor *Compactor, node *Node)
+{
+    if(!Compactor->NewIDOf[Node->ID])
+    {
+        Compactor->Order[Compactor->NodeCount] = Node;
+        Compactor->NewIDOf[Node->ID] = ++Compactor->NodeCount;
+    }
+}
+
+inline node *GetCompacted(node_compactor *Compactor, node *Node)
+{
+    u32 NewID = Compactor->NewIDOf[Node->ID];
+    Assert(NewID);
+
+    node *Result = Compactor->Nodes + (NewID - 1);
+    return Result;
+}
+
+internal u32 CompactSchedule(memory_arena *Arena, schedule *Schedule, node **StartNode, node **EndNode)
+{
+    TIMED_FUNCTION();
+
+    node_compactor Compactor_ = {};
+    node_compactor *Compactor = &Compactor_;
+    Compactor->NewIDOf = PushArray(Arena, Schedule->NodeCapacity, u32);
+    Compactor->Order = PushArray(Arena, Schedule->NodeCapacity, node *, NoClear());
+
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        NumberNode(Compactor, Block->Head);
+
+        for(u32 InstructionIndex = Block->FirstInstruction;
+            InstructionIndex < (Block->FirstInstruction + Block->InstructionCount);
+            ++InstructionIndex)
+        {
+            NumberNode(Compactor, Schedule->Instructions[InstructionIndex]);
+        }
+    }
+
+    for(u32 OrderIndex = 0; OrderIndex < Compactor->NodeCount; ++OrderIndex)
+    {
+        node *Node = Compactor->Order[OrderIndex];
+        for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+        {
+            node *Operand = GetOperand(Node, OperandIndex);
+            if(Operand)
+            {
+                NumberNode(Compactor, Operand);
+            }
+        }
+    }
+
+    //
+    // NOTE(alex): Copy them over
+    //
+
+    u32 NodeCount = Compactor->NodeCount;
+    Compactor->Nodes = PushArray(Arena, NodeCount, node, NoClear());
+    for(u32 NodeIndex = 0; NodeIndex < NodeCount; ++NodeIndex)
+    {
+        node *Node = Compactor->Nodes + NodeIndex;
+        *Node = *Compactor->Order[NodeIndex];
+        Node->ID = NodeIndex;
+        Node->RefCount = 0;
+    }
+
+    for(u32 NodeIndex = 0; NodeIndex < NodeCount; ++NodeIndex)
+    {
+        node **Operands = &Compactor->Nodes[NodeIndex].Array;
+        for(u32 OperandIndex = 0; OperandIndex < MAX_NODE_OPERAND_COUNT; ++OperandIndex)
+        {
+            if(Operands[OperandIndex])
+            {
+                Operands[OperandIndex] = GetCompacted(Compactor, Operands[OperandIndex]);
+                ++Operands[OperandIndex]->RefCount;
+            }
+        }
+    }
+
+    //
+    // NOTE(alex): And point the schedule at them
+    //
+
+    basic_block **BlockOf = PushArray(Arena, NodeCount, basic_block *, NoClear());
+    for(u32 NodeIndex = 0; NodeIndex < NodeCount; ++NodeIndex)
+    {
+        BlockOf[NodeIndex] = Schedule->BlockOf[Compactor->Order[NodeIndex]->ID];
+    }
+
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        Block->Head = GetCompacted(Compactor, Block->Head);
+
+        for(u32 ControlIndex = 0; ControlIndex < Block->ControlCount; ++ControlIndex)
+        {
+            Block->Control[ControlIndex] = GetCompacted(Compactor, Block->Control[ControlIndex]);
+        }
+
+        for(u32 DataIndex = 0; DataIndex < Block->DataCount; ++DataIndex)
+        {
+            Block->Data[DataIndex] = GetCompacted(Compactor, Block->Data[DataIndex]);
+        }
+    }
+
+    for(u32 InstructionIndex = 0; InstructionIndex < Schedule->InstructionCount; ++InstructionIndex)
+    {
+        Schedule->Instructions[InstructionIndex] = GetCompacted(Compactor, Schedule->Instructions[InstructionIndex]);
+    }
+
+    Schedule->NodeCapacity = NodeCount;
+    Schedule->BlockOf = BlockOf;
+
+    *StartNode = GetCompacted(Compactor, *StartNode);
+    *EndNode = GetCompacted(Compactor, *EndNode);
+
+    return NodeCount;
+}
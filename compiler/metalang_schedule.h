@@ -0,0 +1,58 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+struct basic_block
+{
+    u32 Index;
+    u32 Depth;
+    basic_block *Dominator;
+
+    // NOTE(alex): Head is the control node that starts the block, which is
+    // either the Start node, a Proj of an If, or a Region.
+    node *Head;
+
+    u32 FirstInstruction;
+    u32 InstructionCount;
+
+    u32 SuccessorCount;
+    basic_block *Successors[2];
+
+    u32 PredecessorCount;
+    basic_block *Predecessors[2];
+
+    // NOTE(alex): Only used while building the schedule
+    u32 ControlCount;
+    node **Control;
+    u32 DataCount;
+    u32 DataCapacity;
+    node **Data;
+};
+
+struct schedule
+{
+    u32 BlockCount;
+    basic_block *Blocks;
+
+    // NOTE(alex): Instructions are laid out block by block in the same order
+    // as Blocks, so a block owns a contiguous range of this array. Constants
+    // are never scheduled, they are encoded as operands wherever they're used.
+    u32 InstructionCount;
+    node **Instructions;
+
+    // NOTE(alex): Indexed by node ID
+    u32 NodeCapacity;
+    basic_block **BlockOf;
+};
+
+internal schedule *ScheduleRoutine(memory_arena *Arena, node *EndNode, u32 NodeCapacity);
+internal u32 GetDataOperands(node *Node, node **Operands);
+internal u32 CompactSchedule(memory_arena *Arena, schedule *Schedule, node **StartNode, node **EndNode);
@@ -0,0 +1,218 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): A stream either goes straight to a file, or gets collected in
+   chunks on an arena so it can be written out later. When files compile on
+   several threads at once, each of them writes to its own streams, and the
+   driver writes the streams out in the order the files were given, so the
+   output is the same no matter how the work got split up.
+
+   A file stream that also has an arena is buffered: everything goes into
+   one chunk, which only gets written once it's full (or FlushFile is
+   called), so the console sees a few big writes instead of one per line.
+
+   Every stream also has a level, and output that's more detailed than
+   that is skipped, without even being formatted.
+*/
+
+#define STREAM_CHUNK_SIZE Kilobytes(16)
+#define STREAM_FILE_BUFFER_SIZE Kilobytes(64)
+
+enum stream_level
+{
+    // NOTE(alex): What got compiled, and what it did when it ran
+    StreamLevel_Normal,
+
+    // NOTE(alex): The control nodes of every finished routine, and how
+    // its values got allocated to registers (-v)
+    StreamLevel_Graph,
+
+    // NOTE(alex): Every variable at the end of every scope (-vv), which
+    // gets huge, since each one is printed as a whole tree
+    StreamLevel_Scopes,
+};
+
+struct stream_chunk
+{
+    umm Count;
+    umm Capacity;
+    u8 *Data;
+
+    stream_chunk *Next;
+};
+
+struct stream
+{
+    FILE *File;
+    u32 Level;
+
+    memory_arena *Memory;
+    stream_chunk *First;
+    stream_chunk *Last;
+};
+
+inline stream OnFile(FILE *File)
+{
+    stream Result = {};
+    Result.File = File;
+    return Result;
+}
+
+inline stream OnBufferedFile(FILE *File, memory_arena *Memory)
+{
+    stream Result = {};
+    Result.File = File;
+    Result.Memory = Memory;
+    return Result;
+}
+
+inline stream OnMemory(memory_arena *Memory)
+{
+    stream Result = {};
+    Result.Memory = Memory;
+    return Result;
+}
+
+// NOTE(alex): For skipping the work of producing output that nobody will see
+inline b32 IsOpen(stream *Stream)
+{
+    b32 Result = (Stream->File || Stream->Memory);
+    return Result;
+}
+
+inline b32 IsOpen(stream *Stream, stream_level Level)
+{
+    b32 Result = (IsOpen(Stream) && ((u32)Level <= Stream->Level));
+    return Result;
+}
+
+internal void FlushFile(stream *Stream)
+{
+    stream_chunk *Buffer = Stream->First;
+    if(Stream->File && Buffer && Buffer->Count)
+    {
+        fwrite(Buffer->Data, Buffer->Count, 1, Stream->File);
+        fflush(Stream->File);
+        Buffer->Count = 0;
+    }
+}
+
+internal void WriteToStream(stream *Dest, umm Size, void *SourceInit)
+{
+    u8 *Source = (u8 *)SourceInit;
+
+    if(Dest->File && Dest->Memory)
+    {
+        stream_chunk *Buffer = Dest->First;
+        if(!Buffer)
+        {
+            Buffer = Dest->First = Dest->Last = PushStruct(Dest->Memory, stream_chunk);
+            Buffer->Capacity = STREAM_FILE_BUFFER_SIZE;
+            Buffer->Data = PushArray(Dest->Memory, Buffer->Capacity, u8, NoClear());
+        }
+
+        if(Size > (Buffer->Capacity - Buffer->Count))
+        {
+            FlushFile(Dest);
+        }
+
+        if(Size >= Buffer->Capacity)
+        {
+            // NOTE(alex): Already a big write, no point copying it first
+            fwrite(Source, Size, 1, Dest->File);
+        }
+        else
+        {
+            Copy(Size, Source, Buffer->Data + Buffer->Count);
+            Buffer->Count += Size;
+        }
+    }
+    else if(Dest->File)
+    {
+        fwrite(Source, Size, 1, Dest->File);
+    }
+    else if(Dest->Memory)
+    {
+        while(Size)
+        {
+            stream_chunk *Chunk = Dest->Last;
+            if(!Chunk || (Chunk->Count == Chunk->Capacity))
+            {
+                Chunk = PushStruct(Dest->Memory, stream_chunk);
+                Chunk->Capacity = STREAM_CHUNK_SIZE;
+                Chunk->Data = PushArray(Dest->Memory, Chunk->Capacity, u8, NoClear());
+
+                if(Dest->Last)
+                {
+                    Dest->Last->Next = Chunk;
+                }
+                else
+                {
+                    Dest->First = Chunk;
+                }
+                Dest->Last = Chunk;
+            }
+
+            umm CopySize = Minimum(Size, Chunk->Capacity - Chunk->Count);
+            Copy(CopySize, Source, Chunk->Data + Chunk->Count);
+            Chunk->Count += CopySize;
+
+            Source += CopySize;
+            Size -= CopySize;
+        }
+    }
+    else
+    {
+        // NOTE(alex): A stream with nowhere to go just drops everything
+    }
+}
+
+internal void OutfArgList(stream *Dest, char *Format, va_list ArgList)
+{
+    if(IsOpen(Dest))
+    {
+        char Buffer[Kilobytes(4)];
+        umm Size = FormatStringList(sizeof(Buffer), Buffer, Format, ArgList);
+        WriteToStream(Dest, Size, Buffer);
+    }
+}
+
+internal void Outf(stream *Dest, char *Format, ...)
+{
+    va_list ArgList;
+    va_start(ArgList, Format);
+
+    OutfArgList(Dest, Format, ArgList);
+
+    va_end(ArgList);
+}
+
+internal umm GetStreamSize(stream *Source)
+{
+    umm Result = 0;
+    for(stream_chunk *Chunk = Source->First; Chunk; Chunk = Chunk->Next)
+    {
+        Result += Chunk->Count;
+    }
+
+    return Result;
+}
+
+internal void FlushStream(stream *Source, stream *Dest)
+{
+    for(stream_chunk *Chunk = Source->First; Chunk; Chunk = Chunk->Next)
+    {
+        WriteToStream(Dest, Chunk->Count, Chunk->Data);
+    }
+
+    Source->First = Source->Last = 0;
+}
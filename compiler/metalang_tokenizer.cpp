@@ -55,9 +55,10 @@ internal b32 Parsing(tokenizer *Tokenizer)
 
 internal void ErrorArgList(tokenizer *Tokenizer, token OnToken, char *Format, va_list ArgList)
 {
-    fprintf(stderr, "\x1b[1;31m%.*s(%u,%u)\x1b[0m: \"%.*s\" - ", ExpandString(OnToken.FileName), OnToken.LineNumber, OnToken.ColumnNumber, ExpandString(OnToken.Text));
-    vfprintf(stderr, /* Tokenizer->ErrorStream, */ Format, ArgList);
-    fputc('\n', stderr);
+    stream *Errors = Tokenizer->ErrorStream;
+    Outf(Errors, "\x1b[1;31m%.*s(%u,%u)\x1b[0m: \"%.*s\" - ", ExpandString(OnToken.FileName), OnToken.LineNumber, OnToken.ColumnNumber, ExpandString(OnToken.Text));
+    OutfArgList(Errors, Format, ArgList);
+    Outf(Errors, "\n");
 
     Tokenizer->Error = true;
 }
@@ -109,6 +110,29 @@ internal void AdvanceChars(tokenizer *Tokenizer, u32 Count)
     Refill(Tokenizer);
 }
 
+// NOTE(alex): For the ends of lines inside comments and strings. They count
+// (and start the column over) the same as the ones outside, so where a line
+// starts only depends on the text, which the prescan relies on.
+internal void AdvanceCharCountingLines(tokenizer *Tokenizer)
+{
+    char C = Tokenizer->At[0];
+    AdvanceChars(Tokenizer, 1);
+
+    if(IsEndOfLine(C))
+    {
+        if(((C == '\r') &&
+            (Tokenizer->At[0] == '\n')) ||
+           ((C == '\n') &&
+            (Tokenizer->At[0] == '\r')))
+        {
+            AdvanceChars(Tokenizer, 1);
+        }
+
+        Tokenizer->ColumnNumber = 1;
+        ++Tokenizer->LineNumber;
+    }
+}
+
 internal b32 TokenEquals(token Token, char *Match)
 {
     b32 Result = StringsAreEqual(Token.Text, Match);
@@ -121,6 +145,174 @@ internal b32 IsValid(token Token)
     return(Result);
 }
 
+/* NOTE(alex): Decimal integers go eight digits at a time whenever there
+   are eight left in the input. The eight characters are loaded as one u64
+   (the first one in the low byte), checked to all be digits at once, and
+   then combined pairwise: 8 digits to 4 two digit numbers, to 2 four digit
+   numbers, to one. Nothing goes through a float unless there's a . or an
+   exponent.
+*/
+inline b32 IsEightDigits(u64 Chunk)
+{
+    // NOTE(alex): '0' to '9' are 0x30 to 0x39, and adding 6 to them
+    // mustn't carry into the high nibble either.
+    b32 Result = ((((Chunk & 0xF0F0F0F0F0F0F0F0ull) |
+                    (((Chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+                   0x3333333333333333ull));
+    return Result;
+}
+
+inline u64 ParseEightDigits(u64 Chunk)
+{
+    Chunk &= 0x0F0F0F0F0F0F0F0Full;
+    Chunk = (Chunk*(1 + (10 << 8))) >> 8;
+    Chunk = ((Chunk & 0x00FF00FF00FF00FFull)*(1 + (100ull << 16))) >> 16;
+    Chunk = ((Chunk & 0x0000FFFF0000FFFFull)*(1 + (10000ull << 32))) >> 32;
+
+    return Chunk;
+}
+
+internal u64 GetDecimalDigits(tokenizer *Tokenizer, u64 Value, b32 *Overflowed)
+{
+    while(Tokenizer->Input.Count >= 8)
+    {
+        u64 Chunk;
+        Copy(sizeof(Chunk), Tokenizer->Input.Data, &Chunk);
+        if(!IsEightDigits(Chunk))
+        {
+            break;
+        }
+
+        u64 Digits = ParseEightDigits(Chunk);
+        if(Value > ((U64Max - Digits) / 100000000))
+        {
+            *Overflowed = true;
+        }
+        Value = Value*100000000 + Digits;
+        AdvanceChars(Tokenizer, 8);
+    }
+
+    while(IsNumber(Tokenizer->At[0]))
+    {
+        u64 Digit = Tokenizer->At[0] - '0';
+        if(Value > ((U64Max - Digit) / 10))
+        {
+            *Overflowed = true;
+        }
+        Value = Value*10 + Digit;
+        AdvanceChars(Tokenizer, 1);
+    }
+
+    return Value;
+}
+
+internal void GetNumber(tokenizer *Tokenizer, char First, token *Token)
+{
+    Token->Type = Token_Number;
+
+    u64 Value = 0;
+    b32 Overflowed = false;
+    b32 IsReal = false;
+    f64 Real = 0.0;
+
+    char Prefix = Tokenizer->At[0];
+    if((First == '0') && ((Prefix == 'x') || (Prefix == 'X')))
+    {
+        AdvanceChars(Tokenizer, 1);
+        if(!IsHex(Tokenizer->At[0]))
+        {
+            Token->Type = Token_Unknown;
+        }
+
+        while(IsHex(Tokenizer->At[0]))
+        {
+            Overflowed |= ((Value >> 60) != 0);
+            Value = (Value << 4) | GetHex(Tokenizer->At[0]);
+            AdvanceChars(Tokenizer, 1);
+        }
+    }
+    else if((First == '0') && ((Prefix == 'b') || (Prefix == 'B')))
+    {
+        AdvanceChars(Tokenizer, 1);
+        if((Tokenizer->At[0] != '0') && (Tokenizer->At[0] != '1'))
+        {
+            Token->Type = Token_Unknown;
+        }
+
+        while((Tokenizer->At[0] == '0') || (Tokenizer->At[0] == '1'))
+        {
+            Overflowed |= ((Value >> 63) != 0);
+            Value = (Value << 1) | (Tokenizer->At[0] - '0');
+            AdvanceChars(Tokenizer, 1);
+        }
+    }
+    else
+    {
+        Value = GetDecimalDigits(Tokenizer, First - '0', &Overflowed);
+
+        if(Tokenizer->At[0] == '.')
+        {
+            IsReal = true;
+            Real = (f64)Value;
+
+            AdvanceChars(Tokenizer, 1);
+            f64 Coefficient = 0.1;
+            while(IsNumber(Tokenizer->At[0]))
+            {
+                Real += Coefficient*(f64)(Tokenizer->At[0] - '0');
+                Coefficient *= 0.1;
+                AdvanceChars(Tokenizer, 1);
+            }
+        }
+
+        char Sign = Tokenizer->At[1];
+        if(((Tokenizer->At[0] == 'e') || (Tokenizer->At[0] == 'E')) &&
+           (IsNumber(Sign) || (Sign == '+') || (Sign == '-')))
+        {
+            if(!IsReal)
+            {
+                IsReal = true;
+                Real = (f64)Value;
+            }
+
+            AdvanceChars(Tokenizer, 1);
+            b32 Negative = (Tokenizer->At[0] == '-');
+            if(!IsNumber(Tokenizer->At[0]))
+            {
+                AdvanceChars(Tokenizer, 1);
+            }
+
+            // NOTE(alex): Way past what an f32 can hold either way, so
+            // there's no point counting any higher.
+            u32 Exponent = 0;
+            while(IsNumber(Tokenizer->At[0]))
+            {
+                Exponent = Minimum(10*Exponent + (Tokenizer->At[0] - '0'), 100);
+                AdvanceChars(Tokenizer, 1);
+            }
+
+            for(u32 Power = 0; Power < Exponent; ++Power)
+            {
+                Real = Negative ? (0.1*Real) : (10.0*Real);
+            }
+        }
+    }
+
+    if(IsReal)
+    {
+        Token->F32 = (f32)Real;
+        Token->S32 = RoundReal32ToInt32(Token->F32);
+        Token->U64 = (u64)Token->S32;
+    }
+    else
+    {
+        Token->F32 = (f32)Value;
+        Token->S32 = (s32)(u32)Value;
+        Token->U64 = Value;
+    }
+    Token->Overflowed = Overflowed;
+}
+
 internal token GetTokenRaw(tokenizer *Tokenizer)
 {
     token Token = {};
@@ -167,7 +359,7 @@ internal token GetTokenRaw(tokenizer *Tokenizer)
                 {
                     AdvanceChars(Tokenizer, 1);
                 }
-                AdvanceChars(Tokenizer, 1);
+                AdvanceCharCountingLines(Tokenizer);
             }
 
             if(Tokenizer->At[0] == '"')
@@ -205,7 +397,7 @@ internal token GetTokenRaw(tokenizer *Tokenizer)
             {
                 Token.Type = Token_Comment;
 
-                AdvanceChars(Tokenizer, 2);
+                AdvanceChars(Tokenizer, 1);
                 while(Tokenizer->At[0] && !IsEndOfLine(Tokenizer->At[0]))
                 {
                     AdvanceChars(Tokenizer, 1);
@@ -216,25 +408,12 @@ internal token GetTokenRaw(tokenizer *Tokenizer)
             {
                 Token.Type = Token_Comment;
 
-                AdvanceChars(Tokenizer, 2);
+                AdvanceChars(Tokenizer, 1);
                 while(Tokenizer->At[0] &&
                       !((Tokenizer->At[0] == '*') &&
                         (Tokenizer->At[1] == '/')))
                 {
-                    if(((Tokenizer->At[0] == '\r') &&
-                        (Tokenizer->At[1] == '\n')) ||
-                       ((Tokenizer->At[0] == '\n') &&
-                        (Tokenizer->At[1] == '\r')))
-                    {
-                        AdvanceChars(Tokenizer, 1);
-                    }
-
-                    if(IsEndOfLine(Tokenizer->At[0]))
-                    {
-                        ++Tokenizer->LineNumber;
-                    }
-
-                    AdvanceChars(Tokenizer, 1);
+                    AdvanceCharCountingLines(Tokenizer);
                 }
 
                 if(Tokenizer->At[0] == '*')
@@ -255,31 +434,7 @@ internal token GetTokenRaw(tokenizer *Tokenizer)
             }
             else if(IsNumber(C))
             {
-                f32 Number = (f32)(C - '0');
-
-                while(IsNumber(Tokenizer->At[0]))
-                {
-                    f32 Digit = (f32)(Tokenizer->At[0] - '0');
-                    Number = 10.0f*Number + Digit;
-                    AdvanceChars(Tokenizer, 1);
-                }
-
-                if(Tokenizer->At[0] == '.')
-                {
-                    AdvanceChars(Tokenizer, 1);
-                    f32 Coefficient = 0.1f;
-                    while(IsNumber(Tokenizer->At[0]))
-                    {
-                        f32 Digit = (f32)(Tokenizer->At[0] - '0');
-                        Number += Coefficient*Digit;
-                        Coefficient *= 0.1f;
-                        AdvanceChars(Tokenizer, 1);
-                    }
-                }
-
-                Token.Type = Token_Number;
-                Token.F32 = Number;
-                Token.S32 = RoundReal32ToInt32(Number);
+                GetNumber(Tokenizer, C, &Token);
             }
             else
             {
@@ -432,11 +587,14 @@ internal b32 PeekToken(tokenizer *Tokenizer, token_type DesiredType)
     return Result;
 }
 
-internal tokenizer Tokenize(string Input, string FileName)
+internal tokenizer Tokenize(string Input, string FileName, stream *ErrorStream)
 {
+    TIMED_FUNCTION();
+
     tokenizer Result = {};
 
     Result.FileName = FileName;
+    Result.ErrorStream = ErrorStream;
     Result.ColumnNumber = 1;
     Result.LineNumber = 1;
     Result.Input = Input;
@@ -57,6 +57,11 @@ struct token
     string Text;
     f32 F32;
     s32 S32;
+
+    // NOTE(alex): Integers are exact, and S32 is just their low 32 bits.
+    // Overflowed is set when even 64 bits weren't enough.
+    u64 U64;
+    b32 Overflowed;
 };
 
 struct tokenizer
@@ -86,4 +91,4 @@ internal token RequireToken(tokenizer *Tokenizer, token_type DesiredType);
 internal token RequireIdentifier(tokenizer *Tokenizer, char *Match);
 internal token RequireIntegerRange(tokenizer *Tokenizer, s32 MinValue, s32 MaxValue);
 internal b32 OptionalToken(tokenizer *Tokenizer, token_type DesiredType);
-internal tokenizer Tokenize(string Input, string FileName);
+internal tokenizer Tokenize(string Input, string FileName, stream *ErrorStream);
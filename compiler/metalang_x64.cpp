@@ -0,0 +1,643 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+/* NOTE(alex): x86-64 code generation for the System V ABI, straight from the
+   schedule and the register allocation into the .text of an object.
+
+   Every routine takes its argument in edi and returns a 32-bit value in eax.
+   Allocated values live in rbx and r12 to r15, which are callee-saved, so
+   calling printf for a print statement never disturbs them. r11 is the
+   scratch register for phi copy cycles, and rax, rcx and rdx are free to be
+   used as temporaries by any single instruction.
+
+   The frame looks like this:
+
+   [rbp + 8]                   return address
+   [rbp]                       saved rbp
+   [rbp - 8*SavedCount]        saved callee-saved registers
+   [rbp - 8*SavedCount - 4*N]  spill slot N - 1
+
+   and rsp is kept 16-byte aligned below that, so calls can be made directly.
+*/
+
+global u8 X64AllocatableRegisters[X64_ALLOCATABLE_REGISTER_COUNT] =
+{
+    X64_RBX, X64_R12, X64_R13, X64_R14, X64_R15,
+};
+
+internal void Emit8(object_builder *Object, u8 Value)
+{
+    *ReserveText(Object, 1) = Value;
+}
+
+internal void Emit32(object_builder *Object, u32 Value)
+{
+    u8 *Dest = ReserveText(Object, 4);
+    Dest[0] = (u8)(Value >> 0);
+    Dest[1] = (u8)(Value >> 8);
+    Dest[2] = (u8)(Value >> 16);
+    Dest[3] = (u8)(Value >> 24);
+}
+
+internal u32 GetTextOffset(object_builder *Object)
+{
+    u32 Result = (u32)Object->Text.Size;
+    return Result;
+}
+
+internal void EmitREX(object_builder *Object, b32 Wide, u32 Reg, u32 RM)
+{
+    u8 REX = (u8)(0x40 |
+                  (Wide ? 0x8 : 0) |
+                  ((Reg & 8) ? 0x4 : 0) |
+                  ((RM & 8) ? 0x1 : 0));
+    if(REX != 0x40)
+    {
+        Emit8(Object, REX);
+    }
+}
+
+internal void EmitCall(object_builder *Object, string Name)
+{
+    u32 Symbol = GetOrAddSymbol(Object, Name);
+
+    Emit8(Object, 0xE8);
+    AddRelocation(Object, GetTextOffset(Object), Relocation_PLT32, Section_Text, Symbol, -4);
+    Emit32(Object, 0);
+}
+
+inline u32 GetX64Register(x64_routine *Routine, value_location Location)
+{
+    Assert(Location.Type == Location_Register);
+
+    u32 Result = X64_R11;
+    if(Location.Index != Routine->Allocation->ScratchRegister)
+    {
+        Assert(Location.Index < X64_ALLOCATABLE_REGISTER_COUNT);
+        Result = X64AllocatableRegisters[Location.Index];
+    }
+
+    return Result;
+}
+
+inline s32 GetStackDisplacement(x64_routine *Routine, u32 Slot)
+{
+    s32 Result = -(s32)(8*Routine->SavedRegisterCount + 4*(Slot + 1));
+    return Result;
+}
+
+// NOTE(alex): Emits a 32-bit instruction with a ModRM byte, where the r/m
+// operand is either an allocated register or a spill slot. Opcode can be two
+// bytes (0x0F first), in which case it's written high byte first.
+internal void EmitRM(x64_routine *Routine, u32 Opcode, u32 Reg, value_location Operand)
+{
+    object_builder *Object = Routine->Object;
+
+    if(Operand.Type == Location_Register)
+    {
+        u32 RM = GetX64Register(Routine, Operand);
+        EmitREX(Object, false, Reg, RM);
+        if(Opcode > 0xFF)
+        {
+            Emit8(Object, (u8)(Opcode >> 8));
+        }
+        Emit8(Object, (u8)Opcode);
+        Emit8(Object, (u8)(0xC0 | ((Reg & 7) << 3) | (RM & 7)));
+    }
+    else
+    {
+        Assert(Operand.Type == Location_Stack);
+        EmitREX(Object, false, Reg, X64_RBP);
+        if(Opcode > 0xFF)
+        {
+            Emit8(Object, (u8)(Opcode >> 8));
+        }
+        Emit8(Object, (u8)Opcode);
+        Emit8(Object, (u8)(0x80 | ((Reg & 7) << 3) | X64_RBP));
+        Emit32(Object, (u32)GetStackDisplacement(Routine, Operand.Index));
+    }
+}
+
+internal void EmitRR(object_builder *Object, u32 Opcode, u32 Reg, u32 RM)
+{
+    EmitREX(Object, false, Reg, RM);
+    Emit8(Object, (u8)Opcode);
+    Emit8(Object, (u8)(0xC0 | ((Reg & 7) << 3) | (RM & 7)));
+}
+
+internal void EmitLoad(x64_routine *Routine, u32 Dest, value_location Source)
+{
+    object_builder *Object = Routine->Object;
+
+    switch(Source.Type)
+    {
+        case Location_Register:
+        {
+            u32 SourceRegister = GetX64Register(Routine, Source);
+            if(SourceRegister != Dest)
+            {
+                // NOTE(alex): mov Dest, Source
+                EmitRR(Object, 0x8B, Dest, SourceRegister);
+            }
+        } break;
+
+        case Location_Stack:
+        {
+            EmitRM(Routine, 0x8B, Dest, Source);
+        } break;
+
+        case Location_Constant:
+        {
+            // NOTE(alex): mov Dest, imm32
+            EmitREX(Object, false, 0, Dest);
+            Emit8(Object, (u8)(0xB8 + (Dest & 7)));
+            Emit32(Object, (u32)Source.Value);
+        } break;
+
+        InvalidDefaultCase;
+    }
+}
+
+internal void EmitStore(x64_routine *Routine, value_location Dest, u32 Source)
+{
+    if((Dest.Type == Location_Register) &&
+       (GetX64Register(Routine, Dest) == Source))
+    {
+        // NOTE(alex): Already there
+    }
+    else
+    {
+        // NOTE(alex): mov Dest, Source
+        EmitRM(Routine, 0x89, Source, Dest);
+    }
+}
+
+internal void EmitMove(x64_routine *Routine, value_location Dest, value_location Source)
+{
+    if(Dest.Type == Location_Register)
+    {
+        EmitLoad(Routine, GetX64Register(Routine, Dest), Source);
+    }
+    else if(Source.Type == Location_Register)
+    {
+        EmitStore(Routine, Dest, GetX64Register(Routine, Source));
+    }
+    else if(Source.Type == Location_Constant)
+    {
+        // NOTE(alex): mov dword [rbp + disp], imm32
+        EmitRM(Routine, 0xC7, 0, Dest);
+        Emit32(Routine->Object, (u32)Source.Value);
+    }
+    else if(!LocationsAreEqual(Dest, Source))
+    {
+        EmitLoad(Routine, X64_RAX, Source);
+        EmitStore(Routine, Dest, X64_RAX);
+    }
+}
+
+enum x64_alu_op
+{
+    ALU_Add,
+    ALU_Sub,
+    ALU_Mul,
+    ALU_Cmp,
+};
+
+// NOTE(alex): Target = Target op Source
+internal void EmitALU(x64_routine *Routine, x64_alu_op Op, u32 Target, value_location Source)
+{
+    object_builder *Object = Routine->Object;
+
+    if(Source.Type == Location_Constant)
+    {
+        if(Op == ALU_Mul)
+        {
+            // NOTE(alex): imul Target, Target, imm32
+            EmitRR(Object, 0x69, Target, Target);
+        }
+        else
+        {
+            u32 Extension = 0;
+            switch(Op)
+            {
+                case ALU_Add: {Extension = 0;} break;
+                case ALU_Sub: {Extension = 5;} break;
+                case ALU_Cmp: {Extension = 7;} break;
+                InvalidDefaultCase;
+            }
+
+            EmitRR(Object, 0x81, Extension, Target);
+        }
+
+        Emit32(Object, (u32)Source.Value);
+    }
+    else
+    {
+        u32 Opcode = 0;
+        switch(Op)
+        {
+            case ALU_Add: {Opcode = 0x03;} break;
+            case ALU_Sub: {Opcode = 0x2B;} break;
+            case ALU_Mul: {Opcode = 0x0FAF;} break;
+            case ALU_Cmp: {Opcode = 0x3B;} break;
+            InvalidDefaultCase;
+        }
+
+        EmitRM(Routine, Opcode, Target, Source);
+    }
+}
+
+internal void EmitSetCCToEAX(object_builder *Object, u8 Condition)
+{
+    // NOTE(alex): setcc al, then movzx eax, al
+    Emit8(Object, 0x0F);
+    Emit8(Object, Condition);
+    Emit8(Object, 0xC0);
+    Emit8(Object, 0x0F);
+    Emit8(Object, 0xB6);
+    Emit8(Object, 0xC0);
+}
+
+internal void EmitJump(x64_routine *Routine, b32 IfZero, u32 TargetBlock)
+{
+    object_builder *Object = Routine->Object;
+
+    if(IfZero)
+    {
+        // NOTE(alex): jz rel32
+        Emit8(Object, 0x0F);
+        Emit8(Object, 0x84);
+    }
+    else
+    {
+        // NOTE(alex): jmp rel32
+        Emit8(Object, 0xE9);
+    }
+
+    x64_fixup *Fixup = Routine->Fixups + Routine->FixupCount++;
+    Fixup->Offset = GetTextOffset(Object);
+    Fixup->TargetBlock = TargetBlock;
+
+    Emit32(Object, 0);
+}
+
+internal void EmitEpilogue(x64_routine *Routine)
+{
+    object_builder *Object = Routine->Object;
+
+    if(Routine->FrameSize)
+    {
+        // NOTE(alex): add rsp, imm32
+        Emit8(Object, 0x48);
+        Emit8(Object, 0x81);
+        Emit8(Object, 0xC4);
+        Emit32(Object, Routine->FrameSize);
+    }
+
+    for(u32 SavedIndex = Routine->SavedRegisterCount; SavedIndex--;)
+    {
+        u32 Register = X64AllocatableRegisters[SavedIndex];
+        EmitREX(Object, false, 0, Register);
+        Emit8(Object, (u8)(0x58 + (Register & 7)));
+    }
+
+    Emit8(Object, 0x5D); // NOTE(alex): pop rbp
+    Emit8(Object, 0xC3); // NOTE(alex): ret
+}
+
+internal void GenerateX64Instruction(x64_routine *Routine, basic_block *Block, node *Node)
+{
+    object_builder *Object = Routine->Object;
+    register_allocation *Allocation = Routine->Allocation;
+
+    switch(Node->Type)
+    {
+        case Node_Phi:
+        {
+            // NOTE(alex): Phis are filled in by the copies at the end of
+            // their predecessors.
+        } break;
+
+        case Node_Proj:
+        {
+            Assert((Node->Operand->Type == Node_Start) && (Node->Index == 1));
+            EmitStore(Routine, GetLocation(Allocation, Node), X64_RDI);
+        } break;
+
+        case Node_Add:
+        case Node_Sub:
+        case Node_Mul:
+        {
+            value_location Dest = GetLocation(Allocation, Node);
+            value_location LHS = GetLocation(Allocation, Node->Operands[0]);
+            value_location RHS = GetLocation(Allocation, Node->Operands[1]);
+
+            x64_alu_op Op = ((Node->Type == Node_Add) ? ALU_Add :
+                             (Node->Type == Node_Sub) ? ALU_Sub : ALU_Mul);
+
+            // NOTE(alex): Two-address form, so compute straight into the
+            // destination register unless that would overwrite the right
+            // hand side before we read it.
+            u32 Target = X64_RAX;
+            if(Dest.Type == Location_Register)
+            {
+                Target = GetX64Register(Routine, Dest);
+                if(LocationsAreEqual(RHS, Dest) && !LocationsAreEqual(LHS, Dest))
+                {
+                    if(Op == ALU_Sub)
+                    {
+                        Target = X64_RAX;
+                    }
+                    else
+                    {
+                        value_location Swap = LHS;
+                        LHS = RHS;
+                        RHS = Swap;
+                    }
+                }
+            }
+
+            EmitLoad(Routine, Target, LHS);
+            EmitALU(Routine, Op, Target, RHS);
+            EmitStore(Routine, Dest, Target);
+        } break;
+
+        case Node_Div:
+        {
+            value_location RHS = GetLocation(Allocation, Node->Operands[1]);
+
+            EmitLoad(Routine, X64_RAX, GetLocation(Allocation, Node->Operands[0]));
+            Emit8(Object, 0x99); // NOTE(alex): cdq
+
+            // NOTE(alex): idiv r/m32
+            if(RHS.Type == Location_Constant)
+            {
+                EmitLoad(Routine, X64_RCX, RHS);
+                EmitRR(Object, 0xF7, 7, X64_RCX);
+            }
+            else
+            {
+                EmitRM(Routine, 0xF7, 7, RHS);
+            }
+
+            EmitStore(Routine, GetLocation(Allocation, Node), X64_RAX);
+        } break;
+
+        case Node_EQ:
+        case Node_NE:
+        case Node_LE:
+        case Node_LT:
+        {
+            u8 Condition = 0;
+            switch(Node->Type)
+            {
+                case Node_EQ: {Condition = 0x94;} break; // NOTE(alex): sete
+                case Node_NE: {Condition = 0x95;} break; // NOTE(alex): setne
+                case Node_LE: {Condition = 0x9E;} break; // NOTE(alex): setle
+                case Node_LT: {Condition = 0x9C;} break; // NOTE(alex): setl
+            }
+
+            EmitLoad(Routine, X64_RAX, GetLocation(Allocation, Node->Operands[0]));
+            EmitALU(Routine, ALU_Cmp, X64_RAX, GetLocation(Allocation, Node->Operands[1]));
+            EmitSetCCToEAX(Object, Condition);
+            EmitStore(Routine, GetLocation(Allocation, Node), X64_RAX);
+        } break;
+
+        case Node_Neg:
+        {
+            value_location Dest = GetLocation(Allocation, Node);
+            u32 Target = (Dest.Type == Location_Register) ? GetX64Register(Routine, Dest) : (u32)X64_RAX;
+
+            EmitLoad(Routine, Target, GetLocation(Allocation, Node->Operand));
+            EmitRR(Object, 0xF7, 3, Target); // NOTE(alex): neg
+            EmitStore(Routine, Dest, Target);
+        } break;
+
+        case Node_Not:
+        {
+            EmitLoad(Routine, X64_RAX, GetLocation(Allocation, Node->Operand));
+            EmitRR(Object, 0x85, X64_RAX, X64_RAX); // NOTE(alex): test eax, eax
+            EmitSetCCToEAX(Object, 0x94);
+            EmitStore(Routine, GetLocation(Allocation, Node), X64_RAX);
+        } break;
+
+        case Node_Print:
+        {
+            u32 FormatOffset = AddReadOnlyString(Object, "%d\n");
+
+            // NOTE(alex): lea rdi, [rip + Format]
+            Emit8(Object, 0x48);
+            Emit8(Object, 0x8D);
+            Emit8(Object, 0x3D);
+            AddRelocation(Object, GetTextOffset(Object), Relocation_PC32, Section_ReadOnly, 0, (s32)FormatOffset - 4);
+            Emit32(Object, 0);
+
+            EmitLoad(Routine, X64_RSI, GetLocation(Allocation, Node->Control.Data));
+
+            // NOTE(alex): printf is variadic, so al holds the number of vector
+            // registers used, which is none.
+            EmitRR(Object, 0x31, X64_RAX, X64_RAX);
+            EmitCall(Object, BundleZ("printf"));
+        } break;
+
+        case Node_If:
+        {
+            value_location Predicate = GetLocation(Allocation, Node->Control.Data);
+            switch(Predicate.Type)
+            {
+                case Location_Register:
+                {
+                    u32 Register = GetX64Register(Routine, Predicate);
+                    EmitRR(Object, 0x85, Register, Register); // NOTE(alex): test
+                } break;
+
+                case Location_Stack:
+                {
+                    // NOTE(alex): cmp dword [rbp + disp], 0
+                    EmitRM(Routine, 0x83, 7, Predicate);
+                    Emit8(Object, 0);
+                } break;
+
+                case Location_Constant:
+                {
+                    EmitLoad(Routine, X64_RAX, Predicate);
+                    EmitRR(Object, 0x85, X64_RAX, X64_RAX);
+                } break;
+
+                InvalidDefaultCase;
+            }
+
+            Assert(Block->SuccessorCount == 2);
+            EmitJump(Routine, true, Block->Successors[1]->Index);
+            if(Block->Successors[0]->Index != (Block->Index + 1))
+            {
+                EmitJump(Routine, false, Block->Successors[0]->Index);
+            }
+        } break;
+
+        case Node_End:
+        {
+            if(Node->Control.Data)
+            {
+                EmitLoad(Routine, X64_RAX, GetLocation(Allocation, Node->Control.Data));
+            }
+            else
+            {
+                EmitRR(Object, 0x31, X64_RAX, X64_RAX);
+            }
+
+            EmitEpilogue(Routine);
+        } break;
+
+        InvalidDefaultCase;
+    }
+}
+
+internal void GenerateX64Routine(memory_arena *Arena, object_builder *Object, string Name,
+                                 schedule *Schedule, register_allocation *Allocation)
+{
+    TIMED_FUNCTION();
+
+    Assert(Allocation->RegisterCount <= X64_ALLOCATABLE_REGISTER_COUNT);
+
+    x64_routine Routine_ = {};
+    x64_routine *Routine = &Routine_;
+    Routine->Object = Object;
+    Routine->Schedule = Schedule;
+    Routine->Allocation = Allocation;
+    Routine->BlockOffsets = PushArray(Arena, Schedule->BlockCount, u32, NoClear());
+
+    // NOTE(alex): At most one conditional and one unconditional jump per block
+    Routine->Fixups = PushArray(Arena, 2*Schedule->BlockCount, x64_fixup, NoClear());
+
+    Routine->SavedRegisterCount = Allocation->RegistersUsed;
+    u32 SavedSize = 8*Routine->SavedRegisterCount;
+    Routine->FrameSize = Align16(SavedSize + 4*Allocation->SpillSlotCount) - SavedSize;
+
+    // NOTE(alex): Routines start on a 16 byte boundary, padded with int3
+    while(Object->Text.Size & 15)
+    {
+        Emit8(Object, 0xCC);
+    }
+
+    u32 RoutineStart = GetTextOffset(Object);
+
+    //
+    // NOTE(alex): Prologue
+    //
+
+    Emit8(Object, 0x55); // NOTE(alex): push rbp
+    Emit8(Object, 0x48); // NOTE(alex): mov rbp, rsp
+    Emit8(Object, 0x89);
+    Emit8(Object, 0xE5);
+
+    for(u32 SavedIndex = 0; SavedIndex < Routine->SavedRegisterCount; ++SavedIndex)
+    {
+        u32 Register = X64AllocatableRegisters[SavedIndex];
+        EmitREX(Object, false, 0, Register);
+        Emit8(Object, (u8)(0x50 + (Register & 7)));
+    }
+
+    if(Routine->FrameSize)
+    {
+        // NOTE(alex): sub rsp, imm32
+        Emit8(Object, 0x48);
+        Emit8(Object, 0x81);
+        Emit8(Object, 0xEC);
+        Emit32(Object, Routine->FrameSize);
+    }
+
+    //
+    // NOTE(alex): Blocks
+    //
+
+    for(u32 BlockIndex = 0; BlockIndex < Schedule->BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Schedule->Blocks + BlockIndex;
+        Routine->BlockOffsets[BlockIndex] = GetTextOffset(Object);
+
+        for(u32 InstructionIndex = Block->FirstInstruction;
+            InstructionIndex < (Block->FirstInstruction + Block->InstructionCount);
+            ++InstructionIndex)
+        {
+            GenerateX64Instruction(Routine, Block, Schedule->Instructions[InstructionIndex]);
+        }
+
+        if(Block->SuccessorCount == 1)
+        {
+            move_list *Moves = Allocation->BlockMoves + BlockIndex;
+            for(u32 MoveIndex = 0; MoveIndex < Moves->Count; ++MoveIndex)
+            {
+                EmitMove(Routine, Moves->Moves[MoveIndex].Dest, Moves->Moves[MoveIndex].Source);
+            }
+
+            if(Block->Successors[0]->Index != (BlockIndex + 1))
+            {
+                EmitJump(Routine, false, Block->Successors[0]->Index);
+            }
+        }
+    }
+
+    //
+    // NOTE(alex): Patch the jumps now that every block has an address
+    //
+
+    for(u32 FixupIndex = 0; FixupIndex < Routine->FixupCount; ++FixupIndex)
+    {
+        x64_fixup *Fixup = Routine->Fixups + FixupIndex;
+        s32 Displacement = (s32)(Routine->BlockOffsets[Fixup->TargetBlock] - (Fixup->Offset + 4));
+
+        u8 *Dest = Object->Text.Data + Fixup->Offset;
+        Dest[0] = (u8)((u32)Displacement >> 0);
+        Dest[1] = (u8)((u32)Displacement >> 8);
+        Dest[2] = (u8)((u32)Displacement >> 16);
+        Dest[3] = (u8)((u32)Displacement >> 24);
+    }
+
+    u32 Symbol = GetOrAddSymbol(Object, Name);
+    DefineSymbol(Object, Symbol, Section_Text, RoutineStart, GetTextOffset(Object) - RoutineStart);
+}
+
+// NOTE(alex): The C runtime calls main, which hands argv[1] (or zero) to the
+// entry routine as its argument.
+internal void GenerateX64EntryPoint(object_builder *Object, string EntryName)
+{
+    while(Object->Text.Size & 15)
+    {
+        Emit8(Object, 0xCC);
+    }
+
+    u32 Start = GetTextOffset(Object);
+
+    // NOTE(alex): Pushing rbx also realigns the stack to 16 for the calls
+    Emit8(Object, 0x53);                            // NOTE(alex): push rbx
+    EmitRR(Object, 0x31, X64_RBX, X64_RBX);         // NOTE(alex): xor ebx, ebx
+    Emit8(Object, 0x83);                            // NOTE(alex): cmp edi, 2
+    Emit8(Object, 0xFF);
+    Emit8(Object, 0x02);
+    Emit8(Object, 0x7C);                            // NOTE(alex): jl past the atoi
+    Emit8(Object, 11);
+    Emit8(Object, 0x48);                            // NOTE(alex): mov rdi, [rsi + 8]
+    Emit8(Object, 0x8B);
+    Emit8(Object, 0x7E);
+    Emit8(Object, 0x08);
+    EmitCall(Object, BundleZ("atoi"));
+    EmitRR(Object, 0x89, X64_RAX, X64_RBX);         // NOTE(alex): mov ebx, eax
+    EmitRR(Object, 0x89, X64_RBX, X64_RDI);         // NOTE(alex): mov edi, ebx
+    EmitCall(Object, EntryName);
+    EmitRR(Object, 0x31, X64_RAX, X64_RAX);         // NOTE(alex): xor eax, eax
+    Emit8(Object, 0x5B);                            // NOTE(alex): pop rbx
+    Emit8(Object, 0xC3);                            // NOTE(alex): ret
+
+    u32 Symbol = GetOrAddSymbol(Object, BundleZ("main"));
+    DefineSymbol(Object, Symbol, Section_Text, Start, GetTextOffset(Object) - Start);
+}
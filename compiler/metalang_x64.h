@@ -0,0 +1,56 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+enum x64_register
+{
+    X64_RAX,
+    X64_RCX,
+    X64_RDX,
+    X64_RBX,
+    X64_RSP,
+    X64_RBP,
+    X64_RSI,
+    X64_RDI,
+    X64_R8,
+    X64_R9,
+    X64_R10,
+    X64_R11,
+    X64_R12,
+    X64_R13,
+    X64_R14,
+    X64_R15,
+};
+
+struct x64_fixup
+{
+    u32 Offset; // NOTE(alex): Of the rel32 field in .text
+    u32 TargetBlock;
+};
+
+struct x64_routine
+{
+    object_builder *Object;
+    schedule *Schedule;
+    register_allocation *Allocation;
+
+    u32 SavedRegisterCount;
+    u32 FrameSize;
+
+    u32 *BlockOffsets;
+
+    u32 FixupCount;
+    x64_fixup *Fixups;
+};
+
+internal void GenerateX64Routine(memory_arena *Arena, object_builder *Object, string Name,
+                                 schedule *Schedule, register_allocation *Allocation);
+internal void GenerateX64EntryPoint(object_builder *Object, string EntryName);
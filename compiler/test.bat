@@ -0,0 +1,33 @@
+@echo off
+
+rem NOTE(alex): Checks that no routine in the tests compiles to more live nodes
+rem than its golden file in tests\golden allows. After a change that is supposed
+rem to make the graphs smaller (or bigger), "test record" writes them again.
+rem A test without a golden file fails, since -nodes-check can't open it.
+
+set Compiler=..\build\metalang_msvc_debug.exe
+set Slack=0
+set Failed=0
+
+pushd ..\tests
+if not exist golden mkdir golden
+
+if "%1"=="record" (
+    for %%f in (*.inl) do %Compiler% -nodes-record golden %%f > nul
+    goto done
+)
+
+for %%f in (*.inl) do (
+    %Compiler% -nodes-slack %Slack% -nodes-check golden %%f > nul
+    if errorlevel 1 set Failed=1
+)
+
+if %Failed%==1 (
+    echo Some routines went over their node budget
+) else (
+    echo All routines are within their node budget
+)
+
+:done
+popd
+exit /b %Failed%
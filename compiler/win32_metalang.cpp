@@ -12,6 +12,10 @@
 
 #include "metalang.h"
 
+// NOTE(alex): winsock2.h has to come before windows.h, which otherwise
+// pulls in the old winsock.h
+#include <winsock2.h>
+#include <afunix.h>
 #include <windows.h>
 #include <stdarg.h>
 #include <intrin.h>
@@ -22,6 +26,7 @@
 #include "win32_metalang.h"
 
 global ticket_mutex GlobalMemoryMutex;
+global platform_memory_stats GlobalMemoryStats;
 global win32_memory_block GlobalMemorySentinel =
 {
     {},
@@ -62,6 +67,7 @@ PLATFORM_ALLOCATE_MEMORY(Win32AllocateMemory)
     Block->Block.Base = (u8 *)Block + BaseOffset;
     Assert(Block->Block.Used == 0);
     Assert(Block->Block.ArenaPrev == 0);
+    Assert(Block->Block.MaxUsed == 0);
 
     if(Flags & (PlatformMemory_UnderflowCheck|PlatformMemory_OverflowCheck))
     {
@@ -74,12 +80,16 @@ PLATFORM_ALLOCATE_MEMORY(Win32AllocateMemory)
     Block->Next = Sentinel;
     Block->Block.Size = Size;
     Block->Block.Flags = Flags;
-    Block->Flags = 0;
 
     BeginTicketMutex(&GlobalMemoryMutex);
     Block->Prev = Sentinel->Prev;
     Block->Prev->Next = Block;
     Block->Next->Prev = Block;
+
+    platform_memory_stats *Stats = &GlobalMemoryStats;
+    ++Stats->BlockCount;
+    Stats->TotalSize += Size;
+    Stats->PeakSize = Maximum(Stats->PeakSize, Stats->TotalSize);
     EndTicketMutex(&GlobalMemoryMutex);
 
     platform_memory_block *PlatBlock = &Block->Block;
@@ -91,6 +101,10 @@ internal void Win32FreeMemoryBlock(win32_memory_block *Block)
     BeginTicketMutex(&GlobalMemoryMutex);
     Block->Prev->Next = Block->Next;
     Block->Next->Prev = Block->Prev;
+
+    platform_memory_stats *Stats = &GlobalMemoryStats;
+    --Stats->BlockCount;
+    Stats->TotalSize -= Block->Block.Size;
     EndTicketMutex(&GlobalMemoryMutex);
 
     // NOTE(alex): For porting to other platforms that need the size to unmap
@@ -109,8 +123,391 @@ PLATFORM_DEALLOCATE_MEMORY(Win32DeallocateMemory)
     }
 }
 
+PLATFORM_GET_MEMORY_STATS(Win32GetMemoryStats)
+{
+    BeginTicketMutex(&GlobalMemoryMutex);
+    platform_memory_stats Result = GlobalMemoryStats;
+    if(ResetPeak)
+    {
+        GlobalMemoryStats.PeakSize = GlobalMemoryStats.TotalSize;
+    }
+    EndTicketMutex(&GlobalMemoryMutex);
+
+    return Result;
+}
+
+__declspec(thread) global platform_work_queue *Win32ThreadQueue;
+__declspec(thread) global u32 Win32ThreadDequeIndex;
+
+inline u32 Win32GetDequeIndexFor(platform_work_queue *Queue)
+{
+    u32 Result = (Win32ThreadQueue == Queue) ? Win32ThreadDequeIndex : 0;
+    return Result;
+}
+
+internal void Win32PushWork(win32_work_deque *Deque, win32_work_queue_entry Entry)
+{
+    BeginTicketMutex(&Deque->Mutex);
+
+    Assert((Deque->Bottom - Deque->Top) < WIN32_WORK_DEQUE_SIZE);
+    Deque->Entries[Deque->Bottom % WIN32_WORK_DEQUE_SIZE] = Entry;
+    ++Deque->Bottom;
+
+    EndTicketMutex(&Deque->Mutex);
+}
+
+internal b32 Win32PopWork(win32_work_deque *Deque, win32_work_queue_entry *Entry, b32 Steal)
+{
+    b32 Result = false;
+
+    // NOTE(alex): Don't bother taking the lock on a deque that looks empty
+    if(Deque->Bottom != Deque->Top)
+    {
+        BeginTicketMutex(&Deque->Mutex);
+
+        if(Deque->Bottom != Deque->Top)
+        {
+            if(Steal)
+            {
+                *Entry = Deque->Entries[Deque->Top % WIN32_WORK_DEQUE_SIZE];
+                ++Deque->Top;
+            }
+            else
+            {
+                --Deque->Bottom;
+                *Entry = Deque->Entries[Deque->Bottom % WIN32_WORK_DEQUE_SIZE];
+            }
+
+            Result = true;
+        }
+
+        EndTicketMutex(&Deque->Mutex);
+    }
+
+    return Result;
+}
+
+internal b32 Win32DoNextWorkQueueEntry(platform_work_queue *Queue, u32 DequeIndex)
+{
+    win32_work_queue_entry Entry = {};
+
+    b32 GotEntry = Win32PopWork(Queue->Deques + DequeIndex, &Entry, false);
+    for(u32 Offset = 1; !GotEntry && (Offset < Queue->DequeCount); ++Offset)
+    {
+        u32 VictimIndex = (DequeIndex + Offset) % Queue->DequeCount;
+        GotEntry = Win32PopWork(Queue->Deques + VictimIndex, &Entry, true);
+    }
+
+    if(GotEntry)
+    {
+        Entry.Callback(Queue, Entry.Data);
+        _WriteBarrier();
+        if(Entry.Group)
+        {
+            AtomicAddU32(&Entry.Group->CompletionCount, 1);
+        }
+        AtomicAddU32(&Queue->CompletionCount, 1);
+    }
+
+    return GotEntry;
+}
+
+PLATFORM_ADD_WORK_QUEUE_ENTRY(Win32AddWorkQueueEntry)
+{
+    // NOTE(alex): The goal goes up first, so the count can never catch up
+    // to it while this entry is still outstanding.
+    if(Group)
+    {
+        AtomicAddU32(&Group->CompletionGoal, 1);
+    }
+    AtomicAddU32(&Queue->CompletionGoal, 1);
+
+    win32_work_queue_entry Entry = {Group, Callback, Data};
+    Win32PushWork(Queue->Deques + Win32GetDequeIndexFor(Queue), Entry);
+
+    ReleaseSemaphore(Queue->SemaphoreHandle, 1, 0);
+}
+
+PLATFORM_COMPLETE_ALL_WORK(Win32CompleteAllWork)
+{
+    u32 DequeIndex = Win32GetDequeIndexFor(Queue);
+    while(Queue->CompletionGoal != Queue->CompletionCount)
+    {
+        if(!Win32DoNextWorkQueueEntry(Queue, DequeIndex))
+        {
+            _mm_pause();
+        }
+    }
+}
+
+PLATFORM_COMPLETE_WORK_GROUP(Win32CompleteWorkGroup)
+{
+    u32 DequeIndex = Win32GetDequeIndexFor(Queue);
+    while(Group->CompletionGoal != Group->CompletionCount)
+    {
+        if(!Win32DoNextWorkQueueEntry(Queue, DequeIndex))
+        {
+            _mm_pause();
+        }
+    }
+}
+
+DWORD WINAPI ThreadProc(LPVOID lpParameter)
+{
+    win32_thread_startup *Startup = (win32_thread_startup *)lpParameter;
+    platform_work_queue *Queue = Startup->Queue;
+
+    Win32ThreadQueue = Queue;
+    Win32ThreadDequeIndex = Startup->DequeIndex;
+
+    while(!Queue->Quitting)
+    {
+        if(!Win32DoNextWorkQueueEntry(Queue, Win32ThreadDequeIndex))
+        {
+            WaitForSingleObjectEx(Queue->SemaphoreHandle, INFINITE, FALSE);
+        }
+    }
+
+    return 0;
+}
+
+PLATFORM_CREATE_WORK_QUEUE(Win32CreateWorkQueue)
+{
+    if(ThreadCount == 0)
+    {
+        ThreadCount = 1;
+    }
+
+    umm TotalSize = (sizeof(platform_work_queue) +
+                     ThreadCount*sizeof(win32_work_deque) +
+                     ThreadCount*sizeof(win32_thread_startup));
+    platform_work_queue *Queue = (platform_work_queue *)
+        VirtualAlloc(0, TotalSize, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    Assert(Queue);
+
+    Queue->Quitting = false;
+    Queue->DequeCount = ThreadCount;
+    Queue->Deques = (win32_work_deque *)(Queue + 1);
+    Queue->Startups = (win32_thread_startup *)(Queue->Deques + ThreadCount);
+
+    u32 InitialCount = 0;
+    Queue->SemaphoreHandle = CreateSemaphoreEx(0, InitialCount, S32Max,
+                                               0, 0, SEMAPHORE_ALL_ACCESS);
+
+    // NOTE(alex): The calling thread is the first one, so only the rest of
+    // them get created here.
+    for(u32 DequeIndex = 1; DequeIndex < ThreadCount; ++DequeIndex)
+    {
+        win32_thread_startup *Startup = Queue->Startups + DequeIndex;
+        Startup->Queue = Queue;
+        Startup->DequeIndex = DequeIndex;
+
+        DWORD ThreadID;
+        Startup->ThreadHandle = CreateThread(0, 0, ThreadProc, Startup, 0, &ThreadID);
+    }
+
+    return Queue;
+}
+
+PLATFORM_DESTROY_WORK_QUEUE(Win32DestroyWorkQueue)
+{
+    Win32CompleteAllWork(Queue);
+
+    // NOTE(alex): One wakeup for every thread, on top of whatever the
+    // semaphore was still holding, so none of them can sleep through it.
+    Queue->Quitting = true;
+    _WriteBarrier();
+    if(Queue->DequeCount > 1)
+    {
+        ReleaseSemaphore(Queue->SemaphoreHandle, Queue->DequeCount - 1, 0);
+    }
+
+    for(u32 DequeIndex = 1; DequeIndex < Queue->DequeCount; ++DequeIndex)
+    {
+        win32_thread_startup *Startup = Queue->Startups + DequeIndex;
+        WaitForSingleObjectEx(Startup->ThreadHandle, INFINITE, FALSE);
+        CloseHandle(Startup->ThreadHandle);
+    }
+
+    CloseHandle(Queue->SemaphoreHandle);
+    VirtualFree(Queue, 0, MEM_RELEASE);
+}
+
+PLATFORM_GET_PROCESSOR_COUNT(Win32GetProcessorCount)
+{
+    SYSTEM_INFO SystemInfo;
+    GetSystemInfo(&SystemInfo);
+
+    u32 Result = SystemInfo.dwNumberOfProcessors;
+    return Result;
+}
+
+global b32 Win32SocketsStarted;
+
+inline platform_socket Win32WrapSocket(SOCKET Socket)
+{
+    platform_socket Result = {};
+    if(Socket != INVALID_SOCKET)
+    {
+        Result.Handle = (u64)Socket;
+        Result.Valid = true;
+    }
+
+    return Result;
+}
+
+internal SOCKET Win32OpenLocalSocket(char *Path, sockaddr_un *Address)
+{
+    // NOTE(alex): Only the main thread ever opens sockets, so this doesn't
+    // need to be any more careful than this.
+    if(!Win32SocketsStarted)
+    {
+        WSADATA WSAData;
+        Win32SocketsStarted = (WSAStartup(MAKEWORD(2, 2), &WSAData) == 0);
+    }
+
+    ZeroStruct(*Address);
+    Address->sun_family = AF_UNIX;
+
+    SOCKET Result = INVALID_SOCKET;
+    u32 PathLength = StringLength(Path);
+    if(Win32SocketsStarted && (PathLength < sizeof(Address->sun_path)))
+    {
+        Copy(PathLength, Path, Address->sun_path);
+        Result = socket(AF_UNIX, SOCK_STREAM, 0);
+    }
+
+    return Result;
+}
+
+PLATFORM_OPEN_SERVER_SOCKET(Win32OpenServerSocket)
+{
+    sockaddr_un Address;
+    SOCKET Socket = Win32OpenLocalSocket(Path, &Address);
+    if(Socket != INVALID_SOCKET)
+    {
+        // NOTE(alex): A server that didn't get to shut down leaves its socket
+        // file behind, and bind won't reuse it.
+        DeleteFileA(Path);
+
+        if((bind(Socket, (sockaddr *)&Address, sizeof(Address)) == SOCKET_ERROR) ||
+           (listen(Socket, SOMAXCONN) == SOCKET_ERROR))
+        {
+            closesocket(Socket);
+            Socket = INVALID_SOCKET;
+        }
+    }
+
+    return Win32WrapSocket(Socket);
+}
+
+PLATFORM_ACCEPT_CONNECTION(Win32AcceptConnection)
+{
+    SOCKET Socket = accept((SOCKET)Listener.Handle, 0, 0);
+    return Win32WrapSocket(Socket);
+}
+
+PLATFORM_CONNECT_TO_SERVER(Win32ConnectToServer)
+{
+    sockaddr_un Address;
+    SOCKET Socket = Win32OpenLocalSocket(Path, &Address);
+    if(Socket != INVALID_SOCKET)
+    {
+        if(connect(Socket, (sockaddr *)&Address, sizeof(Address)) == SOCKET_ERROR)
+        {
+            closesocket(Socket);
+            Socket = INVALID_SOCKET;
+        }
+    }
+
+    return Win32WrapSocket(Socket);
+}
+
+PLATFORM_SEND_TO_SOCKET(Win32SendToSocket)
+{
+    b32 Result = true;
+
+    u8 *At = (u8 *)Data;
+    while(Result && Size)
+    {
+        int ChunkSize = (int)Minimum(Size, (umm)Megabytes(1));
+        int Sent = send((SOCKET)Socket.Handle, (char *)At, ChunkSize, 0);
+        if(Sent > 0)
+        {
+            At += Sent;
+            Size -= Sent;
+        }
+        else
+        {
+            Result = false;
+        }
+    }
+
+    return Result;
+}
+
+PLATFORM_RECEIVE_FROM_SOCKET(Win32ReceiveFromSocket)
+{
+    b32 Result = true;
+
+    u8 *At = (u8 *)Data;
+    while(Result && Size)
+    {
+        int ChunkSize = (int)Minimum(Size, (umm)Megabytes(1));
+        int Received = recv((SOCKET)Socket.Handle, (char *)At, ChunkSize, 0);
+        if(Received > 0)
+        {
+            At += Received;
+            Size -= Received;
+        }
+        else
+        {
+            // NOTE(alex): Zero means the other side closed the connection
+            Result = false;
+        }
+    }
+
+    return Result;
+}
+
+PLATFORM_CLOSE_SOCKET(Win32CloseSocket)
+{
+    closesocket((SOCKET)Socket.Handle);
+}
+
+PLATFORM_MAKE_DIRECTORY(Win32MakeDirectory)
+{
+    b32 Result = (CreateDirectoryA(Path, 0) ||
+                  (GetLastError() == ERROR_ALREADY_EXISTS));
+    return Result;
+}
+
+PLATFORM_MOVE_FILE_REPLACING(Win32MoveFileReplacing)
+{
+    b32 Result = MoveFileExA(SourcePath, DestPath, MOVEFILE_REPLACE_EXISTING);
+    return Result;
+}
+
 platform_api Platform =
 {
     Win32AllocateMemory,
     Win32DeallocateMemory,
+    Win32GetMemoryStats,
+
+    Win32CreateWorkQueue,
+    Win32DestroyWorkQueue,
+    Win32AddWorkQueueEntry,
+    Win32CompleteAllWork,
+    Win32CompleteWorkGroup,
+    Win32GetProcessorCount,
+
+    Win32OpenServerSocket,
+    Win32AcceptConnection,
+    Win32ConnectToServer,
+    Win32SendToSocket,
+    Win32ReceiveFromSocket,
+    Win32CloseSocket,
+
+    Win32MakeDirectory,
+    Win32MoveFileReplacing,
 };
@@ -15,5 +15,44 @@ struct win32_memory_block
     platform_memory_block Block;
     win32_memory_block *Prev;
     win32_memory_block *Next;
-    u64 Flags;
+};
+
+#define WIN32_WORK_DEQUE_SIZE 4096
+
+struct win32_work_queue_entry
+{
+    platform_work_group *Group;
+    platform_work_queue_callback *Callback;
+    void *Data;
+};
+
+// NOTE(alex): The thread that owns the deque pushes and pops at the bottom,
+// everybody else steals from the top.
+struct win32_work_deque
+{
+    ticket_mutex Mutex;
+    u32 volatile Top;
+    u32 volatile Bottom;
+    win32_work_queue_entry Entries[WIN32_WORK_DEQUE_SIZE];
+};
+
+struct win32_thread_startup
+{
+    platform_work_queue *Queue;
+    u32 DequeIndex;
+    HANDLE ThreadHandle;
+};
+
+struct platform_work_queue
+{
+    u32 volatile CompletionGoal;
+    u32 volatile CompletionCount;
+
+    HANDLE SemaphoreHandle;
+    b32 volatile Quitting;
+
+    // NOTE(alex): Deque zero belongs to the thread that created the queue
+    u32 DequeCount;
+    win32_work_deque *Deques;
+    win32_thread_startup *Startups;
 };
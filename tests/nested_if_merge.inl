@@ -0,0 +1,24 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+s32 Main()
+{
+    s32 X = 1;
+    if(arg < 10)
+    {
+        if(arg < 5)
+        {
+            X = 2;
+        }
+    }
+    Result = X; // 2 only when arg is less than 5.
+}
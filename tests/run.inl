@@ -0,0 +1,47 @@
+/* ========================================================================
+
+   (C) Copyright 2025 by Alexander Overstreet, All Rights Reserved.
+
+   This software is provided 'as-is', without any express or implied
+   warranty. In no event will the authors be held liable for any damages
+   arising from the use of this software.
+
+   Please see https://overgroup.org for more information
+
+   ======================================================================== */
+
+s32 Square()
+{
+    Result = arg*arg;
+}
+
+s32 Clamp()
+{
+    Result = arg;
+    if(arg < 0)
+    {
+        Result = 0;
+    }
+    if(100 < arg)
+    {
+        Result = 100;
+    }
+}
+
+s32 Fold()
+{
+    // NOTE: A #run inside a routine that is itself run at compile time.
+    Result = #run Square(12) - arg;
+}
+
+Main()
+{
+    #run Square(7);
+    #run Clamp(-5);
+    #run Clamp(250);
+    #run Fold(#run Square(2));
+
+    // NOTE: These were all run above, so they come out of the cache.
+    s32 X = #run Square(7) + #run Clamp(250);
+    X + arg;
+}